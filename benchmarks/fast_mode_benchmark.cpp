@@ -0,0 +1,82 @@
+// Benchmark of --fast excerpt analysis against full analysis, over the audio
+// files given on the command line (default: the test assets). Each iteration
+// analyzes every file once; the fast run also reports how often its bpm
+// (within 1 BPM) and key agree with the full run's.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "FileAnalysis.h"
+
+#ifndef MANALYSIS_TEST_ASSETS_DIR
+#define MANALYSIS_TEST_ASSETS_DIR ""
+#endif
+
+namespace {
+
+std::vector<std::string> g_files;
+
+std::vector<AnalysisResult> analyzeAll(bool fast) {
+    AnalyzeOptions options;
+    options.fast = fast;
+    std::vector<AnalysisResult> results(g_files.size());
+    for (size_t i = 0; i < g_files.size(); ++i) {
+        std::string error;
+        if (!analyzeFile(g_files[i], options, results[i], error))
+            std::fprintf(stderr, "%s\n", error.c_str());
+    }
+    return results;
+}
+
+void BM_AnalyzeFiles(benchmark::State& state) {
+    const bool fast = state.range(0) != 0;
+    std::vector<AnalysisResult> results;
+    for (auto _ : state) {
+        results = analyzeAll(fast);
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.counters["files"] = static_cast<double>(g_files.size());
+
+    if (fast && !g_files.empty()) {
+        static const std::vector<AnalysisResult> reference = analyzeAll(false);
+        int bpmAgree = 0;
+        int keyAgree = 0;
+        for (size_t i = 0; i < results.size(); ++i) {
+            bpmAgree += std::fabs(results[i].bpm - reference[i].bpm) < 1.0f;
+            keyAgree += results[i].key == reference[i].key;
+        }
+        state.counters["bpm_agreement"] = static_cast<double>(bpmAgree) / results.size();
+        state.counters["key_agreement"] = static_cast<double>(keyAgree) / results.size();
+    }
+}
+
+BENCHMARK(BM_AnalyzeFiles)->ArgName("fast")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    g_files.assign(argv + 1, argv + argc);
+    if (g_files.empty()) {
+        std::error_code ec;
+        for (const auto& entry :
+             std::filesystem::directory_iterator(MANALYSIS_TEST_ASSETS_DIR, ec)) {
+            if (entry.path().extension() == ".mp3")
+                g_files.push_back(entry.path().string());
+        }
+        std::sort(g_files.begin(), g_files.end());
+    }
+    if (g_files.empty()) {
+        std::fprintf(stderr, "No audio files given and none found in %s\n",
+                     MANALYSIS_TEST_ASSETS_DIR);
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
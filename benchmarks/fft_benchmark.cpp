@@ -0,0 +1,40 @@
+// Microbenchmark of FFTReal's backends: kissfft against the vectorized
+// SimdRealFFT, forward transforms in double and float at the sizes of the
+// onset detection (1024, 2048) and chroma (4096, 8192) frames.
+#include <benchmark/benchmark.h>
+#include <dsp/transforms/FFT.h>
+#include <dsp/transforms/SimdFFT.h>
+
+#include <vector>
+
+namespace {
+
+// Args: size, backend (0 = Kiss, 1 = Simd).
+template <typename T>
+void BM_ForwardFFT(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    FFTRealT<T> fft(n, state.range(1) ? FFTBackend::Simd : FFTBackend::Kiss);
+    std::vector<T> in(n), re(n), im(n);
+    unsigned seed = 1;
+    for (T& x : in) {
+        seed = seed * 1664525u + 1013904223u;
+        x = T((seed >> 8) / double(1 << 24) - 0.5);
+    }
+    for (auto _ : state) {
+        fft.forward(in.data(), re.data(), im.data());
+        benchmark::DoNotOptimize(re.data());
+        benchmark::DoNotOptimize(im.data());
+    }
+    state.SetLabel(state.range(1) ? SimdRealFFT<T>::instructionSet() : "kissfft");
+}
+
+BENCHMARK_TEMPLATE(BM_ForwardFFT, double)
+    ->ArgNames({"n", "simd"})
+    ->ArgsProduct({{1024, 2048, 4096, 8192}, {0, 1}});
+BENCHMARK_TEMPLATE(BM_ForwardFFT, float)
+    ->ArgNames({"n", "simd"})
+    ->ArgsProduct({{1024, 2048, 4096, 8192}, {0, 1}});
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,44 @@
+// Microbenchmark of DetectionFunction's DF_COMPLEXSD onset detection per
+// frame: the rectangular engine QmBpmAnalyzer runs with ENABLE_SIMD_FFT
+// against the polar form (phase vocoder, atan2, princarg, sin and cos), at
+// the 44.1/48 kHz frame of 1024 and the 96 kHz frame of 2048. With the option
+// on, the polar form is only reachable with adaptive whitening, which adds one
+// cheap pass over the magnitudes; without it both rows measure the polar form.
+#include <benchmark/benchmark.h>
+#include <dsp/onsets/DetectionFunction.h>
+
+#include <vector>
+
+namespace {
+
+// Args: frame length, engine (0 = rectangular, 1 = polar).
+template <typename T>
+void BM_ComplexSD(benchmark::State& state) {
+    const int n = static_cast<int>(state.range(0));
+    const int step = n / 2;
+    DetectionFunctionT<T> df(DFConfig{step, n, DF_COMPLEXSD, 3, state.range(1) != 0, -1, -1});
+    std::vector<double> signal(n + step * 255);
+    unsigned seed = 1;
+    for (double& x : signal) {
+        seed = seed * 1664525u + 1013904223u;
+        x = (seed >> 8) / double(1 << 24) - 0.5;
+    }
+    int frame = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(df.processTimeDomain(&signal[frame * step]));
+        frame = (frame + 1) % 256;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(state.range(1) || !kSimdFFTByDefault ? "polar" : "rectangular");
+}
+
+BENCHMARK_TEMPLATE(BM_ComplexSD, double)
+    ->ArgNames({"n", "polar"})
+    ->ArgsProduct({{1024, 2048}, {0, 1}});
+BENCHMARK_TEMPLATE(BM_ComplexSD, float)
+    ->ArgNames({"n", "polar"})
+    ->ArgsProduct({{1024, 2048}, {0, 1}});
+
+}  // namespace
+
+BENCHMARK_MAIN();
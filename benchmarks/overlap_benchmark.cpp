@@ -0,0 +1,139 @@
+// Microbenchmark of DownmixAndOverlapHelper against the sliding-window helper
+// it replaced. Each iteration windows one minute of 44.1 kHz mono audio fed in
+// decoder-sized chunks.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "DownmixAndOverlapHelper.h"
+
+namespace {
+
+constexpr size_t kChunkFrames = 8192;
+constexpr size_t kTotalFrames = 44100 * 60;
+
+// The previous helper: a window-sized buffer slid down by one step after
+// every window.
+class SlidingOverlapHelper {
+  public:
+    using WindowReadyCallback = std::function<bool(double* pBuffer, size_t frames)>;
+
+    SlidingOverlapHelper(size_t windowSize, size_t stepSize, WindowReadyCallback callback)
+        : m_buffer(windowSize, 0.0),
+          m_windowSize(windowSize),
+          m_stepSize(stepSize),
+          m_bufferWritePosition(windowSize / 2),
+          m_callback(std::move(callback)) {}
+
+    void processMonoSamples(const double* pInput, size_t numInputFrames) {
+        size_t inRead = 0;
+        double* pDownmix = m_buffer.data();
+        while (inRead < numInputFrames) {
+            size_t numFrames =
+                std::min(numInputFrames - inRead, m_windowSize - m_bufferWritePosition);
+            std::copy(pInput + inRead, pInput + inRead + numFrames,
+                      pDownmix + m_bufferWritePosition);
+            m_bufferWritePosition += numFrames;
+            inRead += numFrames;
+
+            if (m_bufferWritePosition == m_windowSize) {
+                m_callback(pDownmix, m_windowSize);
+                for (size_t i = 0; i < (m_windowSize - m_stepSize); ++i) {
+                    pDownmix[i] = pDownmix[i + m_stepSize];
+                }
+                m_bufferWritePosition -= m_stepSize;
+            }
+        }
+    }
+
+  private:
+    std::vector<double> m_buffer;
+    size_t m_windowSize;
+    size_t m_stepSize;
+    size_t m_bufferWritePosition;
+    WindowReadyCallback m_callback;
+};
+
+const std::vector<double>& monoInput() {
+    static const std::vector<double> input = [] {
+        std::vector<double> v(kTotalFrames);
+        for (size_t i = 0; i < v.size(); ++i) {
+            v[i] = std::sin(i * 0.0627);
+        }
+        return v;
+    }();
+    return input;
+}
+
+template <typename Helper>
+void feedAll(Helper& helper) {
+    const std::vector<double>& input = monoInput();
+    for (size_t pos = 0; pos < input.size(); pos += kChunkFrames) {
+        helper.processMonoSamples(input.data() + pos, std::min(kChunkFrames, input.size() - pos));
+    }
+}
+
+// Args: window size, step size.
+void BM_Sliding(benchmark::State& state) {
+    const size_t window = state.range(0);
+    const size_t step = state.range(1);
+    for (auto _ : state) {
+        double sink = 0.0;
+        SlidingOverlapHelper helper(window, step, [&](double* pWindow, size_t) {
+            sink += pWindow[window - 1];
+            return true;
+        });
+        feedAll(helper);
+        benchmark::DoNotOptimize(sink);
+    }
+    state.SetItemsProcessed(state.iterations() * kTotalFrames);
+}
+
+void BM_Ring(benchmark::State& state) {
+    const size_t window = state.range(0);
+    const size_t step = state.range(1);
+    for (auto _ : state) {
+        double sink = 0.0;
+        DownmixAndOverlapHelper helper;
+        helper.initialize(window, step, [&](double* pWindow, size_t) {
+            sink += pWindow[window - 1];
+            return true;
+        });
+        feedAll(helper);
+        benchmark::DoNotOptimize(sink);
+    }
+    state.SetItemsProcessed(state.iterations() * kTotalFrames);
+}
+
+// Args: window size, step size, windows per batch.
+void BM_RingBatched(benchmark::State& state) {
+    const size_t window = state.range(0);
+    const size_t step = state.range(1);
+    const size_t batch = state.range(2);
+    for (auto _ : state) {
+        double sink = 0.0;
+        DownmixAndOverlapHelper helper;
+        helper.initialize(window, step, batch, [&](double* pFirstWindow, size_t numWindows) {
+            for (size_t i = 0; i < numWindows; ++i) {
+                sink += pFirstWindow[i * step + window - 1];
+            }
+            return true;
+        });
+        feedAll(helper);
+        benchmark::DoNotOptimize(sink);
+    }
+    state.SetItemsProcessed(state.iterations() * kTotalFrames);
+}
+
+// BPM detection function geometry at 44.1 kHz, a high-overlap window, and
+// the (non-overlapping) key detector block.
+BENCHMARK(BM_Sliding)->Args({1024, 512})->Args({4096, 512})->Args({32768, 32768});
+BENCHMARK(BM_Ring)->Args({1024, 512})->Args({4096, 512})->Args({32768, 32768});
+BENCHMARK(BM_RingBatched)->Args({1024, 512, 16})->Args({4096, 512, 16});
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,100 @@
+// Benchmark of the float32 bpm and key DSP (--float32) against the default
+// double precision, over the audio files given on the command line (default:
+// the test assets). Each iteration analyzes every file once with only bpm and
+// key selected; the float run also reports how often its bpm and key agree
+// exactly with the double run's and how far its beats stray from them.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "FileAnalysis.h"
+
+#ifndef MANALYSIS_TEST_ASSETS_DIR
+#define MANALYSIS_TEST_ASSETS_DIR ""
+#endif
+
+namespace {
+
+std::vector<std::string> g_files;
+
+std::vector<AnalysisResult> analyzeAll(bool singlePrecision) {
+    AnalyzeOptions options;
+    options.analyzers = AnalyzerSelection{true, true, false, false, false};
+    options.singlePrecision = singlePrecision;
+    std::vector<AnalysisResult> results(g_files.size());
+    for (size_t i = 0; i < g_files.size(); ++i) {
+        std::string error;
+        if (!analyzeFile(g_files[i], options, results[i], error))
+            std::fprintf(stderr, "%s\n", error.c_str());
+    }
+    return results;
+}
+
+// Largest distance in seconds between corresponding beats, or infinity if
+// the beatgrids have different lengths.
+double maxBeatDeviation(const std::vector<double>& a, const std::vector<double>& b) {
+    if (a.size() != b.size())
+        return INFINITY;
+    double deviation = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        deviation = std::max(deviation, std::fabs(a[i] - b[i]));
+    }
+    return deviation;
+}
+
+void BM_AnalyzeFiles(benchmark::State& state) {
+    const bool singlePrecision = state.range(0) != 0;
+    std::vector<AnalysisResult> results;
+    for (auto _ : state) {
+        results = analyzeAll(singlePrecision);
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.counters["files"] = static_cast<double>(g_files.size());
+
+    if (singlePrecision && !g_files.empty()) {
+        static const std::vector<AnalysisResult> reference = analyzeAll(false);
+        int bpmAgree = 0;
+        int keyAgree = 0;
+        double beatDeviation = 0.0;
+        for (size_t i = 0; i < results.size(); ++i) {
+            bpmAgree += results[i].bpm == reference[i].bpm;
+            keyAgree += results[i].key == reference[i].key;
+            beatDeviation = std::max(
+                beatDeviation, maxBeatDeviation(results[i].beatgrid, reference[i].beatgrid));
+        }
+        state.counters["bpm_agreement"] = static_cast<double>(bpmAgree) / results.size();
+        state.counters["key_agreement"] = static_cast<double>(keyAgree) / results.size();
+        state.counters["max_beat_dev_ms"] = beatDeviation * 1000.0;
+    }
+}
+
+BENCHMARK(BM_AnalyzeFiles)->ArgName("float32")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    g_files.assign(argv + 1, argv + argc);
+    if (g_files.empty()) {
+        std::error_code ec;
+        for (const auto& entry :
+             std::filesystem::directory_iterator(MANALYSIS_TEST_ASSETS_DIR, ec)) {
+            if (entry.path().extension() == ".mp3")
+                g_files.push_back(entry.path().string());
+        }
+        std::sort(g_files.begin(), g_files.end());
+    }
+    if (g_files.empty()) {
+        std::fprintf(stderr, "No audio files given and none found in %s\n",
+                     MANALYSIS_TEST_ASSETS_DIR);
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
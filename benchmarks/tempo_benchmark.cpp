@@ -0,0 +1,76 @@
+// Microbenchmark of the resonator comb filter bank in TempoTrackV2: the FFT
+// and sparse-matrix path against the direct reference, over every frame
+// calculateBeatPeriod() cuts from a 10-minute and a 2-hour detection function.
+#include <benchmark/benchmark.h>
+#include <dsp/tempotracking/TempoTrackV2.h>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr int kWinLen = 512;
+constexpr int kHopSize = 128;
+constexpr double kDfRate = 44100.0 / 512.0;  // DF values per second
+
+// Args: detection function length in minutes.
+std::vector<double> makeDetectionFunction(int minutes) {
+    std::vector<double> df(static_cast<size_t>(minutes * 60 * kDfRate));
+    unsigned seed = 1;
+    for (size_t i = 0; i < df.size(); ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        df[i] = (i % 40 == 0 ? 4.0 : 0.0) + (seed >> 8) / double(1 << 24);
+    }
+    return df;
+}
+
+std::vector<double> rayleighWeighting() {
+    const double rayparam = (60 * 44100 / 512.0) / 120.0;
+    std::vector<double> wv(128);
+    for (size_t i = 0; i < wv.size(); ++i) {
+        wv[i] = (i / std::pow(rayparam, 2.)) * std::exp(-std::pow(double(i), 2.) /
+                                                        (2. * std::pow(rayparam, 2.)));
+    }
+    return wv;
+}
+
+template <bool Direct>
+void BM_CombFilterBank(benchmark::State& state) {
+    const std::vector<double> df = makeDetectionFunction(static_cast<int>(state.range(0)));
+    const std::vector<double> wv = rayleighWeighting();
+    const int dfLen = static_cast<int>(df.size());
+    std::vector<double> frame(kWinLen);
+    std::vector<double> rcf(wv.size());
+    for (auto _ : state) {
+        ResonatorCombFilterBank bank(kWinLen, wv);
+        for (int i = -kWinLen / 2; i < dfLen - kWinLen / 2; i += kHopSize) {
+            for (int n = 0; n < kWinLen; ++n) {
+                frame[n] = (i + n >= 0 && i + n < dfLen) ? df[i + n] : 0.0;
+            }
+            if (Direct) {
+                bank.processDirect(frame, rcf);
+            } else {
+                bank.process(frame, rcf);
+            }
+        }
+        benchmark::DoNotOptimize(rcf.data());
+    }
+}
+
+void BM_CalculateBeatPeriod(benchmark::State& state) {
+    const std::vector<double> df = makeDetectionFunction(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        TempoTrackV2 tt(44100.f, 512);
+        std::vector<int> beatPeriod(df.size() / kHopSize + 1);
+        tt.calculateBeatPeriod(df, beatPeriod);
+        benchmark::DoNotOptimize(beatPeriod.data());
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_CombFilterBank, true)->Arg(10)->Arg(120)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_CombFilterBank, false)->Arg(10)->Arg(120)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CalculateBeatPeriod)->Arg(10)->Arg(120)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,99 @@
+/*
+ * mixxx-analyzer C API: analyze PCM audio that is already decoded in memory.
+ *
+ * A session is created for one stream at a fixed sample rate and channel
+ * count. Interleaved float32 buffers are pushed in any number of calls of
+ * any size, then the session is finalized and the results read back. The
+ * analysis is the same as the mixxx-analyzer CLI: Queen Mary BPM + beatgrid
+ * and key, EBU R128 loudness, and intro/outro silence detection.
+ *
+ * Pushed audio is rechunked into fixed blocks internally, so results do not
+ * depend on how the caller splits the stream. Stereo buffers are analyzed in
+ * place; other layouts are converted to stereo through a small per-session
+ * block buffer (mono is duplicated to both sides, for more than two channels
+ * the first two are used).
+ *
+ * A session must not be used from several threads at once; separate
+ * sessions are independent and may run concurrently.
+ */
+#ifndef MIXXX_ANALYZER_H
+#define MIXXX_ANALYZER_H
+
+#include <stddef.h>
+
+#if defined(MIXXX_ANALYZER_STATIC)
+#define MXA_API
+#elif defined(_WIN32)
+#if defined(MIXXX_ANALYZER_BUILD)
+#define MXA_API __declspec(dllexport)
+#else
+#define MXA_API __declspec(dllimport)
+#endif
+#else
+#define MXA_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped on incompatible changes to this header. */
+#define MXA_API_VERSION 1
+
+typedef struct mxa_session mxa_session;
+
+typedef enum {
+    MXA_OK = 0,
+    MXA_ERROR_INVALID_ARGUMENT = 1, /* null pointer, bad sample rate or channel count */
+    MXA_ERROR_BAD_STATE = 2,        /* push after finalize, or result before it */
+    MXA_ERROR_NO_AUDIO = 3,         /* finalize without any pushed frames */
+    MXA_ERROR_INTERNAL = 4          /* unexpected failure (e.g. out of memory) */
+} mxa_status;
+
+/* Returns MXA_API_VERSION of the library actually loaded. */
+MXA_API int mxa_api_version(void);
+
+/* Creates a session for interleaved float32 audio. Returns NULL if
+ * sample_rate or channels is not positive. */
+MXA_API mxa_session* mxa_session_create(int sample_rate, int channels);
+
+/* Destroys a session and every result string or array obtained from it.
+ * NULL is ignored. */
+MXA_API void mxa_session_destroy(mxa_session* session);
+
+/* Analyzes num_frames frames (num_frames * channels floats). The buffer is
+ * only read during the call. */
+MXA_API mxa_status mxa_session_push(mxa_session* session, const float* interleaved,
+                                    size_t num_frames);
+
+/* Ends the stream and computes all results. */
+MXA_API mxa_status mxa_session_finalize(mxa_session* session);
+
+/* Result getters, valid after a successful mxa_session_finalize(). */
+
+/* Detected BPM; 0 if undetected. */
+MXA_API mxa_status mxa_session_bpm(const mxa_session* session, double* bpm);
+
+/* Beat positions in seconds. *beats stays valid until the session is destroyed. */
+MXA_API mxa_status mxa_session_beatgrid(const mxa_session* session, const double** beats,
+                                        size_t* num_beats);
+
+/* Key name (e.g. "D minor") and Camelot code (e.g. "7A"); empty strings if
+ * no key was found. Strings stay valid until the session is destroyed. */
+MXA_API mxa_status mxa_session_key(const mxa_session* session, const char** key,
+                                   const char** camelot);
+
+/* Integrated loudness in LUFS and ReplayGain 2.0 adjustment in dB (both 0
+ * if loudness could not be measured, e.g. for digital silence). */
+MXA_API mxa_status mxa_session_loudness(const mxa_session* session, double* lufs,
+                                        double* replay_gain);
+
+/* First and last non-silent frame, in seconds. */
+MXA_API mxa_status mxa_session_intro_outro(const mxa_session* session, double* intro_secs,
+                                           double* outro_secs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MIXXX_ANALYZER_H */
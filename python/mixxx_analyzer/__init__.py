@@ -1,6 +1,22 @@
 """mixxx-analyzer: Audio track analysis using Mixxx-identical algorithms."""
 
-from ._runner import AnalysisResult, analyze, analyze_many
+from ._runner import (
+    AnalysisError,
+    AnalysisFailure,
+    AnalysisResult,
+    AnalyzerServer,
+    analyze,
+    analyze_many,
+    iter_analyze,
+)
 
-__all__ = ["AnalysisResult", "analyze", "analyze_many"]
+__all__ = [
+    "AnalysisError",
+    "AnalysisFailure",
+    "AnalysisResult",
+    "AnalyzerServer",
+    "analyze",
+    "analyze_many",
+    "iter_analyze",
+]
 __version__ = "0.1.0"
@@ -1,12 +1,22 @@
-"""Subprocess wrapper that locates and calls the bundled mixxx-analyzer binary."""
+"""Runs analyses in-process via the native extension when it is available,
+otherwise through the bundled mixxx-analyzer binary."""
 
+import itertools
 import json
 import os
 import subprocess
 import sys
+import tempfile
+import threading
+from concurrent.futures import Future
 from dataclasses import dataclass, field
 from pathlib import Path
-from typing import Dict, List, Optional
+from typing import Dict, Iterator, List, Optional, Sequence, Union
+
+try:
+    from . import _native
+except ImportError:  # extension not built, or NumPy not installed
+    _native = None
 
 
 @dataclass
@@ -27,19 +37,26 @@ class AnalysisResult:
                comment, trackNumber, bpmTag). Empty strings for
                absent tags.
         beatgrid: Beat positions in seconds (from the Queen Mary
-                  tempo tracker). Empty list if BPM was undetected.
+                  tempo tracker). Empty if BPM was undetected. A
+                  float64 NumPy array when analyzed in-process, a
+                  list otherwise. None for --fast estimates.
+        approximate: True if bpm and key were estimated from a few
+                     excerpts (the binary's --fast mode).
+
+    Fields of analyzers left out with ``only`` are None.
     """
 
     file: str
-    bpm: Optional[float]
-    key: str
-    camelot: str
-    lufs: float
-    replay_gain: float
-    intro_secs: float
-    outro_secs: float
+    bpm: Optional[float] = None
+    key: Optional[str] = None
+    camelot: Optional[str] = None
+    lufs: Optional[float] = None
+    replay_gain: Optional[float] = None
+    intro_secs: Optional[float] = None
+    outro_secs: Optional[float] = None
     tags: Dict[str, str] = field(default_factory=dict)
-    beatgrid: List[float] = field(default_factory=list)
+    beatgrid: Optional[Sequence[float]] = field(default_factory=list)
+    approximate: bool = False
 
     @classmethod
     def from_dict(cls, d: dict) -> "AnalysisResult":
@@ -57,17 +74,47 @@ class AnalysisResult:
         return cls(
             file=d["file"],
             bpm=d.get("bpm"),
-            key=d["key"],
-            camelot=d["camelot"],
-            lufs=d["lufs"],
-            replay_gain=d["replayGain"],
-            intro_secs=d["introSecs"],
-            outro_secs=d["outroSecs"],
+            key=d.get("key"),
+            camelot=d.get("camelot"),
+            lufs=d.get("lufs"),
+            replay_gain=d.get("replayGain"),
+            intro_secs=d.get("introSecs"),
+            outro_secs=d.get("outroSecs"),
             tags=tags,
-            beatgrid=d.get("beatgrid", []),
+            beatgrid=d.get("beatgrid"),
+            approximate=d.get("approximate", False),
         )
 
 
+@dataclass
+class AnalysisFailure:
+    """A file that could not be analyzed.
+
+    Attributes:
+        file: Path to the file.
+        error: Error message reported by the binary.
+    """
+
+    file: str
+    error: str
+
+
+class AnalysisError(subprocess.CalledProcessError):
+    """Raised when a file cannot be analyzed.
+
+    Subclasses CalledProcessError so callers written against the
+    subprocess-only API keep working with the in-process extension.
+    """
+
+    def __init__(self, file: str, error: str):
+        super().__init__(1, file, stderr=error)
+        self.file = file
+        self.error = error
+
+    def __str__(self) -> str:
+        return f"{self.file}: {self.error}"
+
+
 def _find_binary() -> str:
     """Return path to the mixxx-analyzer binary (bundled or on PATH)."""
     suffix = ".exe" if sys.platform == "win32" else ""
@@ -88,29 +135,216 @@ def _find_binary() -> str:
     )
 
 
-def analyze(path: str) -> AnalysisResult:
+def _only_arg(only: Optional[Sequence[str]]) -> Optional[str]:
+    """Format an analyzer selection as the binary's --only list."""
+    return None if only is None else ",".join(only)
+
+
+def analyze(path: str, only: Optional[Sequence[str]] = None) -> AnalysisResult:
     """Analyze a single audio file.
 
     Returns an AnalysisResult with BPM, key, Camelot notation,
     LUFS loudness, ReplayGain, intro/outro timestamps, embedded
     metadata tags, and a full beatgrid (beat positions in seconds).
 
-    Raises subprocess.CalledProcessError if the binary fails.
-    Raises FileNotFoundError if the binary is not installed.
+    only restricts the analysis to some of "bpm", "key", "gain",
+    "silence" and "intro" (the intro timestamp alone, which stops reading
+    at the first sound); the fields of the others are None. A gain-only
+    pass costs little more than decoding.
+
+    Runs in-process (releasing the GIL) when the native extension is
+    installed, so several Python threads can analyze concurrently.
+
+    Raises AnalysisError (a subprocess.CalledProcessError) if the file
+    cannot be analyzed.
+    Raises FileNotFoundError if neither the extension nor the binary is
+    installed.
+    """
+    if _native is not None:
+        d = _native.analyze(os.fspath(path), only=_only_arg(only))
+        if "error" in d:
+            raise AnalysisError(d["file"], d["error"])
+        return AnalysisResult.from_dict(d)
+    return analyze_many([path], only=only)[0]
+
+
+# Bytes of the binary's stderr kept for CalledProcessError.
+_STDERR_TAIL_BYTES = 64 * 1024
+
+
+def _read_tail(f) -> str:
+    """Return the last _STDERR_TAIL_BYTES of binary file f, decoded."""
+    size = f.seek(0, os.SEEK_END)
+    f.seek(max(0, size - _STDERR_TAIL_BYTES))
+    return f.read().decode(errors="replace")
+
+
+def iter_analyze(
+    paths: List[str],
+    jobs: int = 1,
+    cache_dir: Optional[str] = None,
+    only: Optional[Sequence[str]] = None,
+) -> Iterator[Union[AnalysisResult, AnalysisFailure]]:
+    """Analyze multiple audio files, yielding each outcome as soon as it is ready.
+
+    Outcomes are yielded in the order of paths: an AnalysisResult for every
+    analyzed file and an AnalysisFailure for every file that failed. jobs,
+    cache_dir and only are as for analyze_many().
+
+    Raises subprocess.CalledProcessError if the binary itself fails.
     """
-    return analyze_many([path])[0]
+    binary = _find_binary()
+    args = [binary, "--ndjson", "--jobs", str(jobs)]
+    if cache_dir is not None:
+        args += ["--cache", str(cache_dir)]
+    if only is not None:
+        args += ["--only", _only_arg(only)]
+    args += list(paths)
+
+    # stderr goes to a file rather than a pipe: FFmpeg logs every damaged
+    # file there, and a full pipe would block the binary while we wait on
+    # its stdout.
+    with tempfile.TemporaryFile() as err, subprocess.Popen(
+        args, stdout=subprocess.PIPE, stderr=err, text=True
+    ) as proc:
+        any_failed = False
+        for line in proc.stdout:
+            d = json.loads(line)
+            if "error" in d:
+                any_failed = True
+                yield AnalysisFailure(file=d["file"], error=d["error"])
+            else:
+                yield AnalysisResult.from_dict(d)
+        returncode = proc.wait()
+        stderr = _read_tail(err)
+
+    # Exit code 1 only signals the per-file failures already yielded above.
+    if returncode != 0 and not (returncode == 1 and any_failed):
+        raise subprocess.CalledProcessError(returncode, args, stderr=stderr)
 
 
-def analyze_many(paths: List[str]) -> List[AnalysisResult]:
+def analyze_many(
+    paths: List[str],
+    jobs: int = 1,
+    cache_dir: Optional[str] = None,
+    only: Optional[Sequence[str]] = None,
+) -> List[AnalysisResult]:
     """Analyze multiple audio files in a single binary invocation.
 
     More efficient than calling analyze() in a loop for large batches.
+    jobs is the number of files analyzed in parallel (0 = one per CPU
+    core). Results are returned in the order of paths either way.
+    If cache_dir is given, results are cached there across calls. only
+    selects analyzers as for analyze(). Runs in-process when the native
+    extension is installed.
+
+    Raises AnalysisError (a subprocess.CalledProcessError) for the first
+    file that fails; use iter_analyze() to keep the successful results of
+    a partial batch.
     """
-    binary = _find_binary()
-    proc = subprocess.run(
-        [binary, "--json"] + list(paths),
-        capture_output=True,
-        text=True,
-        check=True,
-    )
-    return [AnalysisResult.from_dict(d) for d in json.loads(proc.stdout)]
+    if _native is not None:
+        records = _native.analyze_many(
+            [os.fspath(p) for p in paths],
+            jobs=jobs,
+            cache_dir=cache_dir,
+            only=_only_arg(only),
+        )
+        outcomes = [
+            AnalysisFailure(file=d["file"], error=d["error"])
+            if "error" in d
+            else AnalysisResult.from_dict(d)
+            for d in records
+        ]
+    else:
+        outcomes = iter_analyze(paths, jobs=jobs, cache_dir=cache_dir, only=only)
+
+    results = []
+    for outcome in outcomes:
+        if isinstance(outcome, AnalysisFailure):
+            raise AnalysisError(outcome.file, outcome.error)
+        results.append(outcome)
+    return results
+
+
+class AnalyzerServer:
+    """A long-running ``mixxx-analyzer --serve`` process.
+
+    Keeps the binary and its worker pool warm across calls, so analyzing a
+    single track costs no process start-up. Safe to use from several threads;
+    requests are analyzed concurrently on up to ``jobs`` workers. ``only``
+    selects the analyzers for every request, as for analyze(). Use as a
+    context manager or call close() when done.
+
+        with AnalyzerServer(jobs=4) as server:
+            result = server.analyze("/path/to/track.mp3")
+    """
+
+    def __init__(
+        self,
+        jobs: int = 1,
+        cache_dir: Optional[str] = None,
+        only: Optional[Sequence[str]] = None,
+    ):
+        args = [_find_binary(), "--serve", "--jobs", str(jobs)]
+        if cache_dir is not None:
+            args += ["--cache", str(cache_dir)]
+        if only is not None:
+            args += ["--only", _only_arg(only)]
+        self._proc = subprocess.Popen(
+            args,
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            text=True,
+            bufsize=1,
+        )
+        self._ids = itertools.count()
+        self._pending: Dict[int, Future] = {}
+        self._lock = threading.Lock()
+        self._reader = threading.Thread(target=self._read_responses, daemon=True)
+        self._reader.start()
+
+    def submit(self, path: str) -> "Future[AnalysisResult]":
+        """Queue path for analysis; the future raises AnalysisError on failure."""
+        future: Future = Future()
+        with self._lock:
+            request_id = next(self._ids)
+            self._pending[request_id] = future
+            self._proc.stdin.write(json.dumps({"id": request_id, "path": str(path)}) + "\n")
+            self._proc.stdin.flush()
+        return future
+
+    def analyze(self, path: str) -> AnalysisResult:
+        """Analyze a single audio file and wait for the result."""
+        return self.submit(path).result()
+
+    def close(self) -> None:
+        """Finish outstanding requests and stop the server process."""
+        with self._lock:
+            if self._proc.stdin.closed:
+                return
+            self._proc.stdin.close()
+        self._reader.join()
+        self._proc.wait()
+
+    def __enter__(self) -> "AnalyzerServer":
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+    def _read_responses(self) -> None:
+        for line in self._proc.stdout:
+            d = json.loads(line)
+            with self._lock:
+                future = self._pending.pop(d["id"], None)
+            if future is None:
+                continue
+            if "error" in d:
+                future.set_exception(AnalysisError(d["file"], d["error"]))
+            else:
+                future.set_result(AnalysisResult.from_dict(d))
+        # The process exited: fail whatever is still waiting.
+        with self._lock:
+            pending, self._pending = self._pending, {}
+        for future in pending.values():
+            future.set_exception(RuntimeError("mixxx-analyzer --serve exited"))
@@ -0,0 +1,280 @@
+#include "AnalysisCache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <utility>
+
+#include "StreamHasher.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bump when the on-disk layout of an entry changes.
+constexpr int kFormatVersion = 1;
+constexpr const char* kMagic = "mixxx-analyzer-cache";
+
+const std::pair<const char*, std::string AudioDecoder::Tags::*> kTagFields[] = {
+    {"title", &AudioDecoder::Tags::title},
+    {"artist", &AudioDecoder::Tags::artist},
+    {"album", &AudioDecoder::Tags::album},
+    {"year", &AudioDecoder::Tags::year},
+    {"genre", &AudioDecoder::Tags::genre},
+    {"label", &AudioDecoder::Tags::label},
+    {"comment", &AudioDecoder::Tags::comment},
+    {"trackNumber", &AudioDecoder::Tags::trackNumber},
+    {"bpmTag", &AudioDecoder::Tags::bpmTag},
+};
+
+std::string hashString(const std::string& s) {
+    StreamHasher hasher;
+    hasher.update(s);
+    return hasher.hexDigest();
+}
+
+// Values are stored one per line; escape the characters that would break that.
+std::string escapeValue(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (char c : s) {
+        if (c == '\\')
+            out += "\\\\";
+        else if (c == '\n')
+            out += "\\n";
+        else if (c == '\r')
+            out += "\\r";
+        else
+            out += c;
+    }
+    return out;
+}
+
+std::string unescapeValue(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '\\' && i + 1 < s.size()) {
+            ++i;
+            out += (s[i] == 'n') ? '\n' : (s[i] == 'r') ? '\r' : s[i];
+        } else {
+            out += s[i];
+        }
+    }
+    return out;
+}
+
+std::string formatDouble(double v) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.17g", v);
+    return buf;
+}
+
+// Parsed "key value" lines of an entry, plus any bare lines (beatgrid values)
+// in order. Returns false if the file is missing, from another format
+// version, or truncated (no trailing "end" line).
+struct Entry {
+    std::map<std::string, std::string> fields;
+    std::vector<std::string> values;
+};
+
+bool readEntry(const std::string& file, Entry& entry) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in)
+        return false;
+
+    const std::string header = std::string(kMagic) + " " + std::to_string(kFormatVersion);
+    std::string line;
+    if (!std::getline(in, line) || line != header)
+        return false;
+
+    bool complete = false;
+    while (std::getline(in, line)) {
+        if (line == "end") {
+            complete = true;
+            break;
+        }
+        const std::size_t space = line.find(' ');
+        if (space == std::string::npos) {
+            entry.values.push_back(line);
+        } else {
+            entry.fields[line.substr(0, space)] = unescapeValue(line.substr(space + 1));
+        }
+    }
+    return complete;
+}
+
+// Writes 'contents' to 'file' via a uniquely named temporary in the same
+// directory and an atomic rename, so concurrent readers and writers (threads
+// or processes) never observe a partial entry.
+void writeEntryAtomically(const std::string& file, const std::string& contents) {
+    static std::atomic<unsigned long long> counter{0};
+    static const unsigned long long nonce = std::random_device{}() * 0x9e3779b97f4a7c15ULL;
+
+    const std::string tmp = file + ".tmp" + std::to_string(nonce) + "-" + std::to_string(counter++);
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return;
+        out << kMagic << ' ' << kFormatVersion << '\n' << contents << "end\n";
+        out.flush();
+        if (!out) {
+            out.close();
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp, file, ec);
+    if (ec)
+        fs::remove(tmp, ec);
+}
+
+}  // namespace
+
+AnalysisCache::AnalysisCache(std::string dir, std::string signature)
+    : m_dir(std::move(dir)),
+      m_signature(std::move(signature)),
+      m_signatureHash(hashString(m_signature)) {}
+
+bool AnalysisCache::open(std::string& error) {
+    std::error_code ec;
+    fs::create_directories(fs::path(m_dir) / "paths", ec);
+    if (!ec)
+        fs::create_directories(fs::path(m_dir) / "results" / m_signatureHash, ec);
+    if (ec) {
+        error = "Cannot create cache directory '" + m_dir + "': " + ec.message();
+        return false;
+    }
+    return true;
+}
+
+AnalysisCache::FileStamp AnalysisCache::stamp(const std::string& path) {
+    FileStamp s;
+    std::error_code ec;
+    s.size = fs::file_size(path, ec);
+    if (ec)
+        return s;
+    const auto mtime = fs::last_write_time(path, ec);
+    if (ec)
+        return s;
+    s.mtime = static_cast<long long>(mtime.time_since_epoch().count());
+    s.valid = true;
+    return s;
+}
+
+std::string AnalysisCache::pathKey(const std::string& path) {
+    std::error_code ec;
+    const fs::path abs = fs::absolute(path, ec);
+    return ec ? path : abs.lexically_normal().string();
+}
+
+std::string AnalysisCache::pathEntryFile(const std::string& key) const {
+    return (fs::path(m_dir) / "paths" / hashString(key)).string();
+}
+
+std::string AnalysisCache::resultFile(const std::string& audioDigest) const {
+    return (fs::path(m_dir) / "results" / m_signatureHash / audioDigest).string();
+}
+
+bool AnalysisCache::lookup(const std::string& path, const FileStamp& stamp, AnalysisResult& out,
+                           std::string* digestOut) const {
+    if (digestOut)
+        digestOut->clear();
+    if (!stamp.valid)
+        return false;
+
+    const std::string key = pathKey(path);
+    std::string audioDigest;
+    AudioDecoder::Tags tags;
+
+    Entry pathEntry;
+    const bool pathEntryOk = readEntry(pathEntryFile(key), pathEntry) &&
+                             pathEntry.fields["path"] == key &&
+                             pathEntry.fields["size"] == std::to_string(stamp.size) &&
+                             pathEntry.fields["mtime"] == std::to_string(stamp.mtime);
+    if (pathEntryOk) {
+        // Fast path: file untouched since it was last seen.
+        audioDigest = pathEntry.fields["audio"];
+        for (const auto& [name, member] : kTagFields) {
+            tags.*member = pathEntry.fields[name];
+        }
+    } else {
+        // File changed or unknown: fingerprint the audio stream to find out
+        // whether only the metadata moved.
+        std::string error;
+        if (!AudioDecoder::probe(path, tags, audioDigest, error))
+            return false;
+    }
+    if (digestOut)
+        *digestOut = audioDigest;
+
+    Entry result;
+    if (!readEntry(resultFile(audioDigest), result) || result.fields["signature"] != m_signature)
+        return false;
+
+    const std::size_t numBeats = std::strtoul(result.fields["beatgrid"].c_str(), nullptr, 10);
+    if (result.values.size() != numBeats)
+        return false;
+
+    out.path = path;
+    out.bpm = std::strtof(result.fields["bpm"].c_str(), nullptr);
+    out.key = result.fields["key"];
+    out.camelot = result.fields["camelot"];
+    out.lufs = std::strtod(result.fields["lufs"].c_str(), nullptr);
+    out.replayGain = std::strtod(result.fields["replayGain"].c_str(), nullptr);
+    out.introSecs = std::strtod(result.fields["introSecs"].c_str(), nullptr);
+    out.outroSecs = std::strtod(result.fields["outroSecs"].c_str(), nullptr);
+    out.tags = std::move(tags);
+    out.beatgrid.clear();
+    out.beatgrid.reserve(numBeats);
+    for (const std::string& v : result.values) {
+        out.beatgrid.push_back(std::strtod(v.c_str(), nullptr));
+    }
+
+    if (!pathEntryOk)
+        storePathEntry(key, stamp, audioDigest, out.tags);
+    return true;
+}
+
+void AnalysisCache::store(const std::string& path, const FileStamp& stamp,
+                          const std::string& audioDigest, const AnalysisResult& result) const {
+    if (!stamp.valid || audioDigest.empty())
+        return;
+
+    std::ostringstream os;
+    os << "signature " << escapeValue(m_signature) << '\n';
+    os << "bpm " << formatDouble(result.bpm) << '\n';
+    os << "key " << escapeValue(result.key) << '\n';
+    os << "camelot " << escapeValue(result.camelot) << '\n';
+    os << "lufs " << formatDouble(result.lufs) << '\n';
+    os << "replayGain " << formatDouble(result.replayGain) << '\n';
+    os << "introSecs " << formatDouble(result.introSecs) << '\n';
+    os << "outroSecs " << formatDouble(result.outroSecs) << '\n';
+    os << "beatgrid " << result.beatgrid.size() << '\n';
+    for (double beat : result.beatgrid) {
+        os << formatDouble(beat) << '\n';
+    }
+    writeEntryAtomically(resultFile(audioDigest), os.str());
+
+    storePathEntry(pathKey(path), stamp, audioDigest, result.tags);
+}
+
+void AnalysisCache::storePathEntry(const std::string& key, const FileStamp& stamp,
+                                   const std::string& audioDigest,
+                                   const AudioDecoder::Tags& tags) const {
+    std::ostringstream os;
+    os << "path " << escapeValue(key) << '\n';
+    os << "size " << stamp.size << '\n';
+    os << "mtime " << stamp.mtime << '\n';
+    os << "audio " << audioDigest << '\n';
+    for (const auto& [name, member] : kTagFields) {
+        os << name << ' ' << escapeValue(tags.*member) << '\n';
+    }
+    writeEntryAtomically(pathEntryFile(key), os.str());
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "AnalysisResult.h"
+
+// On-disk cache of analysis results, safe to share between threads and
+// between concurrently running processes.
+//
+// Layout under the cache directory:
+//   paths/<hash of absolute path>         size, mtime, audio digest and tags
+//   results/<hash of signature>/<digest>  analysis results incl. beatgrid
+//
+// Results are keyed by the digest of the compressed audio stream (see
+// AudioDecoder::probe), not by the file, so a retag that rewrites ID3 frames
+// only costs a demux pass to re-read tags. The signature identifies the
+// analyzer configuration; entries written under another signature or format
+// version are never read. Every file is written to a unique temporary name
+// and renamed into place, so readers see either the old or the new entry.
+class AnalysisCache {
+  public:
+    // Size and modification time of a file, captured before it is analyzed.
+    struct FileStamp {
+        bool valid = false;
+        std::uintmax_t size = 0;
+        long long mtime = 0;
+    };
+
+    AnalysisCache(std::string dir, std::string signature);
+
+    // Creates the cache directories. Returns false with 'error' set on failure.
+    bool open(std::string& error);
+
+    static FileStamp stamp(const std::string& path);
+
+    // Returns true and fills 'out' on a hit. A path entry whose size and
+    // mtime match 'stamp' is trusted as is; otherwise the audio stream is
+    // re-fingerprinted and a result stored under the same digest is reused
+    // together with freshly read tags. On a miss, 'digestOut' (if not null)
+    // receives the audio digest the lookup found or computed on the way, or
+    // is left empty, so the caller can store a new result without probing
+    // again.
+    bool lookup(const std::string& path, const FileStamp& stamp, AnalysisResult& out,
+                std::string* digestOut = nullptr) const;
+
+    // Records a freshly analyzed result. Failures are silently ignored; the
+    // cache is an optimization only.
+    void store(const std::string& path, const FileStamp& stamp, const std::string& audioDigest,
+               const AnalysisResult& result) const;
+
+  private:
+    // Absolute, lexically normalized form of 'path' used as its cache key.
+    static std::string pathKey(const std::string& path);
+    std::string pathEntryFile(const std::string& key) const;
+    std::string resultFile(const std::string& audioDigest) const;
+
+    void storePathEntry(const std::string& key, const FileStamp& stamp,
+                        const std::string& audioDigest, const AudioDecoder::Tags& tags) const;
+
+    std::string m_dir;
+    std::string m_signature;
+    std::string m_signatureHash;
+};
@@ -0,0 +1,43 @@
+#include "AnalysisPipeline.h"
+
+AnalysisPipeline::AnalysisPipeline(std::vector<Stage> stages, std::size_t queueDepth) {
+    m_workers.resize(stages.size());
+    for (std::size_t i = 0; i < stages.size(); ++i) {
+        Worker& w = m_workers[i];
+        w.stage = std::move(stages[i]);
+        w.queue = std::make_unique<SpscRingBuffer<Chunk>>(queueDepth);
+        w.thread = std::thread([&w]() {
+            while (Chunk* chunk = w.queue->beginRead()) {
+                w.stage(chunk->samples.data(), chunk->numFrames);
+                w.queue->commitRead();
+            }
+        });
+    }
+}
+
+AnalysisPipeline::~AnalysisPipeline() {
+    finish();
+}
+
+void AnalysisPipeline::feed(const float* interleavedStereo, int numFrames) {
+    const std::size_t count = static_cast<std::size_t>(numFrames) * 2;
+    for (Worker& w : m_workers) {
+        Chunk& chunk = w.queue->beginWrite();
+        chunk.samples.assign(interleavedStereo, interleavedStereo + count);
+        chunk.numFrames = numFrames;
+        w.queue->commitWrite();
+    }
+}
+
+void AnalysisPipeline::finish() {
+    if (m_finished)
+        return;
+    m_finished = true;
+    for (Worker& w : m_workers) {
+        w.queue->close();
+    }
+    for (Worker& w : m_workers) {
+        if (w.thread.joinable())
+            w.thread.join();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "SpscRingBuffer.h"
+
+// Runs several analyzers concurrently on one decoded stream.
+//
+// Every stage owns a consumer thread and a bounded SPSC ring of chunks.
+// feed() copies each decoded chunk into every stage's ring and returns once
+// all of them have accepted it, blocking while the slowest stage is a full
+// ring behind. Chunk boundaries are preserved, so every analyzer sees exactly
+// the same feed() calls as in the serial path and produces identical results.
+class AnalysisPipeline {
+  public:
+    // stage(samples, numFrames) receives interleaved stereo float32 chunks.
+    using Stage = std::function<void(const float*, int)>;
+
+    // queueDepth is the number of chunks each stage may lag behind feed().
+    explicit AnalysisPipeline(std::vector<Stage> stages, std::size_t queueDepth = 8);
+    ~AnalysisPipeline();
+
+    AnalysisPipeline(const AnalysisPipeline&) = delete;
+    AnalysisPipeline& operator=(const AnalysisPipeline&) = delete;
+
+    // Feed interleaved stereo float samples (numFrames * 2 floats).
+    void feed(const float* interleavedStereo, int numFrames);
+
+    // Signals end of stream and waits for every stage to drain. Idempotent;
+    // stages' results may be read once this returns.
+    void finish();
+
+  private:
+    struct Chunk {
+        std::vector<float> samples;
+        int numFrames = 0;
+    };
+
+    struct Worker {
+        Stage stage;
+        std::unique_ptr<SpscRingBuffer<Chunk>> queue;
+        std::thread thread;
+    };
+
+    std::vector<Worker> m_workers;
+    bool m_finished = false;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "AudioDecoder.h"
+
+// Which analyzers run on a file. Unselected analyzers are never constructed
+// or fed, and their result fields are left at zero / empty.
+struct AnalyzerSelection {
+    bool bpm = true;      // bpm, beatgrid
+    bool key = true;      // key, camelot
+    bool gain = true;     // lufs, replayGain
+    bool silence = true;  // introSecs, outroSecs
+    // introSecs only, found without reading past the first non-silent frame;
+    // implied by 'silence'.
+    bool intro = false;
+
+    bool all() const { return bpm && key && gain && silence; }
+    bool anyIntro() const { return silence || intro; }
+};
+
+// Everything reported for one analyzed file.
+struct AnalysisResult {
+    std::string path;
+    float bpm;
+    std::string key;
+    std::string camelot;
+    double lufs;
+    double replayGain;
+    double introSecs;
+    double outroSecs;
+    AudioDecoder::Tags tags;
+    std::vector<double> beatgrid;
+    // Analyzers that produced the fields above.
+    AnalyzerSelection analyzers;
+    // bpm and key were estimated from excerpts (--fast) rather than the
+    // whole track.
+    bool approximate = false;
+};
@@ -0,0 +1,296 @@
+#include "AnalysisServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <utility>
+
+#include "JsonFormat.h"
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Reads one line without its terminator. Returns false at EOF with nothing read.
+bool readLine(std::FILE* in, std::string& line) {
+    line.clear();
+    char buf[4096];
+    while (std::fgets(buf, sizeof(buf), in)) {
+        line += buf;
+        if (!line.empty() && line.back() == '\n') {
+            line.pop_back();
+            return true;
+        }
+    }
+    return !line.empty();
+}
+
+// Applies the per-request options of 'request' to 'options'. Options that
+// select what is computed, and so key cached results, are fixed for the
+// whole server and rejected here. Returns false with 'error' set on a
+// rejected, mistyped or conflicting option.
+bool applyRequestOptions(const std::map<std::string, JsonValue>& request, AnalyzeOptions& options,
+                         std::string& error) {
+    for (const char* fixed : {"only", "qm_rate", "float32"}) {
+        if (request.count(fixed)) {
+            error = std::string("\"") + fixed + "\" cannot be set per request";
+            return false;
+        }
+    }
+    for (const auto& [name, flag] :
+         {std::make_pair("pipeline", &AnalyzeOptions::pipelined),
+          std::make_pair("fast", &AnalyzeOptions::fast)}) {
+        auto field = request.find(name);
+        if (field == request.end())
+            continue;
+        if (field->second.type != JsonValue::Type::Bool) {
+            error = std::string("\"") + name + "\" expects true or false";
+            return false;
+        }
+        options.*flag = field->second.text == "true";
+    }
+    auto preview = request.find("preview");
+    if (preview != request.end()) {
+        const double secs = preview->second.type == JsonValue::Type::Number
+                                ? std::strtod(preview->second.text.c_str(), nullptr)
+                                : 0.0;
+        if (!(secs > 0.0) || !std::isfinite(secs)) {
+            error = "\"preview\" expects a positive number of seconds";
+            return false;
+        }
+        options.previewSecs = secs;
+    }
+    if (options.fast && options.previewSecs > 0.0) {
+        error = "\"fast\" and \"preview\" cannot be combined";
+        return false;
+    }
+    if (options.fast && !options.analyzers.bpm && !options.analyzers.key) {
+        error = "\"fast\" only estimates bpm and key";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+class AnalysisServer::Responder {
+  public:
+    explicit Responder(std::FILE* out) : m_file(out) {}
+    explicit Responder(int fd) : m_fd(fd) {}
+
+    ~Responder() {
+#ifndef _WIN32
+        if (m_fd >= 0)
+            ::close(m_fd);
+#endif
+    }
+
+    // Writes 'record' plus a newline as one unit and flushes it. Responses to
+    // a client that has gone away are dropped.
+    void write(const std::string& record) {
+        const std::string line = record + "\n";
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_file) {
+            std::fwrite(line.data(), 1, line.size(), m_file);
+            std::fflush(m_file);
+            return;
+        }
+#ifndef _WIN32
+        std::size_t written = 0;
+        while (m_fd >= 0 && written < line.size()) {
+            const ssize_t n = ::write(m_fd, line.data() + written, line.size() - written);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return;
+            written += static_cast<std::size_t>(n);
+        }
+#endif
+    }
+
+  private:
+    std::mutex m_mutex;
+    std::FILE* m_file = nullptr;
+    int m_fd = -1;
+};
+
+AnalysisServer::AnalysisServer(const AnalyzeOptions& defaults, int numWorkers)
+    : m_defaults(defaults) {
+    for (int i = 0; i < std::max(numWorkers, 1); ++i) {
+        m_workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+AnalysisServer::~AnalysisServer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+    for (auto& t : m_workers) {
+        t.join();
+    }
+}
+
+void AnalysisServer::serveStream(std::FILE* in, std::FILE* out) {
+    auto responder = std::make_shared<Responder>(out);
+    std::string line;
+    while (readLine(in, line)) {
+        handleLine(line, responder);
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [&] { return m_jobs.empty() && m_numRunning == 0; });
+}
+
+bool AnalysisServer::serveSocket(const std::string& socketPath, std::string& error) {
+#ifdef _WIN32
+    (void)socketPath;
+    error = "Unix domain sockets are not supported on this platform";
+    return false;
+#else
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        error = "Socket path too long: '" + socketPath + "'";
+        return false;
+    }
+    std::memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    // A socket file left behind by a previous instance would make bind() fail.
+    std::error_code ec;
+    if (std::filesystem::is_socket(socketPath, ec))
+        ::unlink(socketPath.c_str());
+
+    const int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    if (::bind(listenFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listenFd, 16) < 0) {
+        error = "Cannot listen on '" + socketPath + "': " + std::strerror(errno);
+        ::close(listenFd);
+        return false;
+    }
+
+    // A client disconnecting before its responses are written must not kill
+    // the server.
+    ::signal(SIGPIPE, SIG_IGN);
+
+    while (true) {
+        const int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            error = std::string("accept: ") + std::strerror(errno);
+            ::close(listenFd);
+            return false;
+        }
+        // One reader thread per connection; it lives as long as the client
+        // keeps the connection open. The server itself is never destroyed
+        // while accepting, so capturing 'this' is safe.
+        std::thread([this, fd]() {
+            auto responder = std::make_shared<Responder>(fd);
+            std::string pending;
+            char buf[4096];
+            while (true) {
+                const ssize_t n = ::read(fd, buf, sizeof(buf));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    break;
+                pending.append(buf, static_cast<std::size_t>(n));
+                std::size_t start = 0;
+                for (std::size_t nl; (nl = pending.find('\n', start)) != std::string::npos;
+                     start = nl + 1) {
+                    handleLine(pending.substr(start, nl - start), responder);
+                }
+                pending.erase(0, start);
+            }
+            if (!pending.empty())
+                handleLine(pending, responder);
+        }).detach();
+    }
+#endif
+}
+
+void AnalysisServer::handleLine(const std::string& line,
+                                const std::shared_ptr<Responder>& responder) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos)
+        return;
+
+    std::map<std::string, JsonValue> request;
+    std::string error;
+    if (!parseJsonObject(line, request, error)) {
+        responder->write(formatJsonError("", "Invalid request: " + error, "\"id\": null"));
+        return;
+    }
+
+    Job job;
+    auto id = request.find("id");
+    job.idField = "\"id\": " + (id != request.end() ? id->second.raw : std::string("null"));
+
+    auto path = request.find("path");
+    if (path == request.end() || path->second.type != JsonValue::Type::String ||
+        path->second.text.empty()) {
+        responder->write(formatJsonError("", "Invalid request: missing \"path\"", job.idField));
+        return;
+    }
+    job.path = path->second.text;
+
+    job.options = m_defaults;
+    if (!applyRequestOptions(request, job.options, error)) {
+        responder->write(formatJsonError(job.path, "Invalid request: " + error, job.idField));
+        return;
+    }
+
+    job.responder = responder;
+    enqueue(std::move(job));
+}
+
+void AnalysisServer::enqueue(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_jobAvailable.notify_one();
+}
+
+void AnalysisServer::workerLoop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [&] { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty())
+                return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            ++m_numRunning;
+        }
+
+        AnalysisResult result;
+        std::string error;
+        if (analyzeFile(job.path, job.options, result, error))
+            job.responder->write(formatJsonRecord(result, false, job.idField));
+        else
+            job.responder->write(formatJsonError(job.path, error, job.idField));
+        job.responder.reset();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_numRunning;
+        }
+        m_idle.notify_all();
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FileAnalysis.h"
+
+// Long-running analysis service for --serve.
+//
+// Requests are newline-delimited JSON objects such as
+//   {"id": 7, "path": "/music/track.mp3", "pipeline": true}
+// read from stdin or from connections to a Unix domain socket. Each one is
+// queued to a pool of worker threads that stays warm between requests, and
+// answered on the same stream with a single-line --ndjson record carrying the
+// request's "id" (echoed verbatim, any JSON scalar). Responses are written as
+// soon as each file is done, so they may arrive out of request order.
+//
+// Besides "pipeline", a request may set "fast" and "preview" (seconds).
+// "only", "qm_rate" and "float32" decide what a cached result holds, so they
+// are fixed when the server starts; a request setting them gets an error.
+class AnalysisServer {
+  public:
+    // 'defaults' applies to every request; per-request fields override it.
+    AnalysisServer(const AnalyzeOptions& defaults, int numWorkers);
+    ~AnalysisServer();
+
+    AnalysisServer(const AnalysisServer&) = delete;
+    AnalysisServer& operator=(const AnalysisServer&) = delete;
+
+    // Serves requests from 'in' until EOF, answering on 'out', then waits for
+    // the outstanding ones to finish.
+    void serveStream(std::FILE* in, std::FILE* out);
+
+    // Listens on a Unix domain socket at 'socketPath' (replacing a stale
+    // socket file) and serves every connection until the process is killed.
+    // Returns false with 'error' set if the socket cannot be set up.
+    bool serveSocket(const std::string& socketPath, std::string& error);
+
+  private:
+    // Where responses for one client go. Shared by the jobs of that client so
+    // a socket stays open until its last response has been written.
+    class Responder;
+
+    struct Job {
+        std::string idField;  // "\"id\": <raw id>" or empty
+        std::string path;
+        AnalyzeOptions options;
+        std::shared_ptr<Responder> responder;
+    };
+
+    // Parses one request line and queues it, or answers it with an error.
+    void handleLine(const std::string& line, const std::shared_ptr<Responder>& responder);
+    void enqueue(Job job);
+    void workerLoop();
+
+    AnalyzeOptions m_defaults;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::condition_variable m_idle;
+    std::deque<Job> m_jobs;
+    std::size_t m_numRunning = 0;
+    bool m_stopping = false;
+};
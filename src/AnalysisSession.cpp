@@ -0,0 +1,123 @@
+#include "AnalysisSession.h"
+
+#include "AnalysisPipeline.h"
+#include "DownmixAndOverlapHelper.h"
+#include "GainAnalyzer.h"
+#include "QmBpmAnalyzer.h"
+#include "QmKeyAnalyzer.h"
+#include "SilenceAnalyzer.h"
+
+AnalysisSession::AnalysisSession(int sampleRate, bool pipelined,
+                                 const AnalyzerSelection& analyzers, int qmSampleRate,
+                                 bool singlePrecision)
+    : m_analyzers(analyzers) {
+    m_reduced = qmSampleRate > 0 && qmSampleRate != sampleRate;
+    const int qmRate = m_reduced ? qmSampleRate : sampleRate;
+    if (analyzers.bpm)
+        m_bpm = std::make_unique<QmBpmAnalyzer>(qmRate, singlePrecision);
+    if (analyzers.key)
+        m_key = std::make_unique<QmKeyAnalyzer>(qmRate, singlePrecision);
+    if (analyzers.gain)
+        m_gain = std::make_unique<GainAnalyzer>(sampleRate);
+    if (analyzers.anyIntro())
+        m_silence = std::make_unique<SilenceAnalyzer>(sampleRate, 2, !analyzers.silence);
+
+    if (pipelined) {
+        // Gain and silence are cheap; they share a stage so the QM analyzers
+        // each get a core of their own. Those stages downmix on their own
+        // threads: handing them a shared mono buffer would cost a copy of
+        // the same size as the downmix itself.
+        std::vector<AnalysisPipeline::Stage> qmStages;
+        if (m_bpm)
+            qmStages.push_back([this](const float* s, int n) { m_bpm->feed(s, n); });
+        if (m_key)
+            qmStages.push_back([this](const float* s, int n) { m_key->feed(s, n); });
+        std::vector<AnalysisPipeline::Stage> stages;
+        if (m_reduced) {
+            if (!qmStages.empty())
+                m_reducedPipeline = std::make_unique<AnalysisPipeline>(std::move(qmStages));
+        } else {
+            stages = std::move(qmStages);
+        }
+        if (m_gain || m_silence) {
+            stages.push_back([this](const float* s, int n) {
+                if (m_gain)
+                    m_gain->feed(s, n);
+                if (m_silence)
+                    feedSilence(s, n);
+            });
+        }
+        if (!stages.empty())
+            m_pipeline = std::make_unique<AnalysisPipeline>(std::move(stages));
+    }
+}
+
+AnalysisSession::~AnalysisSession() = default;
+
+void AnalysisSession::feed(const float* interleavedStereo, int numFrames) {
+    if (m_pipeline) {
+        m_pipeline->feed(interleavedStereo, numFrames);
+        return;
+    }
+    if (!m_reduced)
+        feedQm(interleavedStereo, numFrames);
+    if (m_gain)
+        m_gain->feed(interleavedStereo, numFrames);
+    if (m_silence)
+        feedSilence(interleavedStereo, numFrames);
+}
+
+void AnalysisSession::feedReduced(const float* interleavedStereo, int numFrames) {
+    if (!m_reduced)
+        return;
+    if (m_reducedPipeline)
+        m_reducedPipeline->feed(interleavedStereo, numFrames);
+    else
+        feedQm(interleavedStereo, numFrames);
+}
+
+void AnalysisSession::feedQm(const float* interleavedStereo, int numFrames) {
+    if (m_bpm || m_key) {
+        if (m_mono.size() < static_cast<size_t>(numFrames))
+            m_mono.resize(numFrames);
+        downmixStereoToMono(interleavedStereo, m_mono.data(), numFrames);
+        if (m_bpm)
+            m_bpm->feedMono(m_mono.data(), numFrames);
+        if (m_key)
+            m_key->feedMono(m_mono.data(), numFrames);
+    }
+}
+
+void AnalysisSession::feedSilence(const float* interleavedStereo, int numFrames) {
+    m_silence->feed(interleavedStereo, numFrames);
+    if (m_silence->done())
+        m_silenceDone.store(true, std::memory_order_relaxed);
+}
+
+bool AnalysisSession::done() const {
+    return !m_bpm && !m_key && !m_gain &&
+           (!m_silence || m_silenceDone.load(std::memory_order_relaxed));
+}
+
+void AnalysisSession::finish(AnalysisResult& out) {
+    if (m_pipeline)
+        m_pipeline->finish();
+    if (m_reducedPipeline)
+        m_reducedPipeline->finish();
+
+    GainAnalyzer::Result gainResult{};
+    bool gainOk = m_gain && m_gain->result(gainResult);
+    QmKeyAnalyzer::Result detectedKey = m_key ? m_key->result() : QmKeyAnalyzer::Result{};
+    SilenceAnalyzer::Result silenceResult =
+        m_silence ? m_silence->result() : SilenceAnalyzer::Result{};
+
+    out.bpm = m_bpm ? m_bpm->result() : 0.0f;
+    out.key = detectedKey.key;
+    out.camelot = detectedKey.camelot;
+    out.lufs = gainOk ? gainResult.lufs : 0.0;
+    out.replayGain = gainOk ? gainResult.replayGain : 0.0;
+    out.introSecs = silenceResult.introSecs;
+    out.outroSecs = m_analyzers.silence ? silenceResult.outroSecs : 0.0;
+    out.beatgrid = m_bpm ? m_bpm->beatFramesSecs() : std::vector<double>{};
+    out.analyzers = m_analyzers;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "AnalysisResult.h"
+
+class AnalysisPipeline;
+class GainAnalyzer;
+class QmBpmAnalyzer;
+class QmKeyAnalyzer;
+class SilenceAnalyzer;
+
+// The selected analyzers for one stream of interleaved stereo float32 audio,
+// fed either in turn on the caller's thread or through an AnalysisPipeline.
+// Shared by file analysis and the C streaming API.
+class AnalysisSession {
+  public:
+    // If qmSampleRate is nonzero and differs from sampleRate, the bpm and key
+    // analyzers run at that rate and are fed through feedReduced() instead of
+    // feed(), which then only reaches gain and silence. singlePrecision runs
+    // their DSP in float instead of double.
+    AnalysisSession(int sampleRate, bool pipelined, const AnalyzerSelection& analyzers = {},
+                    int qmSampleRate = 0, bool singlePrecision = false);
+    ~AnalysisSession();
+
+    AnalysisSession(const AnalysisSession&) = delete;
+    AnalysisSession& operator=(const AnalysisSession&) = delete;
+
+    // Feed interleaved stereo float samples (numFrames * 2 floats).
+    void feed(const float* interleavedStereo, int numFrames);
+
+    // Feed the same audio at qmSampleRate, when the session has one.
+    void feedReduced(const float* interleavedStereo, int numFrames);
+
+    // True once no selected analyzer needs more audio, so the stream may be
+    // cut short. Only an intro-only scan ever finishes early. In pipelined
+    // mode this lags behind feed() by up to the pipeline's queue depth.
+    bool done() const;
+
+    // Ends the stream and fills every analysis field of 'out' (all but path
+    // and tags), zeroing those of unselected analyzers. Call once, after the
+    // last feed().
+    void finish(AnalysisResult& out);
+
+  private:
+    void feedQm(const float* interleavedStereo, int numFrames);
+    void feedSilence(const float* interleavedStereo, int numFrames);
+
+    std::unique_ptr<QmBpmAnalyzer> m_bpm;
+    std::unique_ptr<QmKeyAnalyzer> m_key;
+    std::unique_ptr<GainAnalyzer> m_gain;
+    std::unique_ptr<SilenceAnalyzer> m_silence;
+    AnalyzerSelection m_analyzers;
+    // The QM analyzers are fed through feedReduced().
+    bool m_reduced = false;
+    // Set by whichever thread feeds m_silence once it is done().
+    std::atomic<bool> m_silenceDone{false};
+    // Serial mode downmixes each chunk once here for both QM analyzers.
+    std::vector<double> m_mono;
+    // Declared last so their threads stop before the analyzers are destroyed.
+    // With a reduced rate the QM analyzers get a pipeline of their own.
+    std::unique_ptr<AnalysisPipeline> m_pipeline;
+    std::unique_ptr<AnalysisPipeline> m_reducedPipeline;
+};
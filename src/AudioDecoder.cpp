@@ -8,9 +8,13 @@ extern "C" {
 #include <libswresample/swresample.h>
 }
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <vector>
 
+#include "StreamHasher.h"
+
 namespace {
 
 // RAII helpers
@@ -36,27 +40,29 @@ std::string avError(int err) {
     return buf;
 }
 
-}  // namespace
+using FormatContextPtr = std::unique_ptr<AVFormatContext, FormatContextDeleter>;
+using SwrContextPtr = std::unique_ptr<SwrContext, SwrContextDeleter>;
 
-bool AudioDecoder::decode(const std::string &path, Callback cb, std::string &error, Tags &tagsOut) {
+FormatContextPtr openInput(const std::string &path, std::string &error) {
     av_log_set_level(AV_LOG_ERROR);  // suppress decoder warnings (timestamp drift etc.)
 
-    // --- Open container ---
     AVFormatContext *rawFmt = nullptr;
     if (int err = avformat_open_input(&rawFmt, path.c_str(), nullptr, nullptr); err < 0) {
         error = "avformat_open_input: " + avError(err);
-        return false;
+        return nullptr;
     }
-    std::unique_ptr<AVFormatContext, FormatContextDeleter> fmt(rawFmt);
+    FormatContextPtr fmt(rawFmt);
 
     if (int err = avformat_find_stream_info(fmt.get(), nullptr); err < 0) {
         error = "avformat_find_stream_info: " + avError(err);
-        return false;
+        return nullptr;
     }
+    return fmt;
+}
 
-    // --- Extract metadata tags into a local struct; assigned to tagsOut only on success ---
-    // av_dict_get with flags=0 is case-insensitive by default.
-    Tags tags;
+// av_dict_get with flags=0 is case-insensitive by default.
+AudioDecoder::Tags readTags(const AVFormatContext *fmt) {
+    AudioDecoder::Tags tags;
     auto getTag = [&](const char *key) -> std::string {
         AVDictionaryEntry *e = av_dict_get(fmt->metadata, key, nullptr, 0);
         return e ? std::string(e->value) : std::string{};
@@ -78,14 +84,89 @@ bool AudioDecoder::decode(const std::string &path, Callback cb, std::string &err
     // "date" tag is often "2003" or "2003-01-15"; take first 4 chars as year
     std::string date = getTag("date");
     tags.year = date.size() >= 4 ? date.substr(0, 4) : date;
+    return tags;
+}
+
+// Seeds an audio digest with the stream parameters that affect decoding.
+void hashStreamParameters(StreamHasher &hasher, const AVCodecParameters *par) {
+    const int64_t params[] = {static_cast<int64_t>(par->codec_id), par->sample_rate,
+                              par->format};
+    hasher.update(params, sizeof(params));
+}
+
+
+// Creates a resampler from the decoder's output to stereo interleaved float32
+// at outSampleRate.
+SwrContextPtr makeResampler(const AVCodecContext *codecCtx, int outSampleRate,
+                            std::string &error) {
+    SwrContext *rawSwr = nullptr;
+
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 28, 100)
+    // FFmpeg >= 5.1: new channel layout API
+    AVChannelLayout outLayout = AV_CHANNEL_LAYOUT_STEREO;
+    if (int err = swr_alloc_set_opts2(&rawSwr, &outLayout, AV_SAMPLE_FMT_FLT, outSampleRate,
+                                      &codecCtx->ch_layout, codecCtx->sample_fmt,
+                                      codecCtx->sample_rate, 0, nullptr);
+        err < 0) {
+        error = "swr_alloc_set_opts2: " + avError(err);
+        return nullptr;
+    }
+#else
+    // FFmpeg < 5.1: legacy channel layout API
+    rawSwr = swr_alloc_set_opts(
+        nullptr, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLT, outSampleRate,
+        static_cast<int64_t>(codecCtx->channel_layout
+                                 ? codecCtx->channel_layout
+                                 : av_get_default_channel_layout(codecCtx->channels)),
+        codecCtx->sample_fmt, codecCtx->sample_rate, 0, nullptr);
+    if (rawSwr == nullptr) {
+        error = "swr_alloc_set_opts failed";
+        return nullptr;
+    }
+#endif
+    SwrContextPtr swr(rawSwr);
+
+    if (int err = swr_init(swr.get()); err < 0) {
+        error = "swr_init: " + avError(err);
+        return nullptr;
+    }
+    return swr;
+}
+
+// A demuxer positioned on the best audio stream, with its decoder and the
+// resamplers to interleaved stereo float32 at the native and, optionally, a
+// reduced rate.
+struct OpenStream {
+    FormatContextPtr fmt;
+    int streamIdx = -1;
+    std::unique_ptr<AVCodecContext, CodecContextDeleter> codecCtx;
+    SwrContextPtr swr;
+    bool passthrough = false;
+    AudioDecoder::AudioInfo info{0, 2};
+    SwrContextPtr reducedSwr;  // null unless a reduced stream is produced
+    AudioDecoder::AudioInfo reducedInfo{0, 2};
+    // Set by seekTo(); the next decoded frame then stores its position in
+    // stream frames in firstFrame, or -1 if it carries no timestamp.
+    bool positionPending = false;
+    long long firstFrame = -1;
+};
+
+// Opens 'path' for decoding. If reducedRate is below the native rate, a
+// second resampler to reducedRate is set up as well.
+bool openStream(const std::string &path, OpenStream &s, std::string &error,
+                int reducedRate = 0) {
+    // --- Open container ---
+    s.fmt = openInput(path, error);
+    if (!s.fmt)
+        return false;
 
     // --- Find best audio stream ---
-    int streamIdx = av_find_best_stream(fmt.get(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
-    if (streamIdx < 0) {
+    s.streamIdx = av_find_best_stream(s.fmt.get(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    if (s.streamIdx < 0) {
         error = "No audio stream found";
         return false;
     }
-    AVStream *stream = fmt->streams[streamIdx];
+    AVStream *stream = s.fmt->streams[s.streamIdx];
 
     // --- Set up decoder ---
     const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
@@ -93,16 +174,17 @@ bool AudioDecoder::decode(const std::string &path, Callback cb, std::string &err
         error = "Unsupported codec";
         return false;
     }
-    std::unique_ptr<AVCodecContext, CodecContextDeleter> codecCtx(avcodec_alloc_context3(codec));
+    s.codecCtx.reset(avcodec_alloc_context3(codec));
+    AVCodecContext *codecCtx = s.codecCtx.get();
     if (!codecCtx) {
         error = "avcodec_alloc_context3 failed";
         return false;
     }
-    if (int err = avcodec_parameters_to_context(codecCtx.get(), stream->codecpar); err < 0) {
+    if (int err = avcodec_parameters_to_context(codecCtx, stream->codecpar); err < 0) {
         error = "avcodec_parameters_to_context: " + avError(err);
         return false;
     }
-    if (int err = avcodec_open2(codecCtx.get(), codec, nullptr); err < 0) {
+    if (int err = avcodec_open2(codecCtx, codec, nullptr); err < 0) {
         error = "avcodec_open2: " + avError(err);
         return false;
     }
@@ -111,121 +193,387 @@ bool AudioDecoder::decode(const std::string &path, Callback cb, std::string &err
     const int outChannels = 2;
 
     // --- Set up resampler: any input format -> stereo interleaved float32 ---
-    SwrContext *rawSwr = nullptr;
+    s.swr = makeResampler(codecCtx, outSampleRate, error);
+    if (!s.swr)
+        return false;
 
+    // Streams already decoded as interleaved float stereo (e.g. 32-bit float
+    // WAV) skip the resampler; it would only copy the samples.
 #if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 28, 100)
-    // FFmpeg >= 5.1: new channel layout API
     AVChannelLayout outLayout = AV_CHANNEL_LAYOUT_STEREO;
-    if (int err = swr_alloc_set_opts2(&rawSwr, &outLayout, AV_SAMPLE_FMT_FLT, outSampleRate,
-                                      &codecCtx->ch_layout, codecCtx->sample_fmt,
-                                      codecCtx->sample_rate, 0, nullptr);
-        err < 0) {
-        error = "swr_alloc_set_opts2: " + avError(err);
-        return false;
-    }
+    s.passthrough = codecCtx->sample_fmt == AV_SAMPLE_FMT_FLT &&
+                    av_channel_layout_compare(&codecCtx->ch_layout, &outLayout) == 0;
 #else
-    // FFmpeg < 5.1: legacy channel layout API
-    rawSwr = swr_alloc_set_opts(
-        nullptr, AV_CH_LAYOUT_STEREO, AV_SAMPLE_FMT_FLT, outSampleRate,
-        static_cast<int64_t>(codecCtx->channel_layout
-                                 ? codecCtx->channel_layout
-                                 : av_get_default_channel_layout(codecCtx->channels)),
-        codecCtx->sample_fmt, codecCtx->sample_rate, 0, nullptr);
-    if (rawSwr == nullptr) {
-        error = "swr_alloc_set_opts failed";
-        return false;
-    }
+    s.passthrough =
+        codecCtx->sample_fmt == AV_SAMPLE_FMT_FLT && codecCtx->channels == outChannels &&
+        (codecCtx->channel_layout == 0 || codecCtx->channel_layout == AV_CH_LAYOUT_STEREO);
 #endif
-    std::unique_ptr<SwrContext, SwrContextDeleter> swr(rawSwr);
 
-    if (int err = swr_init(swr.get()); err < 0) {
-        error = "swr_init: " + avError(err);
-        return false;
+    s.info = AudioDecoder::AudioInfo{outSampleRate, outChannels};
+
+    if (reducedRate > 0 && reducedRate < outSampleRate) {
+        s.reducedSwr = makeResampler(codecCtx, reducedRate, error);
+        if (!s.reducedSwr)
+            return false;
+        s.reducedInfo = AudioDecoder::AudioInfo{reducedRate, outChannels};
+    }
+    return true;
+}
+
+// Converted audio waiting to be handed to a callback. It only grows when a
+// frame needs more room than any before, so steady-state decoding does not
+// allocate.
+class ChunkBuffer {
+  public:
+    ChunkBuffer(int capacityFrames, int channels)
+        : m_samples(static_cast<size_t>(capacityFrames) * channels), m_channels(channels) {}
+
+    // Returns where the next 'frames' frames go, growing the buffer if needed.
+    float *tail(int frames) {
+        const size_t needed = static_cast<size_t>(m_frames + frames) * m_channels;
+        if (m_samples.size() < needed)
+            m_samples.resize(needed);
+        return m_samples.data() + static_cast<size_t>(m_frames) * m_channels;
+    }
+
+    // Runs 'frames' frames of f through swr into the buffer.
+    void convert(SwrContext *swr, const AVFrame *f) {
+        const int maxOut = f->nb_samples + 256;
+        uint8_t *dst = reinterpret_cast<uint8_t *>(tail(maxOut));
+        int converted = swr_convert(swr, &dst, maxOut, const_cast<const uint8_t **>(f->data),
+                                    f->nb_samples);
+        if (converted > 0)
+            m_frames += converted;
     }
 
+    // Drains what swr still holds into the buffer.
+    void drain(SwrContext *swr, int outSampleRate) {
+        const int maxOut = swr_get_delay(swr, outSampleRate) + 256;
+        if (maxOut > 0) {
+            uint8_t *dst = reinterpret_cast<uint8_t *>(tail(maxOut));
+            int converted = swr_convert(swr, &dst, maxOut, nullptr, 0);
+            if (converted > 0)
+                m_frames += converted;
+        }
+    }
+
+    void append(int frames) { m_frames += frames; }
+    const float *data() const { return m_samples.data(); }
+    int frames() const { return m_frames; }
+    void clear() { m_frames = 0; }
+
+  private:
+    std::vector<float> m_samples;
+    int m_channels;
+    int m_frames = 0;
+};
+
+// Decodes from the current read position to EOF, feeding every packet of the
+// audio stream to 'hasher' if non-null, and the reduced-rate stream to
+// reducedCb if s has one. Returns false if cb stopped decoding first, in which
+// case the decoder and resamplers are left holding audio that was never
+// delivered.
+bool decodeToEnd(OpenStream &s, const AudioDecoder::Callback &cb, StreamHasher *hasher,
+                 const std::function<void(const float *, int, const AudioDecoder::AudioInfo &)>
+                     &reducedCb = nullptr) {
+    AVCodecContext *codecCtx = s.codecCtx.get();
+    SwrContext *swr = s.swr.get();
+    SwrContext *reducedSwr = reducedCb ? s.reducedSwr.get() : nullptr;
+    const AudioDecoder::AudioInfo info = s.info;
+    const int outChannels = info.channels;
+
     std::unique_ptr<AVPacket, PacketDeleter> pkt(av_packet_alloc());
     std::unique_ptr<AVFrame, FrameDeleter> frame(av_frame_alloc());
 
-    const AudioInfo info{outSampleRate, outChannels};
-
-    // Buffer to accumulate converted output before calling cb
+    // Decoded audio is converted straight into this chunk, which is handed to
+    // cb once it holds at least kChunkFrames frames, together with the same
+    // stretch of audio at the reduced rate. Once cb returns false nothing more
+    // is read or decoded.
     constexpr int kChunkFrames = 8192;
-    std::vector<float> outBuf;
-    outBuf.reserve(kChunkFrames * outChannels);
+    ChunkBuffer chunk(kChunkFrames * 2, outChannels);
+    ChunkBuffer reducedChunk(reducedSwr ? kChunkFrames * 2 : 0, outChannels);
+    bool stopped = false;
 
     auto flushBuf = [&]() {
-        if (!outBuf.empty()) {
-            cb(outBuf.data(), static_cast<int>(outBuf.size()) / outChannels, info);
-            outBuf.clear();
+        if (chunk.frames() > 0) {
+            stopped = !cb(chunk.data(), chunk.frames(), info);
+            chunk.clear();
+        }
+        if (reducedChunk.frames() > 0) {
+            reducedCb(reducedChunk.data(), reducedChunk.frames(), s.reducedInfo);
+            reducedChunk.clear();
         }
     };
 
     auto convertAndBuffer = [&](AVFrame *f) {
-        const int maxOut = f->nb_samples + 256;
-        std::vector<float> tmp(maxOut * outChannels);
-        uint8_t *dst = reinterpret_cast<uint8_t *>(tmp.data());
-
-        int converted = swr_convert(swr.get(), &dst, maxOut, const_cast<const uint8_t **>(f->data),
-                                    f->nb_samples);
-        if (converted < 0)
-            return;
-
-        size_t prev = outBuf.size();
-        outBuf.resize(prev + converted * outChannels);
-        std::copy(tmp.begin(), tmp.begin() + converted * outChannels, outBuf.begin() + prev);
+        if (s.passthrough && f->format == AV_SAMPLE_FMT_FLT) {
+            std::memcpy(chunk.tail(f->nb_samples), f->data[0],
+                        static_cast<size_t>(f->nb_samples) * outChannels * sizeof(float));
+            chunk.append(f->nb_samples);
+        } else {
+            chunk.convert(swr, f);
+        }
+        if (reducedSwr)
+            reducedChunk.convert(reducedSwr, f);
 
-        if (static_cast<int>(outBuf.size()) / outChannels >= kChunkFrames) {
+        if (chunk.frames() >= kChunkFrames) {
             flushBuf();
         }
     };
 
+    auto notePosition = [&](const AVFrame *f) {
+        s.positionPending = false;
+        const AVStream *stream = s.fmt->streams[s.streamIdx];
+        const int64_t ts = f->best_effort_timestamp;
+        if (ts == AV_NOPTS_VALUE) {
+            s.firstFrame = -1;
+            return;
+        }
+        const int64_t streamStart = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        s.firstFrame = av_rescale_q(ts - streamStart, stream->time_base,
+                                    AVRational{1, codecCtx->sample_rate});
+    };
+
     // --- Decode loop ---
-    while (av_read_frame(fmt.get(), pkt.get()) >= 0) {
-        if (pkt->stream_index != streamIdx) {
+    while (!stopped && av_read_frame(s.fmt.get(), pkt.get()) >= 0) {
+        if (pkt->stream_index != s.streamIdx) {
             av_packet_unref(pkt.get());
             continue;
         }
-        avcodec_send_packet(codecCtx.get(), pkt.get());
+        if (hasher)
+            hasher->update(pkt->data, static_cast<size_t>(pkt->size));
+        avcodec_send_packet(codecCtx, pkt.get());
         av_packet_unref(pkt.get());
 
-        while (true) {
-            int err = avcodec_receive_frame(codecCtx.get(), frame.get());
+        while (!stopped) {
+            int err = avcodec_receive_frame(codecCtx, frame.get());
             if (err == AVERROR(EAGAIN) || err == AVERROR_EOF)
                 break;
             if (err < 0)
                 break;
+            if (s.positionPending)
+                notePosition(frame.get());
             convertAndBuffer(frame.get());
             av_frame_unref(frame.get());
         }
     }
 
     // Flush decoder
-    avcodec_send_packet(codecCtx.get(), nullptr);
-    while (true) {
-        int err = avcodec_receive_frame(codecCtx.get(), frame.get());
+    if (!stopped)
+        avcodec_send_packet(codecCtx, nullptr);
+    while (!stopped) {
+        int err = avcodec_receive_frame(codecCtx, frame.get());
         if (err == AVERROR_EOF || err < 0)
             break;
         convertAndBuffer(frame.get());
         av_frame_unref(frame.get());
     }
 
-    // Flush resampler
-    {
-        const int maxOut = swr_get_delay(swr.get(), outSampleRate) + 256;
-        if (maxOut > 0) {
-            std::vector<float> tmp(maxOut * outChannels);
-            uint8_t *dst = reinterpret_cast<uint8_t *>(tmp.data());
-            int converted = swr_convert(swr.get(), &dst, maxOut, nullptr, 0);
-            if (converted > 0) {
-                size_t prev = outBuf.size();
-                outBuf.resize(prev + converted * outChannels);
-                std::copy(tmp.begin(), tmp.begin() + converted * outChannels,
-                          outBuf.begin() + prev);
-            }
-        }
+    // Flush resamplers
+    if (!stopped) {
+        chunk.drain(swr, info.sampleRate);
+        if (reducedSwr)
+            reducedChunk.drain(reducedSwr, s.reducedInfo.sampleRate);
     }
 
     flushBuf();
+    return !stopped;
+}
+
+// Seeks to the last seekable point at or before 'target' (AV_TIME_BASE units
+// from the start of the file) and drops whatever the decoder and resampler
+// still hold from before.
+bool seekTo(OpenStream &s, int64_t target, std::string &error) {
+    AVFormatContext *fmt = s.fmt.get();
+    const int64_t start = fmt->start_time != AV_NOPTS_VALUE ? fmt->start_time : 0;
+    if (int err = av_seek_frame(fmt, -1, start + target, AVSEEK_FLAG_BACKWARD); err < 0) {
+        error = "av_seek_frame: " + avError(err);
+        return false;
+    }
+    avcodec_flush_buffers(s.codecCtx.get());
+    for (SwrContext *swr : {s.swr.get(), s.reducedSwr.get()}) {
+        if (!swr)
+            continue;
+        swr_close(swr);
+        if (int err = swr_init(swr); err < 0) {
+            error = "swr_init: " + avError(err);
+            return false;
+        }
+    }
+    s.positionPending = true;
+    return true;
+}
+
+}  // namespace
+
+bool AudioDecoder::probe(const std::string &path, Tags &tagsOut, std::string &audioDigest,
+                         std::string &error) {
+    FormatContextPtr fmt = openInput(path, error);
+    if (!fmt)
+        return false;
+
+    int streamIdx = av_find_best_stream(fmt.get(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    if (streamIdx < 0) {
+        error = "No audio stream found";
+        return false;
+    }
+
+    StreamHasher hasher;
+    hashStreamParameters(hasher, fmt->streams[streamIdx]->codecpar);
+
+    std::unique_ptr<AVPacket, PacketDeleter> pkt(av_packet_alloc());
+    while (av_read_frame(fmt.get(), pkt.get()) >= 0) {
+        if (pkt->stream_index == streamIdx)
+            hasher.update(pkt->data, static_cast<size_t>(pkt->size));
+        av_packet_unref(pkt.get());
+    }
+
+    tagsOut = readTags(fmt.get());
+    audioDigest = hasher.hexDigest();
+    return true;
+}
+
+bool AudioDecoder::decode(const std::string &path, Callback cb, std::string &error, Tags &tagsOut,
+                          std::string *audioDigest, const ReducedStream *reduced) {
+    OpenStream s;
+    if (!openStream(path, s, error, reduced ? reduced->sampleRate : 0))
+        return false;
+
+    // --- Extract metadata tags into a local struct; assigned to tagsOut only on success ---
+    Tags tags = readTags(s.fmt.get());
+
+    StreamHasher hasher;
+    hashStreamParameters(hasher, s.fmt->streams[s.streamIdx]->codecpar);
+
+    const bool reachedEnd = decodeToEnd(s, cb, audioDigest ? &hasher : nullptr,
+                                        reduced ? reduced->cb : nullptr);
+
+    tagsOut = std::move(tags);
+    if (audioDigest && reachedEnd)
+        *audioDigest = hasher.hexDigest();
+    return true;
+}
+
+bool AudioDecoder::decodeExcerpts(const std::string &path, const std::vector<double> &positions,
+                                  double excerptSecs, ExcerptCallback cb, std::string &error,
+                                  Tags &tagsOut, const ReducedExcerpts *reduced) {
+    OpenStream s;
+    if (!openStream(path, s, error, reduced ? reduced->sampleRate : 0))
+        return false;
+    Tags tags = readTags(s.fmt.get());
+
+    // Passes one excerpt's reduced-rate audio on to reduced->cb, cut to
+    // framesLeft frames unless that is negative. Empty without a reduced
+    // stream, so decodeToEnd() then skips the second resampler.
+    using ReducedCallback = std::function<void(const float *, int, const AudioInfo &)>;
+    auto reducedFor = [&](int excerpt, long long &framesLeft) {
+        if (!s.reducedSwr)
+            return ReducedCallback{};
+        return ReducedCallback(
+            [&, excerpt](const float *samples, int numFrames, const AudioInfo &info) {
+                if (framesLeft >= 0) {
+                    numFrames = static_cast<int>(std::min<long long>(numFrames, framesLeft));
+                    framesLeft -= numFrames;
+                }
+                if (numFrames > 0)
+                    reduced->cb(excerpt, samples, numFrames, info);
+            });
+    };
+
+    const int64_t duration = s.fmt->duration;
+    const double excerptsSecs = excerptSecs * static_cast<double>(positions.size());
+
+    // Seeking only pays off when the excerpts are well apart; short or
+    // unseekable streams are delivered whole.
+    if (duration == AV_NOPTS_VALUE || duration <= 0 ||
+        static_cast<double>(duration) / AV_TIME_BASE < 2.0 * excerptsSecs) {
+        long long unlimited = -1;
+        decodeToEnd(
+            s,
+            [&](const float *samples, int numFrames, const AudioInfo &info) {
+                return cb(kWholeStream, samples, numFrames, info);
+            },
+            nullptr, reducedFor(kWholeStream, unlimited));
+        tagsOut = std::move(tags);
+        return true;
+    }
+
+    const long long excerptFrames = static_cast<long long>(excerptSecs * s.info.sampleRate);
+    const long long reducedExcerptFrames =
+        static_cast<long long>(excerptSecs * s.reducedInfo.sampleRate);
+    for (int i = 0; i < static_cast<int>(positions.size()); ++i) {
+        if (!seekTo(s, static_cast<int64_t>(positions[i] * duration), error))
+            return false;
+
+        long long framesLeft = excerptFrames;
+        long long reducedFramesLeft = reducedExcerptFrames;
+        bool wantMore = true;
+        decodeToEnd(
+            s,
+            [&](const float *samples, int numFrames, const AudioInfo &info) {
+                numFrames = static_cast<int>(std::min<long long>(numFrames, framesLeft));
+                framesLeft -= numFrames;
+                if (numFrames > 0)
+                    wantMore = cb(i, samples, numFrames, info);
+                return wantMore && framesLeft > 0;
+            },
+            nullptr, reducedFor(i, reducedFramesLeft));
+        if (!wantMore)
+            break;
+    }
+
     tagsOut = std::move(tags);
     return true;
 }
+
+bool AudioDecoder::decodeBackward(const std::string &path, double blockSecs, BlockCallback cb,
+                                  std::string &error) {
+    OpenStream s;
+    if (!openStream(path, s, error))
+        return false;
+    const int64_t duration = s.fmt->duration;
+    if (duration == AV_NOPTS_VALUE || duration <= 0) {
+        error = "Unknown duration";
+        return false;
+    }
+
+    // Each block runs from wherever the seek lands up to the earliest frame
+    // delivered so far; the first one runs to the end of the stream.
+    const int64_t blockStep = static_cast<int64_t>(blockSecs * AV_TIME_BASE);
+    long long earliest = -1;
+    bool wantMore = true;
+    for (int64_t target = duration - blockStep; wantMore; target -= blockStep) {
+        target = std::max<int64_t>(target, 0);
+        if (!seekTo(s, target, error))
+            return false;
+
+        long long position = -1;
+        decodeToEnd(
+            s,
+            [&](const float *samples, int numFrames, const AudioInfo &info) {
+                if (position < 0)
+                    position = s.firstFrame;
+                if (position < 0)
+                    return false;
+                if (earliest >= 0)
+                    numFrames =
+                        static_cast<int>(std::min<long long>(numFrames, earliest - position));
+                if (numFrames <= 0)
+                    return false;
+                wantMore = cb(position, samples, numFrames, info) && wantMore;
+                position += numFrames;
+                return earliest < 0 || position < earliest;
+            },
+            nullptr);
+
+        if (s.firstFrame < 0 && !s.positionPending) {
+            error = "No timestamps to seek by";
+            return false;
+        }
+        if (!s.positionPending && (earliest < 0 || s.firstFrame < earliest))
+            earliest = s.firstFrame;
+        if (target == 0 || earliest == 0)
+            break;
+    }
+    return true;
+}
@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <string>
+#include <vector>
 
 // Decodes an audio file to interleaved float32 stereo samples and
 // delivers them in chunks via callback.
@@ -26,12 +27,69 @@ class AudioDecoder {
     };
 
     // callback(samples, numFrames, info)
-    // Called repeatedly with successive chunks until EOF.
-    using Callback = std::function<void(const float*, int, const AudioInfo&)>;
+    // Called repeatedly with successive chunks until EOF, or until it
+    // returns false to stop decoding early.
+    using Callback = std::function<bool(const float*, int, const AudioInfo&)>;
 
-    // Returns true on success. On failure, 'error' is populated.
+    // Optional second output of decode(): the same audio as stereo float32
+    // resampled to a lower rate, straight from the decoded frames. Produced
+    // only if the native rate is above sampleRate. Each chunk is delivered
+    // right after the native-rate chunk covering the same stretch of audio,
+    // including the last one if cb stopped decoding.
+    struct ReducedStream {
+        int sampleRate = 0;
+        std::function<void(const float*, int, const AudioInfo&)> cb;
+    };
+
+    // Returns true on success, including when the callback stopped decoding
+    // early. On failure, 'error' is populated.
     // tagsOut is populated with embedded metadata tags on success.
-    static bool decode(const std::string& path, Callback cb, std::string& error, Tags& tagsOut);
+    // If audioDigest is non-null it receives the same digest as probe(), or
+    // is left empty if decoding stopped before EOF.
+    static bool decode(const std::string& path, Callback cb, std::string& error, Tags& tagsOut,
+                       std::string* audioDigest = nullptr, const ReducedStream* reduced = nullptr);
+
+    // excerptCallback(excerpt, samples, numFrames, info)
+    // Like Callback, with the index of the excerpt the chunk belongs to, or
+    // kWholeStream. Returning false stops decoding of all excerpts.
+    using ExcerptCallback = std::function<bool(int, const float*, int, const AudioInfo&)>;
+    static constexpr int kWholeStream = -1;
+
+    // The reduced-rate counterpart of ExcerptCallback for decodeExcerpts().
+    struct ReducedExcerpts {
+        int sampleRate = 0;
+        std::function<void(int, const float*, int, const AudioInfo&)> cb;
+    };
+
+    // Decodes up to excerptSecs seconds starting at each of 'positions'
+    // (fractions of the duration), seeking between them, and delivers the
+    // excerpts in order. Streams of unknown duration, or too short for the
+    // excerpts to be well apart, are delivered whole as kWholeStream. If
+    // 'reduced' is non-null and its rate is below the stream's, each stretch
+    // of audio also goes to reduced->cb at that rate, right after cb received
+    // it. Returns false with 'error' set on failure.
+    static bool decodeExcerpts(const std::string& path, const std::vector<double>& positions,
+                               double excerptSecs, ExcerptCallback cb, std::string& error,
+                               Tags& tagsOut, const ReducedExcerpts* reduced = nullptr);
+
+    // blockCallback(firstFrame, samples, numFrames, info)
+    // Like Callback, with the position of the chunk's first frame in the
+    // stream. Returning false stops decoding once the current block is done.
+    using BlockCallback = std::function<bool(long long, const float*, int, const AudioInfo&)>;
+
+    // Decodes the stream from the end backward in blocks of about blockSecs,
+    // seeking to each: every block is delivered in order and ends where the
+    // one delivered before it starts, the first ending at EOF. Positions come
+    // from the decoded frames' timestamps. Returns false with 'error' set if
+    // the duration is unknown or the stream has no timestamps.
+    static bool decodeBackward(const std::string& path, double blockSecs, BlockCallback cb,
+                               std::string& error);
+
+    // Reads tags and fingerprints the compressed audio stream (codec
+    // parameters + packet payloads) without decoding it. Container metadata
+    // is not part of the digest, so retagging a file leaves it unchanged.
+    static bool probe(const std::string& path, Tags& tagsOut, std::string& audioDigest,
+                      std::string& error);
 
     // Backward-compatible overload: ignores tags.
     static bool decode(const std::string& path, Callback cb, std::string& error) {
@@ -2,59 +2,156 @@
 
 #include <algorithm>
 
+namespace {
+
+// Ring capacity in multiples of the batch span.
+constexpr size_t kRingSpans = 4;
+
+}  // namespace
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DOWNMIX_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define DOWNMIX_NEON 1
+#endif
+
+void downmixStereoToMono(const float* pStereo, double* pMono, size_t numFrames) {
+    size_t i = 0;
+#if defined(DOWNMIX_SSE2)
+    const __m128d half = _mm_set1_pd(0.5);
+    for (; i + 4 <= numFrames; i += 4) {
+        const __m128 a = _mm_loadu_ps(pStereo + i * 2);      // L0 R0 L1 R1
+        const __m128 b = _mm_loadu_ps(pStereo + i * 2 + 4);  // L2 R2 L3 R3
+        const __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        const __m128 sum = _mm_add_ps(left, right);
+        _mm_storeu_pd(pMono + i, _mm_mul_pd(_mm_cvtps_pd(sum), half));
+        _mm_storeu_pd(pMono + i + 2, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(sum, sum)), half));
+    }
+#elif defined(DOWNMIX_NEON)
+    const float64x2_t half = vdupq_n_f64(0.5);
+    for (; i + 4 <= numFrames; i += 4) {
+        const float32x4x2_t lr = vld2q_f32(pStereo + i * 2);
+        const float32x4_t sum = vaddq_f32(lr.val[0], lr.val[1]);
+        vst1q_f64(pMono + i, vmulq_f64(vcvt_f64_f32(vget_low_f32(sum)), half));
+        vst1q_f64(pMono + i + 2, vmulq_f64(vcvt_high_f64_f32(sum), half));
+    }
+#endif
+    for (; i < numFrames; ++i) {
+        pMono[i] = (pStereo[i * 2] + pStereo[i * 2 + 1]) * 0.5;
+    }
+}
+
 bool DownmixAndOverlapHelper::initialize(size_t windowSize, size_t stepSize,
                                          const WindowReadyCallback& callback) {
-    m_buffer.assign(windowSize, 0.0);
     m_callback = callback;
+    m_batchCallback = nullptr;
+    return initializeRing(windowSize, stepSize, 1) && callback;
+}
+
+bool DownmixAndOverlapHelper::initialize(size_t windowSize, size_t stepSize,
+                                         size_t maxBatchWindows,
+                                         const WindowBatchReadyCallback& callback) {
+    m_callback = nullptr;
+    m_batchCallback = callback;
+    return initializeRing(windowSize, stepSize, maxBatchWindows) && callback;
+}
+
+bool DownmixAndOverlapHelper::initializeRing(size_t windowSize, size_t stepSize,
+                                             size_t maxBatchWindows) {
     m_windowSize = windowSize;
     m_stepSize = stepSize;
+    m_maxBatchWindows = std::max<size_t>(maxBatchWindows, 1);
+    m_span = windowSize + (m_maxBatchWindows - 1) * stepSize;
+    if (m_span == stepSize) {
+        // Back-to-back windows always start at slot 0; nothing to mirror.
+        m_mirrorSize = 0;
+        m_capacity = m_span;
+    } else {
+        // Only writes into the first m_span slots are mirrored, so a larger
+        // ring keeps the duplicated stores to a fraction of the input.
+        m_mirrorSize = m_span;
+        m_capacity = m_span * kRingSpans;
+    }
+    m_ring.assign(m_capacity + m_mirrorSize, 0.0);
+    m_readPosition = 0;
+    m_readyWindows = 0;
     // Center the first frame in the FFT window (matches Mixxx behaviour).
-    m_bufferWritePosition = windowSize / 2;
-    return m_windowSize > 0 && m_stepSize > 0 && m_stepSize <= m_windowSize && callback;
+    m_writePosition = windowSize / 2;
+    m_bufferedFrames = windowSize / 2;
+    return m_windowSize > 0 && m_stepSize > 0 && m_stepSize <= m_windowSize;
 }
 
 bool DownmixAndOverlapHelper::processStereoSamples(const float* pInput, size_t inputStereoSamples) {
-    return processInner(pInput, inputStereoSamples / 2);
+    return processInner(pInput, nullptr, inputStereoSamples / 2);
+}
+
+bool DownmixAndOverlapHelper::processMonoSamples(const double* pInput, size_t numInputFrames) {
+    return processInner(nullptr, pInput, numInputFrames);
 }
 
 bool DownmixAndOverlapHelper::finalize() {
-    size_t framesToFillWindow = m_windowSize - m_bufferWritePosition;
+    // Frames in the window being filled, as the sliding Mixxx helper counts them.
+    const size_t windowFill = m_bufferedFrames - m_readyWindows * m_stepSize;
+    size_t framesToFillWindow = m_windowSize - windowFill;
     size_t numInputFrames = std::max(framesToFillWindow, m_windowSize / 2 - 1);
-    return processInner(nullptr, numInputFrames);
+    return processInner(nullptr, nullptr, numInputFrames) && deliverReadyWindows();
 }
 
-bool DownmixAndOverlapHelper::processInner(const float* pInput, size_t numInputFrames) {
+bool DownmixAndOverlapHelper::processInner(const float* pStereo, const double* pMono,
+                                           size_t numInputFrames) {
     size_t inRead = 0;
-    double* pDownmix = m_buffer.data();
+    double* pRing = m_ring.data();
 
     while (inRead < numInputFrames) {
-        size_t readAvailable = numInputFrames - inRead;
-        size_t writeAvailable = m_windowSize - m_bufferWritePosition;
-        size_t numFrames = std::min(readAvailable, writeAvailable);
-
-        if (pInput) {
-            for (size_t i = 0; i < numFrames; ++i) {
-                pDownmix[m_bufferWritePosition + i] =
-                    (pInput[(inRead + i) * 2] + pInput[(inRead + i) * 2 + 1]) * 0.5;
-            }
+        // Stop at the end of the next window and at the end of the ring.
+        const size_t windowEnd = m_windowSize + m_readyWindows * m_stepSize;
+        size_t numFrames = std::min({numInputFrames - inRead, windowEnd - m_bufferedFrames,
+                                     m_capacity - m_writePosition});
+        double* pDest = pRing + m_writePosition;
+
+        if (pStereo) {
+            downmixStereoToMono(pStereo + inRead * 2, pDest, numFrames);
+        } else if (pMono) {
+            std::copy(pMono + inRead, pMono + inRead + numFrames, pDest);
         } else {
-            for (size_t i = 0; i < numFrames; ++i) {
-                pDownmix[m_bufferWritePosition + i] = 0;
-            }
+            std::fill(pDest, pDest + numFrames, 0.0);
+        }
+        if (m_writePosition < m_mirrorSize) {
+            const size_t numMirrored = std::min(numFrames, m_mirrorSize - m_writePosition);
+            std::copy(pDest, pDest + numMirrored, pDest + m_capacity);
         }
-        m_bufferWritePosition += numFrames;
+        m_writePosition += numFrames;
+        if (m_writePosition == m_capacity)
+            m_writePosition = 0;
+        m_bufferedFrames += numFrames;
         inRead += numFrames;
 
-        if (m_bufferWritePosition == m_windowSize) {
-            if (!m_callback(pDownmix, m_windowSize)) {
+        if (m_bufferedFrames == windowEnd && ++m_readyWindows == m_maxBatchWindows) {
+            if (!deliverReadyWindows())
                 return false;
-            }
-            // Slide the window forward by stepSize.
-            for (size_t i = 0; i < (m_windowSize - m_stepSize); ++i) {
-                pDownmix[i] = pDownmix[i + m_stepSize];
-            }
-            m_bufferWritePosition -= m_stepSize;
         }
     }
     return true;
 }
+
+bool DownmixAndOverlapHelper::deliverReadyWindows() {
+    if (m_readyWindows == 0)
+        return true;
+
+    double* pFirstWindow = m_ring.data() + m_readPosition;
+    if (m_batchCallback) {
+        if (!m_batchCallback(pFirstWindow, m_readyWindows))
+            return false;
+    } else if (!m_callback(pFirstWindow, m_windowSize)) {
+        return false;
+    }
+
+    const size_t consumed = m_readyWindows * m_stepSize;
+    m_readPosition = (m_readPosition + consumed) % m_capacity;
+    m_bufferedFrames -= consumed;
+    m_readyWindows = 0;
+    return true;
+}
@@ -3,24 +3,56 @@
 #include <functional>
 #include <vector>
 
+// Writes (L + R) * 0.5 of 'numFrames' interleaved stereo frames to 'pMono'.
+// The sum is formed in float and then widened, exactly like the scalar
+// Mixxx expression, so the SIMD paths give bit-identical output.
+void downmixStereoToMono(const float* pStereo, double* pMono, size_t numFrames);
+
 // Downmixes stereo to mono and feeds it into overlapping windows.
-// Direct port of mixxx::DownmixAndOverlapHelper (no Qt/Mixxx types).
+// Port of mixxx::DownmixAndOverlapHelper (no Qt/Mixxx types) that produces the
+// same windows without shifting memory between hops.
+//
+// Samples are written once into a mirrored ring: the first 'span' slots (one
+// full batch of windows) are also written past the end of the ring, so every
+// window, and every run of windows in a batch, is contiguous at its read
+// offset. Windows point into the ring and must be treated as read-only.
 class DownmixAndOverlapHelper {
   public:
     DownmixAndOverlapHelper() = default;
 
     using WindowReadyCallback = std::function<bool(double* pBuffer, size_t frames)>;
+    // Receives 'numWindows' windows at once; window i starts at
+    // pFirstWindow + i * stepSize and holds windowSize frames.
+    using WindowBatchReadyCallback = std::function<bool(double* pFirstWindow, size_t numWindows)>;
 
     bool initialize(size_t windowSize, size_t stepSize, const WindowReadyCallback& callback);
+    // Delivers windows in batches of 'maxBatchWindows'; finalize() flushes a
+    // shorter last batch. Windows arrive in the same order as one at a time.
+    bool initialize(size_t windowSize, size_t stepSize, size_t maxBatchWindows,
+                    const WindowBatchReadyCallback& callback);
     bool processStereoSamples(const float* pInput, size_t inputStereoSamples);
+    // Same as processStereoSamples() for input already downmixed with
+    // downmixStereoToMono(), so several helpers can share one downmix.
+    bool processMonoSamples(const double* pInput, size_t numInputFrames);
     bool finalize();
 
   private:
-    bool processInner(const float* pInput, size_t numInputFrames);
+    bool initializeRing(size_t windowSize, size_t stepSize, size_t maxBatchWindows);
+    // Exactly one of pStereo and pMono may be non-null; both null feeds silence.
+    bool processInner(const float* pStereo, const double* pMono, size_t numInputFrames);
+    bool deliverReadyWindows();
 
-    std::vector<double> m_buffer;
+    std::vector<double> m_ring;  // m_capacity slots followed by the mirror
     size_t m_windowSize = 0;
     size_t m_stepSize = 0;
-    size_t m_bufferWritePosition = 0;
+    size_t m_maxBatchWindows = 1;
+    size_t m_span = 0;        // frames covered by a full batch of windows
+    size_t m_capacity = 0;    // ring size, at least m_span
+    size_t m_mirrorSize = 0;  // m_span, or 0 when windows never wrap
+    size_t m_readPosition = 0;
+    size_t m_writePosition = 0;
+    size_t m_bufferedFrames = 0;  // frames from m_readPosition up to m_writePosition
+    size_t m_readyWindows = 0;    // complete windows not yet delivered
     WindowReadyCallback m_callback;
+    WindowBatchReadyCallback m_batchCallback;
 };
@@ -0,0 +1,352 @@
+#include "FileAnalysis.h"
+
+#include <dsp/transforms/FFT.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+
+#include "AnalysisCache.h"
+#include "AnalysisSession.h"
+#include "AudioDecoder.h"
+#include "GainAnalyzer.h"
+#include "QmBpmAnalyzer.h"
+#include "QmKeyAnalyzer.h"
+#include "SilenceAnalyzer.h"
+
+namespace {
+
+// --fast samples the track at these fractions of its duration.
+const std::vector<double> kFastPositions = {0.25, 0.5, 0.75};
+constexpr double kFastExcerptSecs = 30.0;
+
+// Runs the bpm and key analyzers of options.analyzers on the excerpts. Each
+// excerpt gets its own beat tracker, since spliced excerpts would show it
+// tempo jumps at the seams, and the bpm is their median; one key analyzer
+// hears all of them. Tracks too short to sample are analyzed whole, exactly.
+// Hi-res files are analyzed at options.qmSampleRate, as by analyzeFile().
+bool analyzeExcerpts(const std::string& path, const AnalyzeOptions& options, AnalysisResult& out,
+                     std::string& error) {
+    AnalyzerSelection bpmOnly{false, false, false, false, false};
+    bpmOnly.bpm = options.analyzers.bpm;
+    AnalyzerSelection keyOnly{false, false, false, false, false};
+    keyOnly.key = options.analyzers.key;
+    AnalyzerSelection selection = bpmOnly;
+    selection.key = keyOnly.key;
+
+    std::vector<std::unique_ptr<AnalysisSession>> bpmSessions(kFastPositions.size());
+    std::unique_ptr<AnalysisSession> keySession;
+    std::unique_ptr<AnalysisSession> wholeSession;
+    bool anyAudio = false;
+    // Sessions are created by the first chunk at the native rate, which
+    // always comes before the same audio at the reduced rate.
+    int qmSampleRate = 0;
+    std::string decodeError;
+    AudioDecoder::Tags tags;
+    AudioDecoder::ReducedExcerpts reduced;
+    reduced.sampleRate = options.qmSampleRate;
+    reduced.cb = [&](int excerpt, const float* samples, int numFrames,
+                     const AudioDecoder::AudioInfo&) {
+        if (excerpt == AudioDecoder::kWholeStream) {
+            if (wholeSession)
+                wholeSession->feedReduced(samples, numFrames);
+            return;
+        }
+        if (keySession)
+            keySession->feedReduced(samples, numFrames);
+        if (bpmSessions[excerpt])
+            bpmSessions[excerpt]->feedReduced(samples, numFrames);
+    };
+    bool ok = AudioDecoder::decodeExcerpts(
+        path, kFastPositions, kFastExcerptSecs,
+        [&](int excerpt, const float* samples, int numFrames,
+            const AudioDecoder::AudioInfo& info) {
+            if (!anyAudio) {
+                anyAudio = true;
+                qmSampleRate = options.qmSampleRate > 0 && info.sampleRate > options.qmSampleRate
+                                   ? options.qmSampleRate
+                                   : 0;
+            }
+            auto session = [&](std::unique_ptr<AnalysisSession>& s,
+                               const AnalyzerSelection& analyzers) {
+                if (!s)
+                    s = std::make_unique<AnalysisSession>(info.sampleRate, options.pipelined,
+                                                          analyzers, qmSampleRate,
+                                                          options.singlePrecision);
+                s->feed(samples, numFrames);
+            };
+            if (excerpt == AudioDecoder::kWholeStream) {
+                session(wholeSession, selection);
+                return true;
+            }
+            if (keyOnly.key)
+                session(keySession, keyOnly);
+            if (bpmOnly.bpm)
+                session(bpmSessions[excerpt], bpmOnly);
+            return true;
+        },
+        decodeError, tags, options.qmSampleRate > 0 ? &reduced : nullptr);
+
+    if (!ok) {
+        error = "Error decoding '" + path + "': " + decodeError;
+        return false;
+    }
+    if (!anyAudio) {
+        error = "No audio data in '" + path + "'";
+        return false;
+    }
+
+    if (wholeSession) {
+        wholeSession->finish(out);
+    } else {
+        out = AnalysisResult{};
+        if (keySession)
+            keySession->finish(out);
+        std::vector<float> bpms;
+        for (auto& bpmSession : bpmSessions) {
+            if (!bpmSession)
+                continue;
+            AnalysisResult excerptResult;
+            bpmSession->finish(excerptResult);
+            if (excerptResult.bpm > 0.0f)
+                bpms.push_back(excerptResult.bpm);
+        }
+        if (!bpms.empty()) {
+            // Lower median: an actual excerpt's tempo, never an average.
+            auto median = bpms.begin() + (bpms.size() - 1) / 2;
+            std::nth_element(bpms.begin(), median, bpms.end());
+            out.bpm = *median;
+        }
+        out.analyzers = selection;
+        out.approximate = true;
+    }
+    out.path = path;
+    out.tags = std::move(tags);
+    return true;
+}
+
+// Audio decoded per step of the backward outro search.
+constexpr double kOutroBlockSecs = 5.0;
+
+// Selections answered by analyzeSilenceBySeeking(). Their outro is located
+// by stream timestamps rather than by counting decoded frames, so their
+// cached results are kept apart from those of a full scan.
+bool findsSilenceBySeeking(const AnalyzerSelection& analyzers) {
+    return analyzers.silence && !analyzers.bpm && !analyzers.key && !analyzers.gain;
+}
+
+// --only silence: finds the intro decoding forward from the start and the
+// outro decoding backward from the end, so only the audio up to the first
+// and after the last sound is read. Returns false if the file has to be
+// decoded in full instead: its duration is unknown, it has no timestamps, or
+// it failed to decode.
+bool analyzeSilenceBySeeking(const std::string& path, const AnalyzeOptions& options,
+                             AnalysisResult& out) {
+    std::unique_ptr<SilenceAnalyzer> intro;
+    std::string error;
+    AudioDecoder::Tags tags;
+    bool ok = AudioDecoder::decode(
+        path,
+        [&](const float* samples, int numFrames, const AudioDecoder::AudioInfo& info) {
+            if (!intro)
+                intro = std::make_unique<SilenceAnalyzer>(info.sampleRate, info.channels, true);
+            intro->feed(samples, numFrames);
+            return !intro->done();
+        },
+        error, tags);
+    if (!ok || !intro)
+        return false;
+
+    // A file that is silent throughout has been read to the end already.
+    SilenceAnalyzer::Result silence = intro->result();
+    if (intro->done()) {
+        long long lastLoud = -1;
+        int sampleRate = 0;
+        ok = AudioDecoder::decodeBackward(
+            path, kOutroBlockSecs,
+            [&](long long firstFrame, const float* samples, int numFrames,
+                const AudioDecoder::AudioInfo& info) {
+                sampleRate = info.sampleRate;
+                const int last = SilenceAnalyzer::lastLoudFrame(samples, numFrames, info.channels);
+                if (last >= 0)
+                    lastLoud = std::max(lastLoud, firstFrame + last);
+                return lastLoud < 0;
+            },
+            error);
+        if (!ok || lastLoud < 0)
+            return false;
+        silence.outroSecs = static_cast<double>(lastLoud + 1) / sampleRate;
+    }
+
+    out.bpm = 0.0f;
+    out.key.clear();
+    out.camelot.clear();
+    out.lufs = 0.0;
+    out.replayGain = 0.0;
+    out.introSecs = silence.introSecs;
+    out.outroSecs = silence.outroSecs;
+    out.beatgrid.clear();
+    out.analyzers = options.analyzers;
+    out.path = path;
+    out.tags = std::move(tags);
+    return true;
+}
+
+}  // namespace
+
+bool analyzeFile(const std::string& path, const AnalyzeOptions& options, AnalysisResult& out,
+                 std::string& error) {
+    if (options.fast)
+        return analyzeExcerpts(path, options, out, error);
+
+    const AnalysisCache* cache = options.previewSecs > 0.0 ? nullptr : options.cache;
+    AnalysisCache::FileStamp stamp;
+    std::string cachedDigest;
+    if (cache) {
+        stamp = AnalysisCache::stamp(path);
+        if (cache->lookup(path, stamp, out, &cachedDigest)) {
+            out.analyzers = options.analyzers;
+            return true;
+        }
+    }
+
+    if (findsSilenceBySeeking(options.analyzers) && options.previewSecs <= 0.0 &&
+        analyzeSilenceBySeeking(path, options, out)) {
+        // The digest normally comes for free with decoding; here it is the
+        // one the cache lookup found or computed.
+        if (cache)
+            cache->store(path, stamp, cachedDigest, out);
+        return true;
+    }
+
+    // Hi-res files reach the QM analyzers through the decoder's reduced stream.
+    AudioDecoder::ReducedStream reduced;
+    const bool wantReduced =
+        options.qmSampleRate > 0 && (options.analyzers.bpm || options.analyzers.key);
+    reduced.sampleRate = options.qmSampleRate;
+
+    std::unique_ptr<AnalysisSession> session;
+    std::string decodeError;
+    AudioDecoder::Tags tags;
+    std::string audioDigest;
+    long long framesLeft = 0;
+    long long reducedFramesLeft = 0;
+    reduced.cb = [&](const float* samples, int numFrames, const AudioDecoder::AudioInfo&) {
+        if (reducedFramesLeft >= 0) {
+            numFrames = static_cast<int>(std::min<long long>(numFrames, reducedFramesLeft));
+            reducedFramesLeft -= numFrames;
+        }
+        if (numFrames > 0)
+            session->feedReduced(samples, numFrames);
+    };
+    bool ok = AudioDecoder::decode(
+        path,
+        [&](const float* samples, int numFrames, const AudioDecoder::AudioInfo& info) {
+            if (!session) {
+                const int qmSampleRate =
+                    wantReduced && info.sampleRate > reduced.sampleRate ? reduced.sampleRate : 0;
+                session = std::make_unique<AnalysisSession>(
+                    info.sampleRate, options.pipelined, options.analyzers, qmSampleRate,
+                    options.singlePrecision);
+                framesLeft = options.previewSecs > 0.0
+                                 ? static_cast<long long>(options.previewSecs * info.sampleRate)
+                                 : -1;
+                reducedFramesLeft =
+                    options.previewSecs > 0.0
+                        ? static_cast<long long>(options.previewSecs * qmSampleRate)
+                        : -1;
+            }
+            if (framesLeft >= 0) {
+                numFrames = static_cast<int>(std::min<long long>(numFrames, framesLeft));
+                framesLeft -= numFrames;
+            }
+            if (numFrames > 0)
+                session->feed(samples, numFrames);
+            // Stop reading the file as soon as nothing more is wanted from it.
+            return framesLeft != 0 && !session->done();
+        },
+        decodeError, tags, cache ? &audioDigest : nullptr, wantReduced ? &reduced : nullptr);
+
+    if (!ok) {
+        error = "Error decoding '" + path + "': " + decodeError;
+        return false;
+    }
+    if (!session) {
+        error = "No audio data in '" + path + "'";
+        return false;
+    }
+
+    session->finish(out);
+    out.path = path;
+    out.tags = std::move(tags);
+
+    if (cache)
+        cache->store(path, stamp, audioDigest, out);
+    return true;
+}
+
+std::string analysisConfigSignature(const AnalyzerSelection& analyzers, int qmSampleRate,
+                                    bool singlePrecision) {
+    std::string signature;
+    auto append = [&signature](bool selected, const std::string& part) {
+        if (!selected)
+            return;
+        if (!signature.empty())
+            signature += "; ";
+        signature += part;
+    };
+    // QM results depend on the precision they were computed in, the FFT
+    // they ran on and, for hi-res files, the rate they ran at.
+    std::string qmConfig =
+        qmSampleRate > 0 ? " @<=" + std::to_string(qmSampleRate) + "Hz" : std::string{};
+    if (singlePrecision)
+        qmConfig += " f32";
+    if (kSimdFFTByDefault)
+        qmConfig += " simdfft";
+    append(analyzers.bpm, QmBpmAnalyzer::configSignature() + qmConfig);
+    append(analyzers.key, QmKeyAnalyzer::configSignature() + qmConfig);
+    append(analyzers.gain, GainAnalyzer::configSignature());
+    append(analyzers.silence,
+           SilenceAnalyzer::configSignature() + (findsSilenceBySeeking(analyzers) ? " seek" : ""));
+    append(analyzers.intro && !analyzers.silence, SilenceAnalyzer::configSignature() + " intro");
+    return signature;
+}
+
+bool parseAnalyzerSelection(const std::string& list, AnalyzerSelection& out, std::string& error) {
+    AnalyzerSelection selection{false, false, false, false, false};
+    std::size_t start = 0;
+    while (start <= list.size()) {
+        std::size_t end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+        const std::string name = list.substr(start, end - start);
+        if (name == "bpm") {
+            selection.bpm = true;
+        } else if (name == "key") {
+            selection.key = true;
+        } else if (name == "gain") {
+            selection.gain = true;
+        } else if (name == "silence") {
+            selection.silence = true;
+        } else if (name == "intro") {
+            selection.intro = true;
+        } else {
+            error = "Unknown analyzer '" + name + "' (expected bpm, key, gain, silence or intro)";
+            return false;
+        }
+        start = end + 1;
+    }
+    out = selection;
+    return true;
+}
+
+bool parseQmSampleRate(const std::string& text, int& out) {
+    char* end = nullptr;
+    const long hz = std::strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0')
+        return false;
+    if (hz != 0 && (hz < kMinQmSampleRate || hz > kMaxQmSampleRate))
+        return false;
+    out = static_cast<int>(hz);
+    return true;
+}
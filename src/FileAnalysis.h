@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AnalysisResult.h"
+
+class AnalysisCache;
+
+// Range of nonzero rates accepted for AnalyzeOptions::qmSampleRate. Below the floor the QM frame sizes
+// shrink until the tempo tracker's FFT rejects them, and well before that the
+// detection functions lose the bands the analyzers rely on.
+constexpr int kMinQmSampleRate = 22050;
+constexpr int kMaxQmSampleRate = 1000000;
+
+struct AnalyzeOptions {
+    // Feed the analyzers from per-analyzer threads through an AnalysisPipeline
+    // instead of calling them one after another on the decoder thread.
+    bool pipelined = false;
+    // Analyzers to run; the others' result fields stay unset.
+    AnalyzerSelection analyzers;
+    // If positive, analyze only the first previewSecs seconds of audio. The
+    // cache is bypassed for such partial results.
+    double previewSecs = 0.0;
+    // Estimate bpm and key from a few short excerpts found by seeking, so the
+    // cost per file stays constant however long it is. Results are marked
+    // approximate, no beatgrid is produced and the gain and silence analyzers
+    // do not run. The cache is bypassed.
+    bool fast = false;
+    // Highest sample rate the bpm and key analyzers run at; files above it
+    // are also decoded to a stream at this rate for them, while gain and
+    // silence keep the native rate, so hi-res audio costs about as much to
+    // analyze as CD-rate audio. Their results may then differ from Mixxx's.
+    // 0 runs them at the native rate.
+    int qmSampleRate = 0;
+    // Run the bpm and key analyzers' DSP in float instead of double. Results
+    // may occasionally differ from Mixxx's.
+    bool singlePrecision = false;
+    // Optional persistent result cache; null disables caching. Its signature
+    // must be analysisConfigSignature(analyzers, qmSampleRate,
+    // singlePrecision).
+    const AnalysisCache* cache = nullptr;
+};
+
+// Decodes and analyzes one file. Safe to call concurrently from several
+// threads: every call owns its decoder and analyzer instances. Returns false
+// with a human-readable message in 'error' on failure.
+bool analyzeFile(const std::string& path, const AnalyzeOptions& options, AnalysisResult& out,
+                 std::string& error);
+
+// Signature of the configuration of the selected analyzers, used to key
+// cached results.
+std::string analysisConfigSignature(const AnalyzerSelection& analyzers = {},
+                                    int qmSampleRate = 0,
+                                    bool singlePrecision = false);
+
+// Parses a comma-separated list of analyzer names (bpm, key, gain, silence,
+// intro), as given to --only. Returns false with 'error' set on an unknown or empty
+// list.
+bool parseAnalyzerSelection(const std::string& list, AnalyzerSelection& out, std::string& error);
+
+// Parses a --qm-rate value: 0, or a whole number of Hz from kMinQmSampleRate
+// to kMaxQmSampleRate. Returns false, leaving 'out' untouched, otherwise.
+bool parseQmSampleRate(const std::string& text, int& out);
+
+// Outcome of one file in a batch. Slots are filled by workers in any order
+// and consumed by the caller in input order.
+struct FileOutcome {
+    bool done = false;
+    bool ok = false;
+    AnalysisResult result;
+    std::string error;
+};
+
+// Analyzes 'files' on up to 'jobs' worker threads and hands each outcome to
+// 'onOutcome' on the calling thread, strictly in input order. Workers never
+// run more than a few files ahead of the oldest unconsumed outcome, so a slow
+// track cannot make finished results pile up behind it.
+template <typename OnOutcome>
+void analyzeBatch(const std::vector<std::string>& files, int jobs, const AnalyzeOptions& options,
+                  OnOutcome onOutcome) {
+    const std::size_t numWorkers =
+        std::min(files.size(), static_cast<std::size_t>(std::max(jobs, 1)));
+    const std::size_t maxAhead = numWorkers * 4;
+
+    std::vector<FileOutcome> outcomes(files.size());
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable consumed;
+    std::size_t numConsumed = 0;
+    std::atomic<std::size_t> next{0};
+
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < files.size(); i = next++) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                consumed.wait(lock, [&] { return i < numConsumed + maxAhead; });
+            }
+            AnalysisResult r;
+            std::string error;
+            bool ok = analyzeFile(files[i], options, r, error);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                outcomes[i].ok = ok;
+                outcomes[i].result = std::move(r);
+                outcomes[i].error = std::move(error);
+                outcomes[i].done = true;
+            }
+            ready.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(numWorkers);
+    for (std::size_t w = 0; w < numWorkers; ++w) {
+        workers.emplace_back(worker);
+    }
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        FileOutcome outcome;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [&] { return outcomes[i].done; });
+            outcome = std::move(outcomes[i]);
+            outcomes[i] = FileOutcome{};
+            numConsumed = i + 1;
+        }
+        consumed.notify_all();
+        onOutcome(outcome);
+    }
+
+    for (auto& t : workers) {
+        t.join();
+    }
+}
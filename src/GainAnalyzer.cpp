@@ -1,10 +1,13 @@
 #include "GainAnalyzer.h"
 
 #include <cmath>
+#include <cstdio>
 
 namespace {
 // EBU R128 reference level for ReplayGain 2.0
 constexpr double kReplayGainReferenceLUFS = -18.0;
+// Bump when the analysis changes in a way the constants don't capture.
+constexpr int kAlgorithmRevision = 1;
 }  // namespace
 
 GainAnalyzer::GainAnalyzer(int sampleRate)
@@ -37,3 +40,10 @@ bool GainAnalyzer::result(Result& out) const {
     out.replayGain = kReplayGainReferenceLUFS - lufs;
     return true;
 }
+
+std::string GainAnalyzer::configSignature() {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "ebur128/%d ref=%g", kAlgorithmRevision,
+                  kReplayGainReferenceLUFS);
+    return buf;
+}
@@ -2,6 +2,8 @@
 
 #include <ebur128.h>
 
+#include <string>
+
 // Measures integrated loudness and ReplayGain from a stream of
 // interleaved float32 stereo samples using libebur128 (EBU R128).
 class GainAnalyzer {
@@ -25,6 +27,9 @@ class GainAnalyzer {
     // Returns false if measurement failed (e.g. silence).
     bool result(Result& out) const;
 
+    // Identifies the algorithm revision and constants that affect results.
+    static std::string configSignature();
+
   private:
     ebur128_state* m_state;
 };
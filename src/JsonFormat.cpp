@@ -0,0 +1,318 @@
+#include "JsonFormat.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+void appendf(std::string& out, const char* fmt, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    const int n = std::vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (n > 0)
+        out.append(buf, static_cast<std::size_t>(n) < sizeof(buf) ? n : sizeof(buf) - 1);
+}
+
+void appendString(std::string& out, const char* name, const std::string& value, const char* sep) {
+    out += '"';
+    out += name;
+    out += "\": \"";
+    out += jsonEscape(value);
+    out += '"';
+    out += sep;
+}
+
+void appendUtf8(std::string& out, unsigned cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Minimal recursive-descent reader for the flat objects accepted by
+// parseJsonObject().
+class FlatObjectParser {
+  public:
+    explicit FlatObjectParser(const std::string& input) : m_s(input) {}
+
+    bool parse(std::map<std::string, JsonValue>& out, std::string& error) {
+        skipSpace();
+        if (!consume('{'))
+            return fail(error, "expected '{'");
+        skipSpace();
+        if (!consume('}')) {
+            do {
+                skipSpace();
+                std::string key;
+                if (!parseString(key))
+                    return fail(error, "expected a string key");
+                skipSpace();
+                if (!consume(':'))
+                    return fail(error, "expected ':'");
+                skipSpace();
+                JsonValue value;
+                if (!parseValue(value))
+                    return fail(error, "unsupported or malformed value for '" + key + "'");
+                out[key] = std::move(value);
+                skipSpace();
+            } while (consume(','));
+            if (!consume('}'))
+                return fail(error, "expected ',' or '}'");
+        }
+        skipSpace();
+        if (m_pos != m_s.size())
+            return fail(error, "trailing characters after object");
+        return true;
+    }
+
+  private:
+    bool fail(std::string& error, const std::string& what) {
+        error = what + " at offset " + std::to_string(m_pos);
+        return false;
+    }
+
+    void skipSpace() {
+        while (m_pos < m_s.size() && (m_s[m_pos] == ' ' || m_s[m_pos] == '\t' ||
+                                      m_s[m_pos] == '\r' || m_s[m_pos] == '\n'))
+            ++m_pos;
+    }
+
+    bool consume(char c) {
+        if (m_pos < m_s.size() && m_s[m_pos] == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseHex4(unsigned& cp) {
+        if (m_pos + 4 > m_s.size())
+            return false;
+        cp = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char c = m_s[m_pos++];
+            cp <<= 4;
+            if (c >= '0' && c <= '9')
+                cp |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                cp |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                cp |= c - 'A' + 10;
+            else
+                return false;
+        }
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        if (!consume('"'))
+            return false;
+        while (m_pos < m_s.size()) {
+            const char c = m_s[m_pos++];
+            if (c == '"')
+                return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (m_pos >= m_s.size())
+                return false;
+            const char e = m_s[m_pos++];
+            switch (e) {
+                case '"':
+                case '\\':
+                case '/':
+                    out += e;
+                    break;
+                case 'b':
+                    out += '\b';
+                    break;
+                case 'f':
+                    out += '\f';
+                    break;
+                case 'n':
+                    out += '\n';
+                    break;
+                case 'r':
+                    out += '\r';
+                    break;
+                case 't':
+                    out += '\t';
+                    break;
+                case 'u': {
+                    unsigned cp = 0;
+                    if (!parseHex4(cp))
+                        return false;
+                    // Combine UTF-16 surrogate pairs; unpaired halves have no
+                    // UTF-8 encoding.
+                    if (cp >= 0xDC00 && cp < 0xE000)
+                        return false;
+                    if (cp >= 0xD800 && cp < 0xDC00) {
+                        if (m_s.compare(m_pos, 2, "\\u") != 0)
+                            return false;
+                        m_pos += 2;
+                        unsigned low = 0;
+                        if (!parseHex4(low) || low < 0xDC00 || low >= 0xE000)
+                            return false;
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    bool parseValue(JsonValue& value) {
+        const std::size_t start = m_pos;
+        if (m_pos < m_s.size() && m_s[m_pos] == '"') {
+            value.type = JsonValue::Type::String;
+            if (!parseString(value.text))
+                return false;
+        } else if (m_s.compare(m_pos, 4, "true") == 0 || m_s.compare(m_pos, 4, "null") == 0) {
+            value.type = m_s[m_pos] == 't' ? JsonValue::Type::Bool : JsonValue::Type::Null;
+            m_pos += 4;
+            value.text = m_s.substr(start, 4);
+        } else if (m_s.compare(m_pos, 5, "false") == 0) {
+            value.type = JsonValue::Type::Bool;
+            m_pos += 5;
+            value.text = "false";
+        } else {
+            value.type = JsonValue::Type::Number;
+            while (m_pos < m_s.size() && m_s[m_pos] != '\0' &&
+                   std::strchr("+-.0123456789eE", m_s[m_pos]))
+                ++m_pos;
+            if (m_pos == start)
+                return false;
+            value.text = m_s.substr(start, m_pos - start);
+            char* end = nullptr;
+            std::strtod(value.text.c_str(), &end);
+            if (*end != '\0')
+                return false;
+        }
+        value.raw = m_s.substr(start, m_pos - start);
+        return true;
+    }
+
+    const std::string& m_s;
+    std::size_t m_pos = 0;
+};
+
+}  // namespace
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size() + 4);
+    for (unsigned char c : s) {
+        if (c == '"')
+            out += "\\\"";
+        else if (c == '\\')
+            out += "\\\\";
+        else if (c == '\n')
+            out += "\\n";
+        else if (c == '\r')
+            out += "\\r";
+        else if (c == '\t')
+            out += "\\t";
+        else if (c < 0x20) {
+            // Escape remaining control characters as \u00XX
+            char buf[7];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+            out += buf;
+        } else
+            out += static_cast<char>(c);
+    }
+    return out;
+}
+
+std::string formatJsonRecord(const AnalysisResult& r, bool pretty,
+                             const std::string& leadingFields) {
+    const char* sep = pretty ? ",\n    " : ", ";
+    std::string out = pretty ? "  {\n    " : "{";
+    if (!leadingFields.empty()) {
+        out += leadingFields;
+        out += sep;
+    }
+    appendString(out, "file", r.path, sep);
+    // Fields of analyzers that did not run are null.
+    if (r.analyzers.bpm && r.bpm > 0.0f)
+        appendf(out, "\"bpm\": %.2f%s", r.bpm, sep);
+    else
+        appendf(out, "\"bpm\": null%s", sep);
+    if (r.analyzers.key) {
+        appendString(out, "key", r.key, sep);
+        appendString(out, "camelot", r.camelot, sep);
+    } else {
+        appendf(out, "\"key\": null%s\"camelot\": null%s", sep, sep);
+    }
+    if (r.analyzers.gain) {
+        appendf(out, "\"lufs\": %.2f%s", r.lufs, sep);
+        appendf(out, "\"replayGain\": %.2f%s", r.replayGain, sep);
+    } else {
+        appendf(out, "\"lufs\": null%s\"replayGain\": null%s", sep, sep);
+    }
+    if (r.analyzers.anyIntro())
+        appendf(out, "\"introSecs\": %.3f%s", r.introSecs, sep);
+    else
+        appendf(out, "\"introSecs\": null%s", sep);
+    if (r.analyzers.silence)
+        appendf(out, "\"outroSecs\": %.3f%s", r.outroSecs, sep);
+    else
+        appendf(out, "\"outroSecs\": null%s", sep);
+    // Tags as flat fields
+    appendString(out, "title", r.tags.title, sep);
+    appendString(out, "artist", r.tags.artist, sep);
+    appendString(out, "album", r.tags.album, sep);
+    appendString(out, "year", r.tags.year, sep);
+    appendString(out, "genre", r.tags.genre, sep);
+    appendString(out, "label", r.tags.label, sep);
+    appendString(out, "comment", r.tags.comment, sep);
+    appendString(out, "trackNumber", r.tags.trackNumber, sep);
+    appendString(out, "bpmTag", r.tags.bpmTag, sep);
+    // Beatgrid as array of seconds; excerpt estimates have none
+    if (r.analyzers.bpm && !r.approximate) {
+        out += "\"beatgrid\": [";
+        for (std::size_t j = 0; j < r.beatgrid.size(); ++j) {
+            appendf(out, "%.6f%s", r.beatgrid[j], (j + 1 < r.beatgrid.size()) ? "," : "");
+        }
+        out += ']';
+    } else {
+        out += "\"beatgrid\": null";
+    }
+    if (r.approximate)
+        appendf(out, "%s\"approximate\": true", sep);
+    out += pretty ? "\n  }" : "}";
+    return out;
+}
+
+std::string formatJsonError(const std::string& path, const std::string& error,
+                            const std::string& leadingFields) {
+    std::string out = "{";
+    if (!leadingFields.empty())
+        out += leadingFields + ", ";
+    out += "\"file\": \"" + jsonEscape(path) + "\", \"error\": \"" + jsonEscape(error) + "\"}";
+    return out;
+}
+
+bool parseJsonObject(const std::string& input, std::map<std::string, JsonValue>& out,
+                     std::string& error) {
+    return FlatObjectParser(input).parse(out, error);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "AnalysisResult.h"
+
+// Escape a string for embedding in JSON.
+std::string jsonEscape(const std::string& s);
+
+// Formats one result as a JSON object without a trailing newline. The pretty
+// layout is the element format of the --json array; the compact one keeps the
+// whole record on a single line for --ndjson and --serve. 'leadingFields'
+// (e.g. "\"id\": 7") is emitted before the result fields. Fields of analyzers
+// that were not selected are null.
+std::string formatJsonRecord(const AnalysisResult& r, bool pretty,
+                             const std::string& leadingFields = {});
+
+// Single-line {"file": ..., "error": ...} record for a file that failed.
+std::string formatJsonError(const std::string& path, const std::string& error,
+                            const std::string& leadingFields = {});
+
+// A scalar JSON value. 'raw' is the literal as it appeared in the input, so it
+// can be echoed back unchanged (e.g. request ids); 'text' holds the unescaped
+// contents of strings and the literal of everything else.
+struct JsonValue {
+    enum class Type { String, Number, Bool, Null };
+    Type type = Type::Null;
+    std::string text;
+    std::string raw;
+};
+
+// Parses a single flat JSON object whose values are strings, numbers,
+// booleans or null. Nested arrays and objects are rejected. Returns false
+// with 'error' set on malformed input.
+bool parseJsonObject(const std::string& input, std::map<std::string, JsonValue>& out,
+                     std::string& error);
@@ -0,0 +1,207 @@
+// Implementation of the C API declared in include/mixxx_analyzer.h.
+
+#include "mixxx_analyzer.h"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "AnalysisSession.h"
+
+struct mxa_session {
+    // Audio reaches the analyzers in blocks of this many frames whatever the
+    // caller's buffer sizes, matching the decoder's chunk size.
+    static constexpr std::size_t kBlockFrames = 8192;
+
+    int channels = 0;
+    std::unique_ptr<AnalysisSession> analysis;
+
+    // Partial block carried between pushes (and conversion target for
+    // non-stereo input), interleaved stereo.
+    std::vector<float> block;
+    std::size_t blockFrames = 0;
+    std::size_t totalFrames = 0;
+
+    bool finalized = false;
+    bool hasResult = false;
+    AnalysisResult result{};
+
+    void flushBlock() {
+        analysis->feed(block.data(), static_cast<int>(blockFrames));
+        blockFrames = 0;
+    }
+
+    // Appends up to 'numFrames' frames to the block, converting to stereo.
+    // Returns the number of frames consumed.
+    std::size_t fillBlock(const float* samples, std::size_t numFrames) {
+        const std::size_t n = std::min(numFrames, kBlockFrames - blockFrames);
+        float* dst = block.data() + blockFrames * 2;
+        for (std::size_t i = 0; i < n; ++i) {
+            const float* frame = samples + i * channels;
+            dst[2 * i] = frame[0];
+            dst[2 * i + 1] = channels == 1 ? frame[0] : frame[1];
+        }
+        blockFrames += n;
+        if (blockFrames == kBlockFrames)
+            flushBlock();
+        return n;
+    }
+
+    void push(const float* samples, std::size_t numFrames) {
+        totalFrames += numFrames;
+        if (channels != 2) {
+            while (numFrames > 0) {
+                const std::size_t n = fillBlock(samples, numFrames);
+                samples += n * channels;
+                numFrames -= n;
+            }
+            return;
+        }
+        // Stereo: top up a pending partial block, then hand whole blocks to
+        // the analyzers straight from the caller's buffer.
+        if (blockFrames > 0) {
+            const std::size_t n = fillBlock(samples, numFrames);
+            samples += n * 2;
+            numFrames -= n;
+        }
+        while (numFrames >= kBlockFrames) {
+            analysis->feed(samples, static_cast<int>(kBlockFrames));
+            samples += kBlockFrames * 2;
+            numFrames -= kBlockFrames;
+        }
+        if (numFrames > 0)
+            fillBlock(samples, numFrames);
+    }
+};
+
+namespace {
+
+// Runs 'fn' and maps any escaping C++ exception to MXA_ERROR_INTERNAL, which
+// must never cross the C boundary.
+template <typename Fn>
+mxa_status guarded(Fn fn) {
+    try {
+        return fn();
+    } catch (...) {
+        return MXA_ERROR_INTERNAL;
+    }
+}
+
+mxa_status checkResult(const mxa_session* session) {
+    if (!session)
+        return MXA_ERROR_INVALID_ARGUMENT;
+    return session->hasResult ? MXA_OK : MXA_ERROR_BAD_STATE;
+}
+
+}  // namespace
+
+extern "C" {
+
+int mxa_api_version(void) {
+    return MXA_API_VERSION;
+}
+
+mxa_session* mxa_session_create(int sample_rate, int channels) {
+    if (sample_rate <= 0 || channels <= 0)
+        return nullptr;
+    try {
+        auto session = std::make_unique<mxa_session>();
+        session->channels = channels;
+        session->analysis = std::make_unique<AnalysisSession>(sample_rate, false);
+        session->block.resize(mxa_session::kBlockFrames * 2);
+        return session.release();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void mxa_session_destroy(mxa_session* session) {
+    delete session;
+}
+
+mxa_status mxa_session_push(mxa_session* session, const float* interleaved,
+                            size_t num_frames) {
+    if (!session || (!interleaved && num_frames > 0))
+        return MXA_ERROR_INVALID_ARGUMENT;
+    if (session->finalized)
+        return MXA_ERROR_BAD_STATE;
+    return guarded([&] {
+        session->push(interleaved, num_frames);
+        return MXA_OK;
+    });
+}
+
+mxa_status mxa_session_finalize(mxa_session* session) {
+    if (!session)
+        return MXA_ERROR_INVALID_ARGUMENT;
+    if (session->finalized)
+        return MXA_ERROR_BAD_STATE;
+    session->finalized = true;
+    if (session->totalFrames == 0)
+        return MXA_ERROR_NO_AUDIO;
+    return guarded([&] {
+        if (session->blockFrames > 0)
+            session->flushBlock();
+        session->analysis->finish(session->result);
+        session->hasResult = true;
+        return MXA_OK;
+    });
+}
+
+mxa_status mxa_session_bpm(const mxa_session* session, double* bpm) {
+    if (!bpm)
+        return MXA_ERROR_INVALID_ARGUMENT;
+    const mxa_status status = checkResult(session);
+    if (status == MXA_OK)
+        *bpm = session->result.bpm;
+    return status;
+}
+
+mxa_status mxa_session_beatgrid(const mxa_session* session, const double** beats,
+                                size_t* num_beats) {
+    if (!beats || !num_beats)
+        return MXA_ERROR_INVALID_ARGUMENT;
+    const mxa_status status = checkResult(session);
+    if (status == MXA_OK) {
+        *beats = session->result.beatgrid.data();
+        *num_beats = session->result.beatgrid.size();
+    }
+    return status;
+}
+
+mxa_status mxa_session_key(const mxa_session* session, const char** key, const char** camelot) {
+    if (!key || !camelot)
+        return MXA_ERROR_INVALID_ARGUMENT;
+    const mxa_status status = checkResult(session);
+    if (status == MXA_OK) {
+        *key = session->result.key.c_str();
+        *camelot = session->result.camelot.c_str();
+    }
+    return status;
+}
+
+mxa_status mxa_session_loudness(const mxa_session* session, double* lufs, double* replay_gain) {
+    if (!lufs || !replay_gain)
+        return MXA_ERROR_INVALID_ARGUMENT;
+    const mxa_status status = checkResult(session);
+    if (status == MXA_OK) {
+        *lufs = session->result.lufs;
+        *replay_gain = session->result.replayGain;
+    }
+    return status;
+}
+
+mxa_status mxa_session_intro_outro(const mxa_session* session, double* intro_secs,
+                                   double* outro_secs) {
+    if (!intro_secs || !outro_secs)
+        return MXA_ERROR_INVALID_ARGUMENT;
+    const mxa_status status = checkResult(session);
+    if (status == MXA_OK) {
+        *intro_secs = session->result.introSecs;
+        *outro_secs = session->result.outroSecs;
+    }
+    return status;
+}
+
+}  // extern "C"
@@ -0,0 +1,285 @@
+// In-process Python extension (mixxx_analyzer._native).
+//
+// Runs the same analysis as the CLI without a subprocess or JSON round trip.
+// The GIL is released while files are decoded and analyzed, so Python threads
+// can analyze concurrently, and beatgrids are handed over as float64 NumPy
+// arrays that take ownership of the analyzer's std::vector without copying.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AnalysisCache.h"
+#include "FileAnalysis.h"
+
+namespace {
+
+// Owns a beatgrid vector on behalf of the NumPy array viewing its data.
+void destroyBeatgrid(PyObject* capsule) {
+    delete static_cast<std::vector<double>*>(PyCapsule_GetPointer(capsule, nullptr));
+}
+
+PyObject* beatgridArray(std::vector<double>&& beats) {
+    auto owned = std::make_unique<std::vector<double>>(std::move(beats));
+    npy_intp dims[1] = {static_cast<npy_intp>(owned->size())};
+    PyObject* array = PyArray_SimpleNewFromData(1, dims, NPY_FLOAT64, owned->data());
+    if (!array)
+        return nullptr;
+    PyObject* capsule = PyCapsule_New(owned.get(), nullptr, destroyBeatgrid);
+    if (!capsule) {
+        Py_DECREF(array);
+        return nullptr;
+    }
+    owned.release();
+    // Steals the capsule reference, also on failure.
+    if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject*>(array), capsule) < 0) {
+        Py_DECREF(array);
+        return nullptr;
+    }
+    return array;
+}
+
+// Adds 'value' to 'dict' under 'name', consuming the reference. Returns false
+// if 'value' is null or the insertion fails.
+bool setItem(PyObject* dict, const char* name, PyObject* value) {
+    if (!value)
+        return false;
+    const int rc = PyDict_SetItemString(dict, name, value);
+    Py_DECREF(value);
+    return rc == 0;
+}
+
+// Builds the same record as the --ndjson output: the result fields for a
+// successful file, {"file", "error"} for a failed one.
+PyObject* outcomeToDict(const std::string& path, bool ok, AnalysisResult& r,
+                        const std::string& error) {
+    PyObject* d = PyDict_New();
+    if (!d)
+        return nullptr;
+    bool good = setItem(d, "file", PyUnicode_DecodeFSDefault(path.c_str()));
+    if (!ok) {
+        good = good && setItem(d, "error", PyUnicode_FromString(error.c_str()));
+    } else {
+        // Fields of analyzers that did not run are None.
+        auto setOptional = [&](const char* name, bool selected, auto makeValue) {
+            if (selected)
+                good = good && setItem(d, name, makeValue());
+            else
+                good = good && PyDict_SetItemString(d, name, Py_None) == 0;
+        };
+        auto makeString = [](const std::string& value) {
+            // Tags are not guaranteed to be valid UTF-8; keep bad bytes visible.
+            return PyUnicode_DecodeUTF8(value.data(), value.size(), "replace");
+        };
+        const AnalyzerSelection& analyzers = r.analyzers;
+        setOptional("bpm", analyzers.bpm && r.bpm > 0.0f,
+                    [&] { return PyFloat_FromDouble(r.bpm); });
+        setOptional("key", analyzers.key, [&] { return makeString(r.key); });
+        setOptional("camelot", analyzers.key, [&] { return makeString(r.camelot); });
+        const std::pair<const char*, const std::string*> tags[] = {
+            {"title", &r.tags.title},
+            {"artist", &r.tags.artist},
+            {"album", &r.tags.album},
+            {"year", &r.tags.year},
+            {"genre", &r.tags.genre},
+            {"label", &r.tags.label},
+            {"comment", &r.tags.comment},
+            {"trackNumber", &r.tags.trackNumber},
+            {"bpmTag", &r.tags.bpmTag},
+        };
+        for (const auto& [name, value] : tags) {
+            good = good && setItem(d, name, makeString(*value));
+        }
+        setOptional("lufs", analyzers.gain, [&] { return PyFloat_FromDouble(r.lufs); });
+        setOptional("replayGain", analyzers.gain,
+                    [&] { return PyFloat_FromDouble(r.replayGain); });
+        setOptional("introSecs", analyzers.anyIntro(),
+                    [&] { return PyFloat_FromDouble(r.introSecs); });
+        setOptional("outroSecs", analyzers.silence,
+                    [&] { return PyFloat_FromDouble(r.outroSecs); });
+        setOptional("beatgrid", analyzers.bpm,
+                    [&] { return beatgridArray(std::move(r.beatgrid)); });
+    }
+    if (!good) {
+        Py_DECREF(d);
+        return nullptr;
+    }
+    return d;
+}
+
+// Reads the optional 'only' argument (None or a comma-separated list of
+// analyzer names) into 'analyzers'. Returns false with a Python exception set
+// on failure.
+bool toSelection(PyObject* only, AnalyzerSelection& analyzers) {
+    if (only == Py_None)
+        return true;
+    const char* list = PyUnicode_AsUTF8(only);
+    if (!list)
+        return false;
+    std::string error;
+    if (!parseAnalyzerSelection(list, analyzers, error)) {
+        PyErr_SetString(PyExc_ValueError, error.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Opens the optional result cache named by 'cacheDir' (None disables it) for
+// results of 'analyzers'. Returns false with a Python exception set on failure.
+bool openCache(PyObject* cacheDir, const AnalyzerSelection& analyzers,
+               std::unique_ptr<AnalysisCache>& cache) {
+    if (cacheDir == Py_None)
+        return true;
+    PyObject* bytes = nullptr;
+    if (!PyUnicode_FSConverter(cacheDir, &bytes))
+        return false;
+    cache = std::make_unique<AnalysisCache>(PyBytes_AS_STRING(bytes),
+                                            analysisConfigSignature(analyzers));
+    Py_DECREF(bytes);
+    std::string error;
+    if (!cache->open(error)) {
+        PyErr_SetString(PyExc_OSError, error.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool toPath(PyObject* obj, std::string& path) {
+    PyObject* bytes = nullptr;
+    if (!PyUnicode_FSConverter(obj, &bytes))
+        return false;
+    path.assign(PyBytes_AS_STRING(bytes), PyBytes_GET_SIZE(bytes));
+    Py_DECREF(bytes);
+    return true;
+}
+
+PyObject* analyze(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"path", "pipeline", "cache_dir", "only", nullptr};
+    PyObject* pathObj = nullptr;
+    int pipeline = 0;
+    PyObject* cacheDir = Py_None;
+    PyObject* only = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|pOO", const_cast<char**>(kwlist), &pathObj,
+                                     &pipeline, &cacheDir, &only))
+        return nullptr;
+
+    AnalyzeOptions options;
+    std::string path;
+    std::unique_ptr<AnalysisCache> cache;
+    if (!toPath(pathObj, path) || !toSelection(only, options.analyzers) ||
+        !openCache(cacheDir, options.analyzers, cache))
+        return nullptr;
+
+    options.pipelined = pipeline != 0;
+    options.cache = cache.get();
+
+    AnalysisResult result;
+    std::string error;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS;
+    ok = analyzeFile(path, options, result, error);
+    Py_END_ALLOW_THREADS;
+    return outcomeToDict(path, ok, result, error);
+}
+
+PyObject* analyzeMany(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* kwlist[] = {"paths", "jobs", "pipeline", "cache_dir", "only", nullptr};
+    PyObject* pathsObj = nullptr;
+    int jobs = 1;
+    int pipeline = 0;
+    PyObject* cacheDir = Py_None;
+    PyObject* only = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|ipOO", const_cast<char**>(kwlist),
+                                     &pathsObj, &jobs, &pipeline, &cacheDir, &only))
+        return nullptr;
+    if (jobs < 0) {
+        PyErr_SetString(PyExc_ValueError, "jobs must be non-negative");
+        return nullptr;
+    }
+
+    std::vector<std::string> paths;
+    {
+        PyObject* seq = PySequence_Fast(pathsObj, "paths must be a sequence");
+        if (!seq)
+            return nullptr;
+        const Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+        paths.resize(static_cast<std::size_t>(n));
+        for (Py_ssize_t i = 0; i < n; ++i) {
+            if (!toPath(PySequence_Fast_GET_ITEM(seq, i), paths[i])) {
+                Py_DECREF(seq);
+                return nullptr;
+            }
+        }
+        Py_DECREF(seq);
+    }
+
+    AnalyzeOptions options;
+    std::unique_ptr<AnalysisCache> cache;
+    if (!toSelection(only, options.analyzers) || !openCache(cacheDir, options.analyzers, cache))
+        return nullptr;
+
+    options.pipelined = pipeline != 0;
+    options.cache = cache.get();
+    if (jobs == 0)
+        jobs = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    std::vector<FileOutcome> outcomes;
+    outcomes.reserve(paths.size());
+    Py_BEGIN_ALLOW_THREADS;
+    analyzeBatch(paths, jobs, options,
+                 [&](FileOutcome& outcome) { outcomes.push_back(std::move(outcome)); });
+    Py_END_ALLOW_THREADS;
+
+    PyObject* list = PyList_New(static_cast<Py_ssize_t>(outcomes.size()));
+    if (!list)
+        return nullptr;
+    for (std::size_t i = 0; i < outcomes.size(); ++i) {
+        FileOutcome& o = outcomes[i];
+        PyObject* d = outcomeToDict(paths[i], o.ok, o.result, o.error);
+        if (!d) {
+            Py_DECREF(list);
+            return nullptr;
+        }
+        PyList_SET_ITEM(list, static_cast<Py_ssize_t>(i), d);
+    }
+    return list;
+}
+
+PyMethodDef kMethods[] = {
+    {"analyze", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(analyze)),
+     METH_VARARGS | METH_KEYWORDS,
+     "analyze(path, pipeline=False, cache_dir=None, only=None) -> dict\n\n"
+     "Analyze one file. Returns the --ndjson record as a dict, with 'beatgrid'\n"
+     "as a float64 NumPy array, or {'file', 'error'} if the file failed.\n"
+     "'only' is an --only list such as 'bpm,key'; other fields are None."},
+    {"analyze_many", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(analyzeMany)),
+     METH_VARARGS | METH_KEYWORDS,
+     "analyze_many(paths, jobs=1, pipeline=False, cache_dir=None, only=None) -> list[dict]\n\n"
+     "Analyze several files on up to 'jobs' threads (0 = one per CPU core).\n"
+     "Records are returned in the order of 'paths'."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyModuleDef kModule = {
+    PyModuleDef_HEAD_INIT,
+    "_native",
+    "In-process mixxx-analyzer bindings.",
+    -1,
+    kMethods,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+};
+
+}  // namespace
+
+PyMODINIT_FUNC PyInit__native() {
+    import_array();
+    return PyModule_Create(&kModule);
+}
@@ -7,15 +7,22 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <optional>
 #include <vector>
 
 namespace {
 
+// Bump when the analysis changes in a way the constants below don't capture.
+constexpr int kAlgorithmRevision = 3;
+
 // Exact constants from mixxx::AnalyzerQueenMaryBeats
 constexpr float kStepSecs = 0.01161f;
 constexpr int kMaximumBinSizeHz = 50;
 
+// Detection function windows handed over per helper callback.
+constexpr size_t kWindowsPerBatch = 16;
+
 DFConfig makeDetectionFunctionConfig(int stepSizeFrames, int windowSize) {
     DFConfig config;
     config.DFType = DF_COMPLEXSD;
@@ -246,17 +253,27 @@ double makeConstBpm(const std::vector<ConstRegion>& regions, int sampleRate) {
 
 }  // namespace
 
-QmBpmAnalyzer::QmBpmAnalyzer(int sampleRate)
+QmBpmAnalyzer::QmBpmAnalyzer(int sampleRate, bool singlePrecision)
     : m_sampleRate(sampleRate), m_windowSize(0), m_stepSizeFrames(0) {
     m_stepSizeFrames = static_cast<int>(m_sampleRate * kStepSecs);
     m_windowSize = MathUtilities::nextPowerOfTwo(m_sampleRate / kMaximumBinSizeHz);
-    m_pDetectionFunction = std::make_unique<DetectionFunction>(
-        makeDetectionFunctionConfig(m_stepSizeFrames, m_windowSize));
-
-    m_helper.initialize(m_windowSize, m_stepSizeFrames, [this](double* pWindow, size_t) {
-        m_detectionResults.push_back(m_pDetectionFunction->processTimeDomain(pWindow));
-        return true;
-    });
+    const DFConfig config = makeDetectionFunctionConfig(m_stepSizeFrames, m_windowSize);
+    if (singlePrecision)
+        m_pDetectionFunctionFloat = std::make_unique<DetectionFunctionT<float>>(config);
+    else
+        m_pDetectionFunction = std::make_unique<DetectionFunction>(config);
+
+    m_helper.initialize(m_windowSize, m_stepSizeFrames, kWindowsPerBatch,
+                        [this](double* pFirstWindow, size_t numWindows) {
+                            for (size_t i = 0; i < numWindows; ++i) {
+                                const double* window = pFirstWindow + i * m_stepSizeFrames;
+                                m_detectionResults.push_back(
+                                    m_pDetectionFunction
+                                        ? m_pDetectionFunction->processTimeDomain(window)
+                                        : m_pDetectionFunctionFloat->processTimeDomain(window));
+                            }
+                            return true;
+                        });
 }
 
 QmBpmAnalyzer::~QmBpmAnalyzer() = default;
@@ -265,6 +282,10 @@ void QmBpmAnalyzer::feed(const float* interleavedStereo, int numFrames) {
     m_helper.processStereoSamples(interleavedStereo, static_cast<size_t>(numFrames) * 2);
 }
 
+void QmBpmAnalyzer::feedMono(const double* mono, int numFrames) {
+    m_helper.processMonoSamples(mono, static_cast<size_t>(numFrames));
+}
+
 float QmBpmAnalyzer::result() {
     m_beatFrames.clear();
     m_beats.clear();
@@ -321,3 +342,12 @@ std::vector<double> QmBpmAnalyzer::beatFramesSecs() const {
     }
     return secs;
 }
+
+std::string QmBpmAnalyzer::configSignature() {
+    char buf[128];
+    std::snprintf(buf, sizeof(buf),
+                  "qmbpm/%d step=%g maxbin=%d phase=%g,%g outliers=%d minbeats=%d",
+                  kAlgorithmRevision, kStepSecs, kMaximumBinSizeHz, kMaxSecsPhaseError,
+                  kMaxSecsPhaseErrorSum, kMaxOutliersCount, kMinRegionBeatCount);
+    return buf;
+}
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "DownmixAndOverlapHelper.h"
 
-class DetectionFunction;
+template <typename T>
+class DetectionFunctionT;
 
 // Detects BPM using the Queen Mary tempo tracker — exact port of
 // mixxx::AnalyzerQueenMaryBeats (AnalyzerQueenMaryBeats.cpp).
@@ -13,24 +15,34 @@ class DetectionFunction;
 // beat positions. Use beatFramesSecs() to retrieve beat positions in seconds.
 class QmBpmAnalyzer {
   public:
-    explicit QmBpmAnalyzer(int sampleRate);
+    // With singlePrecision the onset detection function runs in float, which
+    // may move a beat by one detection-function step.
+    explicit QmBpmAnalyzer(int sampleRate, bool singlePrecision = false);
     ~QmBpmAnalyzer();
 
     // Feed interleaved stereo float32 samples (numFrames * 2 floats).
     void feed(const float* interleavedStereo, int numFrames);
 
+    // Feed the same audio already downmixed with downmixStereoToMono().
+    void feedMono(const double* mono, int numFrames);
+
     // Finalises analysis and returns detected BPM (0 if undetected).
     float result();
 
     // Returns beat positions in seconds (populated after result() is called).
     std::vector<double> beatFramesSecs() const;
 
+    // Identifies the algorithm revision and constants that affect results.
+    static std::string configSignature();
+
   private:
     int m_sampleRate;
     int m_windowSize;
     int m_stepSizeFrames;
 
-    std::unique_ptr<DetectionFunction> m_pDetectionFunction;
+    // Exactly one of these is set.
+    std::unique_ptr<DetectionFunctionT<double>> m_pDetectionFunction;
+    std::unique_ptr<DetectionFunctionT<float>> m_pDetectionFunctionFloat;
     DownmixAndOverlapHelper m_helper;
     std::vector<double> m_detectionResults;
     std::vector<double> m_beats;       // beat positions in df-increment units
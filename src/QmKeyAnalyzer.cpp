@@ -9,13 +9,18 @@
 #include "QmKeyAnalyzer.h"
 
 #include <dsp/keydetection/GetKeyMode.h>
+#include <dsp/rateconversion/Decimator.h>
 
 #include <algorithm>
+#include <cstdio>
 #include <map>
 #include <stdexcept>
 
 static constexpr int kTuningFrequencyHz = 440;
 
+// Bump when the analysis changes in a way the constants don't capture.
+static constexpr int kAlgorithmRevision = 2;
+
 // ── Camelot wheel mapping ────────────────────────────────────────────────────
 // ChromaticKey enum (from Mixxx's keys.proto):
 //   1=C_MAJOR..12=B_MAJOR, 13=C_MINOR..24=B_MINOR
@@ -59,15 +64,29 @@ static const KeyInfo kKeyInfo[25] = {
 
 // ── Constructor ──────────────────────────────────────────────────────────────
 
-QmKeyAnalyzer::QmKeyAnalyzer(int sampleRate) {
+QmKeyAnalyzer::QmKeyAnalyzer(int sampleRate, bool singlePrecision) {
     GetKeyMode::Config cfg(static_cast<double>(sampleRate), kTuningFrequencyHz);
+    cfg.singlePrecision = singlePrecision;
     m_pKeyMode = std::make_unique<GetKeyMode>(cfg);
 
-    const size_t windowSize = static_cast<size_t>(m_pKeyMode->getBlockSize());
-    const size_t stepSize = static_cast<size_t>(m_pKeyMode->getHopSize());
+    // The stream is decimated once as it arrives and chroma frames are cut
+    // from the decimated signal. Mixxx decimates each block separately, but
+    // the decimator keeps its filter state between blocks and blocks don't
+    // overlap (frameOverlapFactor 1), so the frames are identical.
+    const int factor = m_pKeyMode->getDecimationFactor();
+    m_pDecimator = std::make_unique<Decimator>(factor, factor);
+    m_blockSize = static_cast<size_t>(m_pKeyMode->getBlockSize());
+    m_hopSize = static_cast<size_t>(m_pKeyMode->getHopSize());
+    // Mixxx centers the first block with blockSize / 2 leading zeros. They
+    // leave the filter at rest, so only the decimated zeros are fed.
+    m_streamFrames = m_blockSize / 2;
+
+    const size_t windowSize = static_cast<size_t>(m_pKeyMode->getChromaFrameSize());
+    const size_t stepSize = static_cast<size_t>(m_pKeyMode->getChromaHopSize());
 
     m_helper.initialize(windowSize, stepSize, [this](double* pWindow, size_t) -> bool {
-        int key = m_pKeyMode->process(pWindow);
+        ++m_blocksDone;
+        int key = m_pKeyMode->processDecimated(pWindow);
         // key range is 0-24 (0 = no key detected)
         if (key < 0 || key > 24)
             key = 0;
@@ -86,13 +105,36 @@ QmKeyAnalyzer::~QmKeyAnalyzer() = default;
 void QmKeyAnalyzer::feed(const float* stereoFrames, int numFrames) {
     m_currentFrame += static_cast<size_t>(numFrames);
     m_totalFrames += numFrames;
-    m_helper.processStereoSamples(stereoFrames, numFrames * 2);
+    if (m_mono.size() < static_cast<size_t>(numFrames))
+        m_mono.resize(numFrames);
+    downmixStereoToMono(stereoFrames, m_mono.data(), numFrames);
+    decimateAndWindow(m_mono.data(), numFrames);
+}
+
+void QmKeyAnalyzer::feedMono(const double* mono, int numFrames) {
+    m_currentFrame += static_cast<size_t>(numFrames);
+    m_totalFrames += numFrames;
+    decimateAndWindow(mono, numFrames);
+}
+
+void QmKeyAnalyzer::decimateAndWindow(const double* mono, int numFrames) {
+    const size_t maxOut = static_cast<size_t>(numFrames) / m_pDecimator->getFactor() + 1;
+    if (m_decimated.size() < maxOut)
+        m_decimated.resize(maxOut);
+    const int written = m_pDecimator->processStream(mono, numFrames, m_decimated.data());
+    m_streamFrames += static_cast<size_t>(numFrames);
+    m_helper.processMonoSamples(m_decimated.data(), static_cast<size_t>(written));
 }
 
 // ── Result ───────────────────────────────────────────────────────────────────
 
 QmKeyAnalyzer::Result QmKeyAnalyzer::result() {
-    m_helper.finalize();
+    // Pad the stream the way DownmixAndOverlapHelper::finalize() pads the
+    // undecimated blocks, so the same last block is processed.
+    const size_t blockFill = m_streamFrames - m_blocksDone * m_hopSize;
+    const size_t padFrames = std::max(m_blockSize - blockFill, m_blockSize / 2 - 1);
+    const std::vector<double> silence(padFrames, 0.0);
+    decimateAndWindow(silence.data(), static_cast<int>(padFrames));
     m_pKeyMode.reset();
 
     if (m_keyChanges.empty()) {
@@ -125,3 +167,12 @@ QmKeyAnalyzer::Result QmKeyAnalyzer::result() {
         globalKey = 0;
     return {globalKey, kKeyInfo[globalKey].name, kKeyInfo[globalKey].camelot};
 }
+
+std::string QmKeyAnalyzer::configSignature() {
+    const GetKeyMode::Config cfg(0.0, kTuningFrequencyHz);
+    char buf[128];
+    std::snprintf(buf, sizeof(buf), "qmkey/%d tuning=%g hpcp=%g median=%g overlap=%d decim=%d",
+                  kAlgorithmRevision, cfg.tuningFrequency, cfg.hpcpAverage, cfg.medianAverage,
+                  cfg.frameOverlapFactor, cfg.decimationFactor);
+    return buf;
+}
@@ -6,6 +6,7 @@
 
 #include "DownmixAndOverlapHelper.h"
 
+class Decimator;
 class GetKeyMode;
 
 // 1:1 port of Mixxx's AnalyzerQueenMaryKey + calculateGlobalKey logic.
@@ -20,15 +21,31 @@ class QmKeyAnalyzer {
         std::string camelot;  // e.g. "7A"
     };
 
-    explicit QmKeyAnalyzer(int sampleRate);
+    // With singlePrecision the chromagram runs in float.
+    explicit QmKeyAnalyzer(int sampleRate, bool singlePrecision = false);
     ~QmKeyAnalyzer();
 
     void feed(const float* stereoFrames, int numFrames);
+    // Feed the same audio already downmixed with downmixStereoToMono().
+    void feedMono(const double* mono, int numFrames);
     Result result();
 
+    // Identifies the algorithm revision and constants that affect results.
+    static std::string configSignature();
+
   private:
+    // Decimates mono input and feeds it into the chroma frame windows.
+    void decimateAndWindow(const double* mono, int numFrames);
+
     std::unique_ptr<GetKeyMode> m_pKeyMode;
-    DownmixAndOverlapHelper m_helper;
+    std::unique_ptr<Decimator> m_pDecimator;
+    DownmixAndOverlapHelper m_helper;  // windows over the decimated stream
+    std::vector<double> m_mono;
+    std::vector<double> m_decimated;
+    size_t m_blockSize{0};     // undecimated GetKeyMode block and hop
+    size_t m_hopSize{0};
+    size_t m_streamFrames{0};  // undecimated frames incl. leading padding
+    size_t m_blocksDone{0};
     size_t m_currentFrame{0};
     int m_totalFrames{0};
 
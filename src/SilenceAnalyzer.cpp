@@ -1,31 +1,121 @@
 #include "SilenceAnalyzer.h"
 
 #include <cmath>
+#include <cstdio>
 
-SilenceAnalyzer::SilenceAnalyzer(int sampleRate, int channels)
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SILENCE_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SILENCE_NEON 1
+#endif
+
+namespace {
+// Bump when the analysis changes in a way kThreshold doesn't capture.
+constexpr int kAlgorithmRevision = 1;
+
+// Samples tested per vector step.
+constexpr int kBlock = 16;
+
+// True if any of the kBlock samples at x reaches 'threshold' in magnitude.
+// NaNs never do, as with std::fabs(x) >= threshold.
+inline bool anyLoud(const float* x, float threshold) {
+#if defined(SILENCE_SSE2)
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 t = _mm_set1_ps(threshold);
+    __m128 hit = _mm_cmpge_ps(_mm_and_ps(_mm_loadu_ps(x), absMask), t);
+    hit = _mm_or_ps(hit, _mm_cmpge_ps(_mm_and_ps(_mm_loadu_ps(x + 4), absMask), t));
+    hit = _mm_or_ps(hit, _mm_cmpge_ps(_mm_and_ps(_mm_loadu_ps(x + 8), absMask), t));
+    hit = _mm_or_ps(hit, _mm_cmpge_ps(_mm_and_ps(_mm_loadu_ps(x + 12), absMask), t));
+    return _mm_movemask_ps(hit) != 0;
+#elif defined(SILENCE_NEON)
+    const float32x4_t t = vdupq_n_f32(threshold);
+    uint32x4_t hit = vcgeq_f32(vabsq_f32(vld1q_f32(x)), t);
+    hit = vorrq_u32(hit, vcgeq_f32(vabsq_f32(vld1q_f32(x + 4)), t));
+    hit = vorrq_u32(hit, vcgeq_f32(vabsq_f32(vld1q_f32(x + 8)), t));
+    hit = vorrq_u32(hit, vcgeq_f32(vabsq_f32(vld1q_f32(x + 12)), t));
+    return vmaxvq_u32(hit) != 0;
+#else
+    for (int i = 0; i < kBlock; ++i) {
+        if (std::fabs(x[i]) >= threshold)
+            return true;
+    }
+    return false;
+#endif
+}
+
+// Index of the first sample of x[0, count) at or above 'threshold' in
+// magnitude, or -1.
+int firstLoudSample(const float* x, int count, float threshold) {
+    int i = 0;
+    while (i + kBlock <= count && !anyLoud(x + i, threshold))
+        i += kBlock;
+    for (; i < count; ++i) {
+        if (std::fabs(x[i]) >= threshold)
+            return i;
+    }
+    return -1;
+}
+
+// Index of the last such sample, or -1.
+int lastLoudSample(const float* x, int count, float threshold) {
+    int end = count;
+    while (end - kBlock >= 0 && !anyLoud(x + end - kBlock, threshold))
+        end -= kBlock;
+    for (int i = end - 1; i >= 0; --i) {
+        if (std::fabs(x[i]) >= threshold)
+            return i;
+    }
+    return -1;
+}
+}  // namespace
+
+SilenceAnalyzer::SilenceAnalyzer(int sampleRate, int channels, bool introOnly)
     : m_sampleRate(sampleRate),
       m_channels(channels),
+      m_introOnly(introOnly),
       m_framesProcessed(0),
       m_signalStart(-1),
       m_signalEnd(-1) {}
 
 void SilenceAnalyzer::feed(const float* samples, int numFrames) {
-    const int count = numFrames * m_channels;
-    for (int i = 0; i < count; ++i) {
-        if (std::fabs(samples[i]) >= kThreshold) {
-            const long long frame = m_framesProcessed + i / m_channels;
-            if (m_signalStart < 0) {
-                m_signalStart = frame;
-            }
-            m_signalEnd = frame;
+    if (done())
+        return;
+    if (m_signalStart < 0) {
+        const int first = firstLoudFrame(samples, numFrames, m_channels);
+        if (first >= 0) {
+            m_signalStart = m_framesProcessed + first;
+            m_signalEnd = m_signalStart;
         }
     }
+    if (m_signalStart >= 0 && !m_introOnly) {
+        const int last = lastLoudFrame(samples, numFrames, m_channels);
+        if (last >= 0)
+            m_signalEnd = m_framesProcessed + last;
+    }
     m_framesProcessed += numFrames;
 }
 
+int SilenceAnalyzer::firstLoudFrame(const float* samples, int numFrames, int channels) {
+    const int i = firstLoudSample(samples, numFrames * channels, kThreshold);
+    return i < 0 ? -1 : i / channels;
+}
+
+int SilenceAnalyzer::lastLoudFrame(const float* samples, int numFrames, int channels) {
+    const int i = lastLoudSample(samples, numFrames * channels, kThreshold);
+    return i < 0 ? -1 : i / channels;
+}
+
 SilenceAnalyzer::Result SilenceAnalyzer::result() const {
     const double sr = static_cast<double>(m_sampleRate);
     const long long start = (m_signalStart < 0) ? 0 : m_signalStart;
     const long long end = (m_signalEnd < 0) ? m_framesProcessed : m_signalEnd + 1;
     return {start / sr, end / sr};
 }
+
+std::string SilenceAnalyzer::configSignature() {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "silence/%d threshold=%g", kAlgorithmRevision, kThreshold);
+    return buf;
+}
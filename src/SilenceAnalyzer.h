@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 // Detects the first and last non-silent frame in an audio stream.
 // Uses the same -60 dB threshold (0.001f) as Mixxx's AnalyzerSilence.
 class SilenceAnalyzer {
@@ -9,19 +11,33 @@ class SilenceAnalyzer {
         double outroSecs;  // time of last non-silent sample
     };
 
-    explicit SilenceAnalyzer(int sampleRate, int channels);
+    // With introOnly, only the first non-silent frame is looked for; the
+    // analyzer is done() once it is found and outroSecs is not computed.
+    explicit SilenceAnalyzer(int sampleRate, int channels, bool introOnly = false);
 
     // Feed interleaved float samples (numFrames * channels floats).
     void feed(const float* samples, int numFrames);
 
-    // Call after all audio has been fed.
+    // True once further audio cannot change the result.
+    bool done() const { return m_introOnly && m_signalStart >= 0; }
+
+    // Call after all audio has been fed, or once done().
     Result result() const;
 
+    // First and last frame of 'samples' with a sample at or above the
+    // threshold, or -1 if the frames are all silent.
+    static int firstLoudFrame(const float* samples, int numFrames, int channels);
+    static int lastLoudFrame(const float* samples, int numFrames, int channels);
+
+    // Identifies the algorithm revision and constants that affect results.
+    static std::string configSignature();
+
   private:
     static constexpr float kThreshold = 0.001f;  // -60 dB
 
     int m_sampleRate;
     int m_channels;
+    bool m_introOnly;
     long long m_framesProcessed;
     long long m_signalStart;  // -1 = not found yet
     long long m_signalEnd;
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Bounded single-producer / single-consumer ring of reusable slots.
+//
+// The data path is lock-free: the producer fills the slot returned by
+// beginWrite() and publishes it with commitWrite(); the consumer reads the
+// slot returned by beginRead() and hands it back with commitRead(). Slots are
+// never reallocated, so their contents (e.g. a std::vector's capacity) are
+// reused from one lap to the next.
+//
+// When the ring is full (or empty) the blocked side sleeps on a condition
+// variable instead of spinning, which gives backpressure without burning a
+// core. The mutex is only touched on those slow paths.
+template <typename T>
+class SpscRingBuffer {
+  public:
+    explicit SpscRingBuffer(std::size_t capacity) : m_slots(capacity > 0 ? capacity : 1) {}
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    // Producer: returns the next free slot, blocking while the ring is full.
+    T& beginWrite() {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == m_slots.size()) {
+            waitUntil(m_producerWaiting, [&] { return head - m_tail.load() < m_slots.size(); });
+        }
+        return m_slots[head % m_slots.size()];
+    }
+
+    // Producer: publishes the slot returned by beginWrite().
+    void commitWrite() {
+        m_head.fetch_add(1);
+        wake(m_consumerWaiting);
+    }
+
+    // Producer: no more slots will be written. Wakes a waiting consumer.
+    void close() {
+        m_closed.store(true);
+        wake(m_consumerWaiting);
+    }
+
+    // Consumer: returns the oldest published slot, blocking while the ring is
+    // empty. Returns nullptr once the ring is closed and fully drained.
+    T* beginRead() {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head.load(std::memory_order_acquire) == tail) {
+            waitUntil(m_consumerWaiting, [&] { return m_head.load() != tail || m_closed.load(); });
+            if (m_head.load(std::memory_order_acquire) == tail) {
+                return nullptr;
+            }
+        }
+        return &m_slots[tail % m_slots.size()];
+    }
+
+    // Consumer: releases the slot returned by beginRead() back to the producer.
+    void commitRead() {
+        m_tail.fetch_add(1);
+        wake(m_producerWaiting);
+    }
+
+  private:
+    template <typename Pred>
+    void waitUntil(std::atomic<bool>& waitingFlag, Pred ready) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        waitingFlag.store(true);
+        m_cond.wait(lock, ready);
+        waitingFlag.store(false);
+    }
+
+    // Sequentially consistent flag check pairs with the store in waitUntil():
+    // either the waiter sees our index update in its predicate, or we see its
+    // flag and notify under the mutex.
+    void wake(std::atomic<bool>& waitingFlag) {
+        if (waitingFlag.load()) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cond.notify_all();
+        }
+    }
+
+    std::vector<T> m_slots;
+    std::atomic<std::size_t> m_head{0};  // next slot to write (producer-owned)
+    std::atomic<std::size_t> m_tail{0};  // next slot to read (consumer-owned)
+    std::atomic<bool> m_closed{false};
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::atomic<bool> m_producerWaiting{false};
+    std::atomic<bool> m_consumerWaiting{false};
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Incremental 128-bit non-cryptographic hash (two independent 64-bit lanes:
+// FNV-1a and a multiply-xorshift mix). Used to fingerprint cache keys and
+// compressed audio streams; collisions are astronomically unlikely for that
+// purpose but it offers no protection against deliberate tampering.
+class StreamHasher {
+  public:
+    void update(const void* data, std::size_t size) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            m_a = (m_a ^ p[i]) * 0x100000001b3ULL;
+            m_b = (m_b + p[i] + 1) * 0x9e3779b97f4a7c15ULL;
+            m_b ^= m_b >> 29;
+        }
+        m_length += size;
+    }
+
+    void update(const std::string& s) {
+        update(s.data(), s.size());
+        // Length-delimit so ("ab", "c") and ("a", "bc") hash differently.
+        const std::uint64_t n = s.size();
+        update(&n, sizeof(n));
+    }
+
+    // 32 lowercase hex digits.
+    std::string hexDigest() const {
+        std::uint64_t b = m_b ^ m_length;
+        b ^= b >> 33;
+        b *= 0xff51afd7ed558ccdULL;
+        b ^= b >> 33;
+        char buf[33];
+        std::snprintf(buf, sizeof(buf), "%016llx%016llx", static_cast<unsigned long long>(m_a),
+                      static_cast<unsigned long long>(b));
+        return buf;
+    }
+
+  private:
+    std::uint64_t m_a = 0xcbf29ce484222325ULL;
+    std::uint64_t m_b = 0x84222325cbf29ce4ULL;
+    std::uint64_t m_length = 0;
+};
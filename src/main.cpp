@@ -1,117 +1,69 @@
+#include <algorithm>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
-#include "AudioDecoder.h"
-#include "GainAnalyzer.h"
-#include "QmBpmAnalyzer.h"
-#include "QmKeyAnalyzer.h"
-#include "SilenceAnalyzer.h"
+#include "AnalysisCache.h"
+#include "AnalysisResult.h"
+#include "AnalysisServer.h"
+#include "FileAnalysis.h"
+#include "JsonFormat.h"
 
 namespace {
 
+// Upper bound on --jobs; more workers than this only add memory and contention.
+constexpr long kMaxJobs = 1024;
+
 void printUsage(const char* argv0) {
-    std::fprintf(stderr, "Usage: %s [--json] <audiofile> [audiofile...]\n", argv0);
+    std::fprintf(stderr,
+                 "Usage: %s [--json | --ndjson] [--jobs N] [--pipeline] [--only LIST] "
+                 "[--preview SECS | --fast] [--qm-rate HZ] [--float32] [--cache DIR] "
+                 "<audiofile> [audiofile...]\n"
+                 "       %s --serve [--socket PATH] [--jobs N] [--pipeline] [--only LIST] "
+                 "[--preview SECS | --fast] [--qm-rate HZ] [--float32] [--cache DIR]\n",
+                 argv0, argv0);
     std::fprintf(stderr, "\nAnalyzes audio tracks and outputs BPM, key, gain, and intro/outro.\n");
-    std::fprintf(stderr, "\n  --json   Output results as a JSON array\n");
-}
-
-// Escape a string for embedding in JSON.
-std::string jsonEscape(const std::string& s) {
-    std::string out;
-    out.reserve(s.size() + 4);
-    for (unsigned char c : s) {
-        if (c == '"')
-            out += "\\\"";
-        else if (c == '\\')
-            out += "\\\\";
-        else if (c == '\n')
-            out += "\\n";
-        else if (c == '\r')
-            out += "\\r";
-        else if (c == '\t')
-            out += "\\t";
-        else if (c < 0x20) {
-            // Escape remaining control characters as \u00XX
-            char buf[7];
-            std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
-            out += buf;
-        } else
-            out += static_cast<char>(c);
-    }
-    return out;
-}
-
-struct AnalysisResult {
-    std::string path;
-    float bpm;
-    std::string key;
-    std::string camelot;
-    double lufs;
-    double replayGain;
-    double introSecs;
-    double outroSecs;
-    AudioDecoder::Tags tags;
-    std::vector<double> beatgrid;
-};
-
-bool analyzeFile(const std::string& path, AnalysisResult& out) {
-    int sampleRate = 0;
-    int channels = 0;
-    bool initialized = false;
-
-    std::unique_ptr<QmBpmAnalyzer> bpm;
-    std::unique_ptr<QmKeyAnalyzer> key;
-    std::unique_ptr<GainAnalyzer> gain;
-    std::unique_ptr<SilenceAnalyzer> silence;
-
-    std::string decodeError;
-    AudioDecoder::Tags tags;
-    bool ok = AudioDecoder::decode(
-        path,
-        [&](const float* samples, int numFrames, const AudioDecoder::AudioInfo& info) {
-            if (!initialized) {
-                sampleRate = info.sampleRate;
-                channels = info.channels;
-                bpm = std::make_unique<QmBpmAnalyzer>(sampleRate);
-                key = std::make_unique<QmKeyAnalyzer>(sampleRate);
-                gain = std::make_unique<GainAnalyzer>(sampleRate);
-                silence = std::make_unique<SilenceAnalyzer>(sampleRate, channels);
-                initialized = true;
-            }
-            bpm->feed(samples, numFrames);
-            key->feed(samples, numFrames);
-            gain->feed(samples, numFrames);
-            silence->feed(samples, numFrames);
-        },
-        decodeError, tags);
-
-    if (!ok) {
-        std::fprintf(stderr, "Error decoding '%s': %s\n", path.c_str(), decodeError.c_str());
-        return false;
-    }
-    if (!initialized) {
-        std::fprintf(stderr, "No audio data in '%s'\n", path.c_str());
-        return false;
-    }
-
-    GainAnalyzer::Result gainResult{};
-    bool gainOk = gain->result(gainResult);
-    QmKeyAnalyzer::Result detectedKey = key->result();
-    SilenceAnalyzer::Result silenceResult = silence->result();
-
-    out.path = path;
-    out.bpm = bpm->result();
-    out.key = detectedKey.key;
-    out.camelot = detectedKey.camelot;
-    out.lufs = gainOk ? gainResult.lufs : 0.0;
-    out.replayGain = gainOk ? gainResult.replayGain : 0.0;
-    out.introSecs = silenceResult.introSecs;
-    out.outroSecs = silenceResult.outroSecs;
-    out.tags = std::move(tags);
-    out.beatgrid = bpm->beatFramesSecs();
-    return true;
+    std::fprintf(stderr, "\n  --json       Output results as a JSON array\n");
+    std::fprintf(stderr,
+                 "  --ndjson     Output one JSON object per line as each file completes; "
+                 "failures\n               become {\"file\", \"error\"} records\n");
+    std::fprintf(stderr,
+                 "  --jobs N     Analyze up to N files in parallel (0 = one per CPU core, "
+                 "default 1)\n");
+    std::fprintf(stderr,
+                 "  --pipeline   Run each analyzer on its own thread while decoding (faster for "
+                 "long tracks)\n");
+    std::fprintf(stderr,
+                 "  --only LIST  Run only the comma-separated analyzers in LIST (bpm, key, gain,\n"
+                 "               silence, or intro for the intro alone); the other fields are\n"
+                 "               omitted, or null in JSON. Decoding stops early once the\n"
+                 "               selected analyzers have their answer\n");
+    std::fprintf(stderr,
+                 "  --preview SECS  Analyze only the first SECS seconds of each file\n");
+    std::fprintf(stderr,
+                 "  --fast       Estimate BPM and key from three 30 s excerpts found by seeking;\n"
+                 "               results are marked approximate, with no beatgrid, gain or\n"
+                 "               intro/outro\n");
+    std::fprintf(stderr,
+                 "  --qm-rate HZ Run BPM and key detection on audio resampled to HZ when the "
+                 "file's\n               rate is higher; faster on hi-res files, but results "
+                 "may differ\n               from Mixxx's (default 0 = native rate)\n");
+    std::fprintf(stderr,
+                 "  --float32    Run BPM and key detection in single precision; a few tracks may\n"
+                 "               get a different BPM or key than Mixxx gives them\n");
+    std::fprintf(stderr,
+                 "  --cache DIR  Reuse results stored in DIR for unchanged audio (created if "
+                 "missing)\n");
+    std::fprintf(stderr,
+                 "  --serve      Answer NDJSON requests {\"id\", \"path\"} from stdin on stdout "
+                 "using\n               a pool of --jobs workers\n");
+    std::fprintf(stderr,
+                 "  --socket PATH  With --serve, accept requests on a Unix domain socket "
+                 "instead\n");
 }
 
 void printHuman(const AnalysisResult& r) {
@@ -122,56 +74,32 @@ void printHuman(const AnalysisResult& r) {
         std::snprintf(buf, sizeof(buf), "%d:%05.2f", m, s);
         return buf;
     };
-    if (r.bpm > 0.0f) {
-        std::printf(
-            "%-50s  BPM: %6.2f  Key: %-10s (%3s)  LUFS: %7.2f  RG: %+.2f dB  Intro: %s  Outro: "
-            "%s\n",
-            r.path.c_str(), r.bpm, r.key.c_str(), r.camelot.c_str(), r.lufs, r.replayGain,
-            fmtTime(r.introSecs).c_str(), fmtTime(r.outroSecs).c_str());
-    } else {
-        std::printf(
-            "%-50s  BPM: (undetected)  Key: %-10s (%3s)  LUFS: %7.2f  RG: %+.2f dB  Intro: %s  "
-            "Outro: %s\n",
-            r.path.c_str(), r.key.c_str(), r.camelot.c_str(), r.lufs, r.replayGain,
-            fmtTime(r.introSecs).c_str(), fmtTime(r.outroSecs).c_str());
-    }
-}
-
-void printJson(const std::vector<AnalysisResult>& results) {
-    std::printf("[\n");
-    for (std::size_t i = 0; i < results.size(); ++i) {
-        const auto& r = results[i];
-        std::printf("  {\n");
-        std::printf("    \"file\": \"%s\",\n", jsonEscape(r.path).c_str());
+    char buf[128];
+    std::string line = r.path;
+    if (line.size() < 50)
+        line.resize(50, ' ');
+    if (r.analyzers.bpm) {
         if (r.bpm > 0.0f)
-            std::printf("    \"bpm\": %.2f,\n", r.bpm);
+            std::snprintf(buf, sizeof(buf), "  BPM: %6.2f", r.bpm);
         else
-            std::printf("    \"bpm\": null,\n");
-        std::printf("    \"key\": \"%s\",\n", jsonEscape(r.key).c_str());
-        std::printf("    \"camelot\": \"%s\",\n", jsonEscape(r.camelot).c_str());
-        std::printf("    \"lufs\": %.2f,\n", r.lufs);
-        std::printf("    \"replayGain\": %.2f,\n", r.replayGain);
-        std::printf("    \"introSecs\": %.3f,\n", r.introSecs);
-        std::printf("    \"outroSecs\": %.3f,\n", r.outroSecs);
-        // Tags as flat fields
-        std::printf("    \"title\": \"%s\",\n", jsonEscape(r.tags.title).c_str());
-        std::printf("    \"artist\": \"%s\",\n", jsonEscape(r.tags.artist).c_str());
-        std::printf("    \"album\": \"%s\",\n", jsonEscape(r.tags.album).c_str());
-        std::printf("    \"year\": \"%s\",\n", jsonEscape(r.tags.year).c_str());
-        std::printf("    \"genre\": \"%s\",\n", jsonEscape(r.tags.genre).c_str());
-        std::printf("    \"label\": \"%s\",\n", jsonEscape(r.tags.label).c_str());
-        std::printf("    \"comment\": \"%s\",\n", jsonEscape(r.tags.comment).c_str());
-        std::printf("    \"trackNumber\": \"%s\",\n", jsonEscape(r.tags.trackNumber).c_str());
-        std::printf("    \"bpmTag\": \"%s\",\n", jsonEscape(r.tags.bpmTag).c_str());
-        // Beatgrid as array of seconds
-        std::printf("    \"beatgrid\": [");
-        for (std::size_t j = 0; j < r.beatgrid.size(); ++j) {
-            std::printf("%.6f%s", r.beatgrid[j], (j + 1 < r.beatgrid.size()) ? "," : "");
-        }
-        std::printf("]\n");
-        std::printf("  }%s\n", (i + 1 < results.size()) ? "," : "");
+            std::snprintf(buf, sizeof(buf), "  BPM: (undetected)");
+        line += buf;
+    }
+    if (r.analyzers.key) {
+        std::snprintf(buf, sizeof(buf), "  Key: %-10s (%3s)", r.key.c_str(), r.camelot.c_str());
+        line += buf;
     }
-    std::printf("]\n");
+    if (r.analyzers.gain) {
+        std::snprintf(buf, sizeof(buf), "  LUFS: %7.2f  RG: %+.2f dB", r.lufs, r.replayGain);
+        line += buf;
+    }
+    if (r.analyzers.anyIntro())
+        line += "  Intro: " + fmtTime(r.introSecs);
+    if (r.analyzers.silence)
+        line += "  Outro: " + fmtTime(r.outroSecs);
+    if (r.approximate)
+        line += "  (approximate)";
+    std::printf("%s\n", line.c_str());
 }
 
 }  // namespace
@@ -182,7 +110,13 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    bool jsonMode = false;
+    enum class OutputMode { Human, Json, Ndjson };
+    OutputMode outputMode = OutputMode::Human;
+    int jobs = 1;
+    AnalyzeOptions options;
+    const char* cacheDir = nullptr;
+    bool serve = false;
+    const char* socketPath = nullptr;
     std::vector<std::string> files;
 
     for (int i = 1; i < argc; ++i) {
@@ -190,34 +124,147 @@ int main(int argc, char* argv[]) {
             printUsage(argv[0]);
             return 0;
         } else if (std::strcmp(argv[i], "--json") == 0) {
-            jsonMode = true;
+            outputMode = OutputMode::Json;
+        } else if (std::strcmp(argv[i], "--ndjson") == 0) {
+            outputMode = OutputMode::Ndjson;
+        } else if (std::strcmp(argv[i], "--jobs") == 0 || std::strcmp(argv[i], "-j") == 0) {
+            char* end = nullptr;
+            long n = (i + 1 < argc) ? std::strtol(argv[i + 1], &end, 10) : -1;
+            if (!end || *end != '\0' || n < 0 || n > kMaxJobs) {
+                std::fprintf(stderr, "--jobs expects a non-negative integer up to %ld\n", kMaxJobs);
+                return 1;
+            }
+            jobs = static_cast<int>(n);
+            ++i;
+        } else if (std::strcmp(argv[i], "--pipeline") == 0) {
+            options.pipelined = true;
+        } else if (std::strcmp(argv[i], "--only") == 0) {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "--only expects a list of analyzers\n");
+                return 1;
+            }
+            std::string error;
+            if (!parseAnalyzerSelection(argv[++i], options.analyzers, error)) {
+                std::fprintf(stderr, "--only: %s\n", error.c_str());
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--preview") == 0) {
+            char* end = nullptr;
+            double secs = (i + 1 < argc) ? std::strtod(argv[i + 1], &end) : -1.0;
+            if (!end || *end != '\0' || !(secs > 0.0)) {
+                std::fprintf(stderr, "--preview expects a positive number of seconds\n");
+                return 1;
+            }
+            options.previewSecs = secs;
+            ++i;
+        } else if (std::strcmp(argv[i], "--fast") == 0) {
+            options.fast = true;
+        } else if (std::strcmp(argv[i], "--qm-rate") == 0) {
+            if (i + 1 >= argc || !parseQmSampleRate(argv[++i], options.qmSampleRate)) {
+                std::fprintf(stderr, "--qm-rate expects 0 or a sample rate of %d to %d Hz\n",
+                             kMinQmSampleRate, kMaxQmSampleRate);
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--float32") == 0) {
+            options.singlePrecision = true;
+        } else if (std::strcmp(argv[i], "--cache") == 0) {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "--cache expects a directory\n");
+                return 1;
+            }
+            cacheDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--serve") == 0) {
+            serve = true;
+        } else if (std::strcmp(argv[i], "--socket") == 0) {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "--socket expects a path\n");
+                return 1;
+            }
+            socketPath = argv[++i];
+            serve = true;
         } else {
             files.push_back(argv[i]);
         }
     }
 
-    if (files.empty()) {
+    if (serve ? !files.empty() : files.empty()) {
         printUsage(argv[0]);
         return 1;
     }
+    if (options.fast && options.previewSecs > 0.0) {
+        std::fprintf(stderr, "--fast and --preview cannot be combined\n");
+        return 1;
+    }
+    if (options.fast && !options.analyzers.bpm && !options.analyzers.key) {
+        std::fprintf(stderr, "--fast only estimates bpm and key\n");
+        return 1;
+    }
+
+    std::unique_ptr<AnalysisCache> cache;
+    if (cacheDir) {
+        cache = std::make_unique<AnalysisCache>(
+            cacheDir, analysisConfigSignature(options.analyzers, options.qmSampleRate,
+                                              options.singlePrecision));
+        std::string error;
+        if (!cache->open(error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        options.cache = cache.get();
+    }
 
+    if (jobs == 0) {
+        jobs = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    if (serve) {
+        AnalysisServer server(options, jobs);
+        if (!socketPath) {
+            server.serveStream(stdin, stdout);
+            return 0;
+        }
+        std::string error;
+        if (!server.serveSocket(socketPath, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    // Every mode prints each outcome as soon as it is consumed, so memory stays
+    // bounded by the batch lookahead rather than by the number of files.
     bool allOk = true;
-    std::vector<AnalysisResult> results;
-
-    for (const auto& path : files) {
-        AnalysisResult r;
-        if (analyzeFile(path, r)) {
-            if (jsonMode)
-                results.push_back(std::move(r));
-            else
-                printHuman(r);
+    std::size_t fileIndex = 0;
+    std::size_t numJsonRecords = 0;
+    if (outputMode == OutputMode::Json)
+        std::printf("[\n");
+
+    analyzeBatch(files, jobs, options, [&](FileOutcome& outcome) {
+        const std::string& path = files[fileIndex++];
+        allOk = allOk && outcome.ok;
+        if (outputMode == OutputMode::Ndjson) {
+            if (outcome.ok) {
+                std::fputs(formatJsonRecord(outcome.result, false).c_str(), stdout);
+            } else {
+                std::fputs(formatJsonError(path, outcome.error).c_str(), stdout);
+            }
+            // Flush at record boundaries so a reader on a pipe can act on each
+            // file as soon as it is done.
+            std::fputc('\n', stdout);
+            std::fflush(stdout);
+        } else if (!outcome.ok) {
+            std::fprintf(stderr, "%s\n", outcome.error.c_str());
+        } else if (outputMode == OutputMode::Json) {
+            if (numJsonRecords++ > 0)
+                std::printf(",\n");
+            std::fputs(formatJsonRecord(outcome.result, true).c_str(), stdout);
         } else {
-            allOk = false;
+            printHuman(outcome.result);
         }
-    }
+    });
 
-    if (jsonMode)
-        printJson(results);
+    if (outputMode == OutputMode::Json)
+        std::printf(numJsonRecords > 0 ? "\n]\n" : "]\n");
 
     return allOk ? 0 : 1;
 }
@@ -36,6 +36,7 @@ inline TrackResult analyzeTrack(const std::string& path) {
             bpm->feed(samples, numFrames);
             key->feed(samples, numFrames);
             gain->feed(samples, numFrames);
+            return true;
         },
         err);
 
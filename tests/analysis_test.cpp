@@ -1,14 +1,41 @@
+#include <base/ThreadPool.h>
+#include <base/Window.h>
+#include <dsp/keydetection/GetKeyMode.h>
+#include <dsp/onsets/DetectionFunction.h>
+#include <dsp/rateconversion/Decimator.h>
+#include <dsp/tempotracking/TempoTrackV2.h>
+#include <dsp/transforms/FFT.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <filesystem>
+#include <fstream>
+#include <map>
 #include <memory>
+#include <random>
+#include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "AnalysisCache.h"
+#include "AnalysisPipeline.h"
+#include "AnalysisServer.h"
+#include "AnalysisSession.h"
 #include "AudioDecoder.h"
+#include "DownmixAndOverlapHelper.h"
+#include "FileAnalysis.h"
 #include "GainAnalyzer.h"
+#include "JsonFormat.h"
 #include "QmBpmAnalyzer.h"
 #include "QmKeyAnalyzer.h"
+#include "SilenceAnalyzer.h"
+#include "mixxx_analyzer.h"
 
 #ifndef MANALYSIS_TEST_ASSETS_DIR
 #define MANALYSIS_TEST_ASSETS_DIR ""
@@ -55,6 +82,7 @@ static TrackResult analyzeTrack(const std::string& path) {
             bpm->feed(samples, numFrames);
             key->feed(samples, numFrames);
             gain->feed(samples, numFrames);
+            return true;
         },
         err, tags);
 
@@ -129,3 +157,1188 @@ INSTANTIATE_TEST_SUITE_P(
             return name;
         });
 // clang-format on
+
+TEST(FastModeTest, ExcerptsAreBoundedAndResultIsApproximate) {
+    std::string path = assetsDir() + "FallingSky.mp3";
+    SKIP_IF_MISSING(path);
+
+    constexpr double kExcerptSecs = 5.0;
+    constexpr int kReducedRate = 22050;
+    std::vector<long long> excerptFrames(2, 0);
+    std::vector<long long> reducedFrames(2, 0);
+    std::vector<int> order;
+    int sampleRate = 0;
+    std::string err;
+    AudioDecoder::Tags tags;
+    AudioDecoder::ReducedExcerpts reduced;
+    reduced.sampleRate = kReducedRate;
+    reduced.cb = [&](int excerpt, const float*, int numFrames,
+                     const AudioDecoder::AudioInfo& info) {
+        EXPECT_EQ(info.sampleRate, kReducedRate);
+        ASSERT_FALSE(order.empty());
+        EXPECT_EQ(excerpt, order.back());
+        if (excerpt >= 0)
+            reducedFrames[excerpt] += numFrames;
+    };
+    ASSERT_TRUE(AudioDecoder::decodeExcerpts(
+        path, {0.2, 0.6}, kExcerptSecs,
+        [&](int excerpt, const float*, int numFrames, const AudioDecoder::AudioInfo& info) {
+            sampleRate = info.sampleRate;
+            if (order.empty() || order.back() != excerpt)
+                order.push_back(excerpt);
+            if (excerpt >= 0)
+                excerptFrames[excerpt] += numFrames;
+            return true;
+        },
+        err, tags, &reduced))
+        << err;
+    ASSERT_EQ(order, (std::vector<int>{0, 1}));
+    for (long long frames : excerptFrames) {
+        EXPECT_EQ(frames, static_cast<long long>(kExcerptSecs * sampleRate));
+    }
+    // The resampler holds back a few frames of each excerpt, never more.
+    const long long reducedExcerptFrames = static_cast<long long>(kExcerptSecs * kReducedRate);
+    for (long long frames : reducedFrames) {
+        EXPECT_LE(frames, reducedExcerptFrames);
+        EXPECT_GT(frames, reducedExcerptFrames - kReducedRate / 10);
+    }
+
+    AnalyzeOptions options;
+    options.fast = true;
+    options.qmSampleRate = kReducedRate;
+    AnalysisResult r;
+    ASSERT_TRUE(analyzeFile(path, options, r, err)) << err;
+    EXPECT_GT(r.bpm, 0.0f);
+    EXPECT_FALSE(r.key.empty());
+    EXPECT_TRUE(r.beatgrid.empty());
+    EXPECT_FALSE(r.analyzers.gain || r.analyzers.silence);
+    const std::string json = formatJsonRecord(r, false, "");
+    EXPECT_NE(json.find("\"beatgrid\": null, \"approximate\": true"), std::string::npos) << json;
+}
+
+// Synthetic 128 BPM kick pattern over a C major triad, interleaved stereo.
+static std::vector<float> makeTestSignal(int sampleRate, double secs) {
+    const double kPi = 3.14159265358979323846;
+    const double beatSecs = 60.0 / 128.0;
+    const double freqs[] = {130.81, 261.63, 329.63, 392.0};
+    const std::size_t numFrames = static_cast<std::size_t>(sampleRate * secs);
+    std::vector<float> out(numFrames * 2);
+    for (std::size_t i = 0; i < numFrames; ++i) {
+        const double t = static_cast<double>(i) / sampleRate;
+        const double tb = std::fmod(t, beatSecs);
+        double v = std::exp(-tb * 30.0) * std::sin(2 * kPi * 60.0 * tb) * 0.6;
+        for (double f : freqs) {
+            v += std::sin(2 * kPi * f * t) * 0.05;
+        }
+        out[i * 2] = out[i * 2 + 1] = static_cast<float>(v);
+    }
+    return out;
+}
+
+TEST(AnalysisPipelineTest, MatchesSerialFeeding) {
+    constexpr int kSampleRate = 44100;
+    constexpr int kChunkFrames = 8192;
+    const std::vector<float> signal = makeTestSignal(kSampleRate, 30.0);
+    const int totalFrames = static_cast<int>(signal.size() / 2);
+
+    QmBpmAnalyzer serialBpm(kSampleRate);
+    QmKeyAnalyzer serialKey(kSampleRate);
+    QmBpmAnalyzer pipedBpm(kSampleRate);
+    QmKeyAnalyzer pipedKey(kSampleRate);
+    {
+        AnalysisPipeline pipeline({[&](const float* s, int n) { pipedBpm.feed(s, n); },
+                                   [&](const float* s, int n) { pipedKey.feed(s, n); }},
+                                  2);
+        for (int pos = 0; pos < totalFrames; pos += kChunkFrames) {
+            const int n = std::min(kChunkFrames, totalFrames - pos);
+            serialBpm.feed(&signal[pos * 2], n);
+            serialKey.feed(&signal[pos * 2], n);
+            pipeline.feed(&signal[pos * 2], n);
+        }
+        pipeline.finish();
+    }
+
+    EXPECT_EQ(pipedBpm.result(), serialBpm.result());
+    EXPECT_EQ(pipedBpm.beatFramesSecs(), serialBpm.beatFramesSecs());
+    EXPECT_EQ(pipedKey.result().chromaticKey, serialKey.result().chromaticKey);
+}
+
+TEST(DownmixTest, KernelMatchesScalarFormula) {
+    // Odd lengths exercise the scalar tail after the SIMD body.
+    std::vector<float> stereo(2 * 37);
+    for (std::size_t i = 0; i < stereo.size(); ++i) {
+        stereo[i] = static_cast<float>(std::sin(i * 0.7) * (i % 5 == 0 ? 1e-30 : 0.9));
+    }
+    stereo[3] = 1.0f;
+    stereo[4] = 1.0f;  // sum rounds differently in float than in double
+    stereo[5] = 1.0f / 3.0f;
+    for (std::size_t n : {0, 1, 3, 4, 5, 8, 37}) {
+        std::vector<double> mono(n);
+        downmixStereoToMono(stereo.data(), mono.data(), n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const double expected = (stereo[i * 2] + stereo[i * 2 + 1]) * 0.5;
+            EXPECT_EQ(mono[i], expected) << "frame " << i << " of " << n;
+        }
+    }
+}
+
+TEST(SilenceScanTest, LoudFrameScansMatchScalarScan) {
+    // Loud samples at every position around the vector block boundaries,
+    // among quiet samples, -0.001 (loud) and a NaN (never loud).
+    for (int numFrames : {0, 1, 7, 8, 9, 33}) {
+        for (int loud = -1; loud < numFrames * 2; ++loud) {
+            std::vector<float> stereo(static_cast<std::size_t>(numFrames) * 2, 0.0009f);
+            if (!stereo.empty())
+                stereo[0] = std::nanf("");
+            if (loud >= 0)
+                stereo[loud] = loud % 3 == 0 ? -0.001f : 0.5f;
+            int first = -1;
+            int last = -1;
+            for (int i = 0; i < numFrames * 2; ++i) {
+                if (std::fabs(stereo[i]) >= 0.001f) {
+                    first = first < 0 ? i / 2 : first;
+                    last = i / 2;
+                }
+            }
+            EXPECT_EQ(SilenceAnalyzer::firstLoudFrame(stereo.data(), numFrames, 2), first)
+                << numFrames << " frames, loud sample " << loud;
+            EXPECT_EQ(SilenceAnalyzer::lastLoudFrame(stereo.data(), numFrames, 2), last)
+                << numFrames << " frames, loud sample " << loud;
+        }
+    }
+}
+
+// Windows of the original sliding Mixxx helper: window/2 leading zeros, the
+// input, then finalize()'s zero padding, cut every 'step' frames.
+static std::vector<std::vector<double>> slidingWindows(const std::vector<double>& input,
+                                                       size_t window, size_t step) {
+    std::vector<double> padded(window / 2, 0.0);
+    padded.insert(padded.end(), input.begin(), input.end());
+    size_t numWindows = padded.size() < window ? 0 : (padded.size() - window) / step + 1;
+    const size_t fill = padded.size() - numWindows * step;
+    padded.resize(padded.size() + std::max(window - fill, window / 2 - 1), 0.0);
+
+    std::vector<std::vector<double>> windows;
+    for (size_t pos = 0; pos + window <= padded.size(); pos += step) {
+        windows.emplace_back(padded.begin() + pos, padded.begin() + pos + window);
+    }
+    return windows;
+}
+
+TEST(OverlapHelperTest, RingMatchesSlidingWindows) {
+    std::vector<double> input(20000);
+    for (size_t i = 0; i < input.size(); ++i) {
+        input[i] = std::sin(i * 0.01) + static_cast<double>(i);
+    }
+    const size_t chunkSizes[] = {1, 7, 512, 4093, 20000};
+
+    for (auto [window, step] : {std::pair<size_t, size_t>{1024, 512}, {1024, 441}, {96, 96}}) {
+        const auto expected = slidingWindows(input, window, step);
+        for (size_t batch : {1, 3, 16}) {
+            std::vector<std::vector<double>> windows;
+            DownmixAndOverlapHelper helper;
+            ASSERT_TRUE(helper.initialize(window, step, batch, [&](double* pFirst, size_t n) {
+                EXPECT_LE(n, batch);
+                for (size_t i = 0; i < n; ++i) {
+                    windows.emplace_back(pFirst + i * step, pFirst + i * step + window);
+                }
+                return true;
+            }));
+            size_t pos = 0;
+            for (size_t i = 0; pos < input.size(); ++i) {
+                const size_t n = std::min(chunkSizes[i % 5], input.size() - pos);
+                helper.processMonoSamples(input.data() + pos, n);
+                pos += n;
+            }
+            helper.finalize();
+            EXPECT_EQ(windows, expected) << window << "/" << step << " batch " << batch;
+        }
+    }
+}
+
+TEST(KeyDecimationTest, StreamingMatchesPerBlockDecimation) {
+    constexpr int kSampleRate = 44100;
+    const std::vector<float> signal = makeTestSignal(kSampleRate, 20.0);
+    std::vector<double> mono(signal.size() / 2);
+    downmixStereoToMono(signal.data(), mono.data(), mono.size());
+
+    struct Frame {
+        int key;
+        std::vector<double> strengths;
+        bool operator==(const Frame& o) const { return key == o.key && strengths == o.strengths; }
+    };
+    auto record = [](GetKeyMode& keyMode, int key, std::vector<Frame>& frames) {
+        const double* strengths = keyMode.getKeyStrengths();
+        frames.push_back({key, std::vector<double>(strengths, strengths + 24)});
+        return true;
+    };
+
+    // Reference: whole blocks, each decimated inside GetKeyMode::process().
+    GetKeyMode blockMode(GetKeyMode::Config(kSampleRate, 440));
+    std::vector<Frame> expected;
+    DownmixAndOverlapHelper blocks;
+    blocks.initialize(blockMode.getBlockSize(), blockMode.getHopSize(), [&](double* p, size_t) {
+        return record(blockMode, blockMode.process(p), expected);
+    });
+    blocks.processMonoSamples(mono.data(), mono.size());
+    blocks.finalize();
+
+    // Streaming: decimate as the audio arrives, in chunks that end just
+    // before, on and after decimation group and block boundaries.
+    GetKeyMode streamMode(GetKeyMode::Config(kSampleRate, 440));
+    const int factor = streamMode.getDecimationFactor();
+    Decimator decimator(factor, factor);
+    std::vector<Frame> frames;
+    DownmixAndOverlapHelper chroma;
+    chroma.initialize(streamMode.getChromaFrameSize(), streamMode.getChromaHopSize(),
+                      [&](double* p, size_t) {
+                          return record(streamMode, streamMode.processDecimated(p), frames);
+                      });
+    // A block of trailing silence completes the last block the way the
+    // reference helper's finalize() does; it has to pass through the filter.
+    mono.resize(mono.size() + streamMode.getBlockSize(), 0.0);
+    std::vector<double> decimated(mono.size() / factor + 1);
+    const size_t chunkSizes[] = {1, 7, 8185, 15, 32768, 3};
+    for (size_t pos = 0, i = 0; pos < mono.size(); ++i) {
+        const size_t n = std::min(chunkSizes[i % 6], mono.size() - pos);
+        const int written = decimator.processStream(mono.data() + pos, n, decimated.data());
+        chroma.processMonoSamples(decimated.data(), written);
+        pos += n;
+    }
+
+    ASSERT_GT(expected.size(), 20u);
+    EXPECT_TRUE(frames == expected);
+}
+
+// GetKeyMode medians the per-hop keys from key counts and averages the
+// chroma with a running sum; its keys must still be the median of a sorted
+// window of the raw keys, which follow from the key strengths.
+TEST(KeyModeTest, MedianMatchesSortedWindowOfRawKeys) {
+    constexpr int kSampleRate = 44100;
+    const double kPi = 3.14159265358979323846;
+    // C major and A minor triads with a gap of silence between them, long
+    // enough for the no-key correlations to take over the median.
+    const double triads[2][3] = {{261.63, 329.63, 392.0}, {220.0, 261.63, 329.63}};
+    std::vector<double> mono(kSampleRate * 70, 0.0);
+    for (size_t i = 0; i < mono.size(); ++i) {
+        const double t = double(i) / kSampleRate;
+        if (t < 30.0 || t >= 45.0) {
+            for (double f : triads[t < 30.0 ? 0 : 1]) {
+                mono[i] += std::sin(2 * kPi * f * t) * 0.2;
+            }
+        }
+    }
+
+    GetKeyMode keyMode(GetKeyMode::Config(kSampleRate, 440));
+    const int window = static_cast<int>(std::ceil(
+        10.0 * kSampleRate / keyMode.getDecimationFactor() / keyMode.getChromaFrameSize()));
+    std::vector<int> rawKeys;
+    std::set<int> keys;
+    for (size_t pos = 0; pos + keyMode.getBlockSize() <= mono.size();
+         pos += keyMode.getHopSize()) {
+        const int key = keyMode.process(&mono[pos]);
+        const double* strengths = keyMode.getKeyStrengths();
+        const int major = std::max_element(strengths, strengths + 12) - strengths;
+        const int minor = std::max_element(strengths + 12, strengths + 24) - strengths;
+        rawKeys.push_back((strengths[major] > strengths[minor] ? major : minor) + 1);
+
+        std::vector<int> sorted(rawKeys.end() - std::min<int>(rawKeys.size(), window),
+                                rawKeys.end());
+        std::sort(sorted.begin(), sorted.end());
+        ASSERT_EQ(key, sorted[(sorted.size() + 1) / 2 - 1]) << "hop " << rawKeys.size();
+        keys.insert(key);
+    }
+    // C major, then C minor from the silence's all-zero correlations, then A minor
+    EXPECT_TRUE(keys.count(1) && keys.count(13) && keys.count(22));
+}
+
+TEST(CombFilterBankTest, FftPathMatchesDirectWithinTolerance) {
+    // Rayleigh weighting as in TempoTrackV2::calculateBeatPeriod().
+    const double rayparam = (60 * 44100 / 512.0) / 120.0;
+    std::vector<double> wv(128);
+    for (size_t i = 0; i < wv.size(); ++i) {
+        wv[i] = (i / (rayparam * rayparam)) * std::exp(-(double(i) * i) / (2 * rayparam * rayparam));
+    }
+    ResonatorCombFilterBank bank(512, wv);
+
+    // Pulse trains of drifting period over noise, carrying the responses
+    // from frame to frame like calculateBeatPeriod() does.
+    std::vector<double> fast(wv.size()), direct(wv.size()), frame(512);
+    unsigned seed = 1;
+    double maxError = 0.0;
+    for (int f = 0; f < 50; ++f) {
+        const int period = 30 + f;
+        for (size_t n = 0; n < frame.size(); ++n) {
+            seed = seed * 1664525u + 1013904223u;
+            frame[n] = (n % period == 0 ? 5.0 : 0.0) + (seed >> 8) / double(1 << 24);
+        }
+        bank.process(frame, fast);
+        bank.processDirect(frame, direct);
+        for (size_t i = 0; i < wv.size(); ++i) {
+            maxError = std::max(maxError, std::fabs(fast[i] - direct[i]));
+        }
+    }
+    EXPECT_LT(maxError, 1e-12);
+}
+
+// TempoTrackV2::viterbi_decode() as it was before the band limit: every state
+// scans every predecessor, keeping the first strict maximum above zero.
+std::vector<int> denseViterbiPath(const std::vector<std::vector<double>>& rcfmat,
+                                  const std::vector<double>& wv) {
+    const int T = static_cast<int>(rcfmat.size()), Q = static_cast<int>(wv.size());
+    std::vector<std::vector<double>> tmat(Q, std::vector<double>(Q, 0.0));
+    for (int i = 20; i < Q - 20; ++i) {
+        for (int j = 20; j < Q - 20; ++j) {
+            tmat[i][j] = std::exp((-1. * std::pow((j - double(i)), 2.)) / (2. * std::pow(8., 2.)));
+        }
+    }
+    auto normalise = [](std::vector<double>& v) {
+        double sum = 0.;
+        for (double x : v) {
+            sum += x;
+        }
+        for (double& x : v) {
+            x /= (sum + 0.0000008);
+        }
+    };
+    auto argmax = [](const std::vector<double>& v) {
+        double maxval = 0.;
+        int ind = 0;
+        for (int i = 0; i < static_cast<int>(v.size()); ++i) {
+            if (maxval < v[i]) {
+                maxval = v[i];
+                ind = i;
+            }
+        }
+        return ind;
+    };
+
+    std::vector<std::vector<double>> delta(T, std::vector<double>(Q));
+    std::vector<std::vector<int>> psi(T, std::vector<int>(Q));
+    for (int j = 0; j < Q; ++j) {
+        delta[0][j] = wv[j] * rcfmat[0][j];
+    }
+    normalise(delta[0]);
+    std::vector<double> products(Q);
+    for (int t = 1; t < T; ++t) {
+        for (int j = 0; j < Q; ++j) {
+            for (int i = 0; i < Q; ++i) {
+                products[i] = delta[t - 1][i] * tmat[j][i];
+            }
+            psi[t][j] = argmax(products);
+            delta[t][j] = std::max(0., products[psi[t][j]]) * rcfmat[t][j];
+        }
+        normalise(delta[t]);
+    }
+
+    std::vector<int> path(T);
+    path[T - 1] = argmax(delta[T - 1]);
+    for (int t = T - 2; t > 0; --t) {
+        path[t] = psi[t + 1][path[t + 1]];
+    }
+    path[0] = psi[1][path[1]];
+    return path;
+}
+
+TEST(TempoTrackTest, BandLimitedViterbiMatchesDenseDecoding) {
+    const double rayparam = (60 * 44100 / 512.0) / 120.0;
+    std::vector<double> wv(128);
+    for (size_t i = 0; i < wv.size(); ++i) {
+        wv[i] = (i / (rayparam * rayparam)) * std::exp(-(double(i) * i) / (2 * rayparam * rayparam));
+    }
+    const int T = 80, Q = static_cast<int>(wv.size());
+    std::mt19937 rng(14);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    auto decode = [&](const std::vector<std::vector<double>>& rcfmat) {
+        TempoTrackV2 tt(44100, 512);
+        std::vector<int> path(rcfmat.size());
+        tt.viterbi_decode(rcfmat, wv, path);
+        return path;
+    };
+
+    // Unstructured responses.
+    std::vector<std::vector<double>> random(T, std::vector<double>(Q));
+    for (auto& row : random) {
+        for (double& x : row) {
+            x = uniform(rng);
+        }
+    }
+    EXPECT_EQ(decode(random), denseViterbiPath(random, wv));
+
+    // Peaks at periods far more than the band apart, taking turns at being
+    // the only one present, so the best predecessor often lies outside the
+    // band and the full scan has to find it.
+    const int peaks[] = {30, 65, 100};
+    std::vector<std::vector<double>> multimodal(T, std::vector<double>(Q));
+    for (int t = 0; t < T; ++t) {
+        const int active = (t / 7) % 3;
+        for (int q = 0; q < Q; ++q) {
+            double x = 1e-30 * uniform(rng);
+            for (int p = 0; p < 3; ++p) {
+                const double weight = (p == active) ? 1.0 : 1e-12 * uniform(rng);
+                x += weight * std::exp(-0.5 * std::pow((q - peaks[p]) / 3.0, 2));
+            }
+            multimodal[t][q] = x;
+        }
+    }
+    const std::vector<int> multimodalPath = decode(multimodal);
+    EXPECT_EQ(multimodalPath, denseViterbiPath(multimodal, wv));
+    EXPECT_GT(*std::max_element(multimodalPath.begin(), multimodalPath.end()) -
+                  *std::min_element(multimodalPath.begin(), multimodalPath.end()),
+              32);
+
+    // Responses far below the epsilon in the normalisation, so the deltas
+    // shrink by about ten each frame, then one row that takes them deep
+    // into the subnormal range, where few bits are left and products tie,
+    // before ordinary responses bring them back.
+    std::vector<std::vector<double>> tiny(T, std::vector<double>(Q));
+    for (int t = 0; t < T; ++t) {
+        const double scale = (t < 30) ? 1e-7 : (t == 30) ? 1e-292 : 1.0;
+        for (double& x : tiny[t]) {
+            x = scale * uniform(rng);
+        }
+    }
+    const std::vector<int> tinyPath = decode(tiny);
+    EXPECT_EQ(tinyPath, denseViterbiPath(tiny, wv));
+    EXPECT_TRUE(std::all_of(tinyPath.begin(), tinyPath.end(), [](int q) { return q >= 20; }));
+}
+
+// Largest difference between the Simd and Kiss backends over a forward and
+// an inverse transform of noise, relative to the largest value compared.
+template <typename T>
+double simdFftError(int n) {
+    FFTRealT<T> kiss(n, FFTBackend::Kiss);
+    FFTRealT<T> simd(n, FFTBackend::Simd);
+    std::vector<T> in(n), kissRe(n), kissIm(n), simdRe(n), simdIm(n), kissOut(n), simdOut(n);
+    unsigned seed = n;
+    for (T& x : in) {
+        seed = seed * 1664525u + 1013904223u;
+        x = T((seed >> 8) / double(1 << 24) - 0.5);
+    }
+    kiss.forward(in.data(), kissRe.data(), kissIm.data());
+    simd.forward(in.data(), simdRe.data(), simdIm.data());
+    kiss.inverse(kissRe.data(), kissIm.data(), kissOut.data());
+    simd.inverse(kissRe.data(), kissIm.data(), simdOut.data());
+
+    double spectrumError = 0.0, spectrumMax = 0.0, signalError = 0.0, signalMax = 0.0;
+    for (int i = 0; i < n; ++i) {
+        spectrumError = std::max(
+            spectrumError, double(std::hypot(simdRe[i] - kissRe[i], simdIm[i] - kissIm[i])));
+        spectrumMax = std::max(spectrumMax, double(std::hypot(kissRe[i], kissIm[i])));
+        signalError = std::max(signalError, double(std::fabs(simdOut[i] - kissOut[i])));
+        signalMax = std::max(signalMax, double(std::fabs(kissOut[i])));
+    }
+    return std::max(spectrumError / spectrumMax, signalError / signalMax);
+}
+
+// Every FFT size the analyzers use is a power of two in this range: onset
+// frames of 256 to 4096, chroma frames of 512 to 16384 and the 1024-point
+// comb filter autocorrelation.
+TEST(FftTest, SimdBackendMatchesKissWithinTolerance) {
+    for (int n = 64; n <= 16384; n *= 2) {
+        EXPECT_LT(simdFftError<double>(n), 1e-14) << "double, n = " << n;
+        EXPECT_LT(simdFftError<float>(n), 1e-6) << "float, n = " << n;
+    }
+
+    // Sizes the Simd backend does not support fall back to kissfft.
+    const int n = 1000;
+    FFTReal fallback(n);
+    FFTReal kiss(n, FFTBackend::Kiss);
+    std::vector<double> in(n), re(n), im(n), kissRe(n), kissIm(n);
+    for (int i = 0; i < n; ++i) {
+        in[i] = std::sin(i * 0.1) + (i % 7) * 0.01;
+    }
+    fallback.forward(in.data(), re.data(), im.data());
+    kiss.forward(in.data(), kissRe.data(), kissIm.data());
+    EXPECT_EQ(re, kissRe);
+    EXPECT_EQ(im, kissIm);
+}
+
+// Largest error of complexSD, on the rectangular engine in ENABLE_SIMD_FFT
+// builds and the phase vocoder otherwise, against the polar form (phases by
+// atan2, deviation by princarg), relative to the largest value. The first
+// frame is silent, so every bin starts from a zero magnitude.
+template <typename T>
+double complexSdError(int frameLength) {
+    const int step = frameLength / 2, half = frameLength / 2 + 1;
+    DetectionFunctionT<T> df(DFConfig{step, frameLength, DF_COMPLEXSD, 3, false, -1, -1});
+    Window<double> window(HanningWindow, frameLength);
+    FFTReal fft(frameLength, FFTBackend::Kiss);
+    std::vector<double> signal(step * 41, 0.0), frame(frameLength), re(frameLength),
+        im(frameLength), mag(half, 0.0), phase(half, 0.0), phaseOld(half, 0.0);
+    unsigned seed = frameLength;
+    for (size_t i = frameLength; i < signal.size(); ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        signal[i] = std::sin(i * 0.05) + ((seed >> 8) / double(1 << 24) - 0.5) * 0.3;
+    }
+
+    double error = 0.0, max = 0.0;
+    for (int f = 0; f + frameLength <= static_cast<int>(signal.size()); f += step) {
+        window.cut(&signal[f], frame.data());
+        std::rotate(frame.begin(), frame.begin() + step, frame.end());
+        fft.forward(frame.data(), re.data(), im.data());
+        double expected = 0.0;
+        for (int i = 0; i < half; ++i) {
+            const double m = std::hypot(re[i], im[i]);
+            const double p = std::atan2(im[i], re[i]);
+            const double dev = MathUtilities::princarg(p - 2 * phase[i] + phaseOld[i]);
+            expected += std::abs(mag[i] - std::polar(m, dev));
+            phaseOld[i] = phase[i];
+            phase[i] = p;
+            mag[i] = m;
+        }
+        error = std::max(error, std::fabs(df.processTimeDomain(&signal[f]) - expected));
+        max = std::max(max, expected);
+    }
+    return error / max;
+}
+
+TEST(DetectionFunctionTest, RectangularComplexSdMatchesPolarForm) {
+    for (int n = 256; n <= 4096; n *= 2) {
+        EXPECT_LT(complexSdError<double>(n), 1e-13) << "double, n = " << n;
+        EXPECT_LT(complexSdError<float>(n), 1e-5) << "float, n = " << n;
+    }
+}
+
+// Several analyses finalizing at once share the pool; every loop must still
+// see each of its indices exactly once.
+TEST(ThreadPoolTest, ConcurrentLoopsRunEveryIndexOnce) {
+    constexpr int kCount = 1000;
+    std::vector<std::vector<std::atomic<int>>> visits(4);
+    std::vector<std::thread> threads;
+    for (std::vector<std::atomic<int>>& v : visits) {
+        v = std::vector<std::atomic<int>>(kCount);
+        threads.emplace_back([&v] {
+            ThreadPool::shared().parallelFor(kCount, [&v](int i) { ++v[i]; });
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    for (const std::vector<std::atomic<int>>& v : visits) {
+        for (const std::atomic<int>& n : v) {
+            EXPECT_EQ(n, 1);
+        }
+    }
+}
+
+TEST(TableCacheTest, ConcurrentColdStartMatchesSerial) {
+    // A sample rate no other test uses, so the threads race to build the
+    // shared windows, FFT plans and constant-Q kernel.
+    constexpr int kSampleRate = 37800;
+    const std::vector<float> signal = makeTestSignal(kSampleRate, 10.0);
+    const int numFrames = static_cast<int>(signal.size() / 2);
+    auto analyze = [&](AnalysisResult& r) {
+        AnalysisSession session(kSampleRate, false);
+        session.feed(signal.data(), numFrames);
+        session.finish(r);
+    };
+
+    std::vector<AnalysisResult> results(4);
+    std::vector<std::thread> threads;
+    for (AnalysisResult& r : results) {
+        threads.emplace_back([&analyze, &r] { analyze(r); });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    AnalysisResult serial{};
+    analyze(serial);
+    for (const AnalysisResult& r : results) {
+        EXPECT_EQ(r.bpm, serial.bpm);
+        EXPECT_EQ(r.beatgrid, serial.beatgrid);
+        EXPECT_EQ(r.key, serial.key);
+    }
+}
+
+TEST(AnalysisSessionTest, SharedDownmixMatchesPerAnalyzerDownmix) {
+    constexpr int kSampleRate = 44100;
+    constexpr int kChunkFrames = 8192;
+    const std::vector<float> signal = makeTestSignal(kSampleRate, 30.0);
+    const int totalFrames = static_cast<int>(signal.size() / 2);
+
+    QmBpmAnalyzer bpm(kSampleRate);
+    QmKeyAnalyzer key(kSampleRate);
+    AnalysisSession session(kSampleRate, false);
+    for (int pos = 0; pos < totalFrames; pos += kChunkFrames) {
+        const int n = std::min(kChunkFrames, totalFrames - pos);
+        bpm.feed(&signal[pos * 2], n);
+        key.feed(&signal[pos * 2], n);
+        session.feed(&signal[pos * 2], n);
+    }
+    AnalysisResult shared{};
+    session.finish(shared);
+
+    EXPECT_EQ(shared.bpm, bpm.result());
+    EXPECT_EQ(shared.beatgrid, bpm.beatFramesSecs());
+    EXPECT_EQ(shared.key, key.result().key);
+}
+
+// Each analyzer must report the same values alone as in a full session, and
+// the fields of unselected analyzers must come out as null.
+TEST(AnalysisSessionTest, SelectedAnalyzersMatchFullSession) {
+    constexpr int kSampleRate = 44100;
+    const std::vector<float> signal = makeTestSignal(kSampleRate, 30.0);
+    const int numFrames = static_cast<int>(signal.size() / 2);
+    auto analyze = [&](const char* only, bool pipelined) {
+        AnalyzerSelection analyzers;
+        std::string error;
+        EXPECT_TRUE(only == nullptr || parseAnalyzerSelection(only, analyzers, error)) << error;
+        AnalysisSession session(kSampleRate, pipelined, analyzers);
+        session.feed(signal.data(), numFrames);
+        AnalysisResult r{};
+        session.finish(r);
+        return r;
+    };
+
+    const AnalysisResult full = analyze(nullptr, false);
+    for (bool pipelined : {false, true}) {
+        const AnalysisResult gain = analyze("gain", pipelined);
+        EXPECT_EQ(gain.lufs, full.lufs);
+        EXPECT_EQ(gain.replayGain, full.replayGain);
+        EXPECT_EQ(gain.bpm, 0.0f);
+        EXPECT_TRUE(gain.key.empty());
+        const std::string json = formatJsonRecord(gain, false);
+        EXPECT_NE(json.find("\"bpm\": null"), std::string::npos);
+        EXPECT_NE(json.find("\"key\": null"), std::string::npos);
+        EXPECT_NE(json.find("\"introSecs\": null"), std::string::npos);
+        EXPECT_NE(json.find("\"beatgrid\": null"), std::string::npos);
+        EXPECT_EQ(json.find("\"lufs\": null"), std::string::npos);
+
+        const AnalysisResult rest = analyze("key,silence,bpm", pipelined);
+        EXPECT_EQ(rest.bpm, full.bpm);
+        EXPECT_EQ(rest.beatgrid, full.beatgrid);
+        EXPECT_EQ(rest.key, full.key);
+        EXPECT_EQ(rest.introSecs, full.introSecs);
+        EXPECT_EQ(rest.outroSecs, full.outroSecs);
+        EXPECT_EQ(rest.lufs, 0.0);
+    }
+
+    AnalyzerSelection analyzers;
+    std::string error;
+    EXPECT_FALSE(parseAnalyzerSelection("bpm,tempo", analyzers, error));
+    EXPECT_FALSE(parseAnalyzerSelection("", analyzers, error));
+    EXPECT_TRUE(analyzers.all());
+
+    int qmRate = 48000;
+    EXPECT_TRUE(parseQmSampleRate("0", qmRate));
+    EXPECT_EQ(qmRate, 0);
+    EXPECT_TRUE(parseQmSampleRate("22050", qmRate));
+    EXPECT_EQ(qmRate, 22050);
+    for (const char* bad : {"", "60", "8000", "22049", "1000001", "-1", "48k", "44100.0"}) {
+        EXPECT_FALSE(parseQmSampleRate(bad, qmRate)) << bad;
+    }
+    EXPECT_EQ(qmRate, 22050);
+}
+
+// With a reduced QM rate, bpm and key come only from feedReduced() and gain
+// and silence only from feed(), each matching a session at that one rate.
+TEST(AnalysisSessionTest, ReducedRateFeedsQmAnalyzersOnly) {
+    constexpr int kNativeRate = 96000;
+    constexpr int kQmRate = 48000;
+    const std::vector<float> native = makeTestSignal(kNativeRate, 20.0);
+    const std::vector<float> reduced = makeTestSignal(kQmRate, 20.0);
+    auto analyze = [](int sampleRate, const std::vector<float>& signal, bool pipelined) {
+        AnalysisSession session(sampleRate, pipelined);
+        session.feed(signal.data(), static_cast<int>(signal.size() / 2));
+        AnalysisResult r{};
+        session.finish(r);
+        return r;
+    };
+    const AnalysisResult atNative = analyze(kNativeRate, native, false);
+    const AnalysisResult atQm = analyze(kQmRate, reduced, false);
+
+    for (bool pipelined : {false, true}) {
+        AnalysisSession session(kNativeRate, pipelined, {}, kQmRate);
+        for (int i = 0; i < 20; ++i) {
+            session.feed(native.data() + i * kNativeRate * 2, kNativeRate);
+            session.feedReduced(reduced.data() + i * kQmRate * 2, kQmRate);
+        }
+        AnalysisResult r{};
+        session.finish(r);
+        EXPECT_EQ(r.bpm, atQm.bpm);
+        EXPECT_EQ(r.beatgrid, atQm.beatgrid);
+        EXPECT_EQ(r.key, atQm.key);
+        EXPECT_EQ(r.lufs, atNative.lufs);
+        EXPECT_EQ(r.introSecs, atNative.introSecs);
+        EXPECT_EQ(r.outroSecs, atNative.outroSecs);
+    }
+}
+
+// The float32 DSP path must find the same bpm and key as the double path,
+// with beats no further off than a fraction of a detection function step.
+TEST(AnalysisSessionTest, SinglePrecisionAgreesWithDouble) {
+    constexpr int kSampleRate = 44100;
+    const std::vector<float> signal = makeTestSignal(kSampleRate, 30.0);
+    auto analyze = [&](bool singlePrecision) {
+        AnalysisSession session(kSampleRate, false, {}, 0, singlePrecision);
+        session.feed(signal.data(), static_cast<int>(signal.size() / 2));
+        AnalysisResult r{};
+        session.finish(r);
+        return r;
+    };
+    const AnalysisResult f64 = analyze(false);
+    const AnalysisResult f32 = analyze(true);
+
+    EXPECT_EQ(f32.bpm, f64.bpm);
+    EXPECT_EQ(f32.key, f64.key);
+    ASSERT_EQ(f32.beatgrid.size(), f64.beatgrid.size());
+    for (std::size_t i = 0; i < f64.beatgrid.size(); ++i) {
+        EXPECT_NEAR(f32.beatgrid[i], f64.beatgrid[i], 0.005) << "beat " << i;
+    }
+    EXPECT_EQ(f32.lufs, f64.lufs);
+}
+
+// An intro-only session must report done() soon after the first sound, with
+// the same intro as a full silence scan.
+TEST(AnalysisSessionTest, IntroOnlyStopsAtFirstSound) {
+    constexpr int kSampleRate = 44100;
+    constexpr int kChunkFrames = 8192;
+    std::vector<float> signal(static_cast<std::size_t>(kSampleRate) * 3 * 2, 0.0f);
+    const std::vector<float> music = makeTestSignal(kSampleRate, 20.0);
+    signal.insert(signal.end(), music.begin(), music.end());
+    const int totalFrames = static_cast<int>(signal.size() / 2);
+
+    AnalyzerSelection silence{false, false, false, true, false};
+    AnalysisSession full(kSampleRate, false, silence);
+    full.feed(signal.data(), totalFrames);
+    EXPECT_FALSE(full.done());
+    AnalysisResult expected{};
+    full.finish(expected);
+
+    AnalyzerSelection intro{false, false, false, false, true};
+    for (bool pipelined : {false, true}) {
+        AnalysisSession session(kSampleRate, pipelined, intro);
+        int pos = 0;
+        while (pos < totalFrames && !session.done()) {
+            const int n = std::min(kChunkFrames, totalFrames - pos);
+            session.feed(&signal[pos * 2], n);
+            pos += n;
+        }
+        AnalysisResult r{};
+        session.finish(r);
+        EXPECT_TRUE(session.done());
+        EXPECT_LT(pos, totalFrames / 2);
+        EXPECT_EQ(r.introSecs, expected.introSecs);
+        EXPECT_EQ(r.outroSecs, 0.0);
+    }
+}
+
+// Writes interleaved stereo as 16-bit PCM, followed by a LIST INFO chunk
+// carrying 'title' the way taggers append one after the audio.
+static void writeTestWav(const std::string& path, const std::vector<float>& stereo,
+                         int sampleRate, const std::string& title) {
+    auto u32 = [](std::string& s, uint32_t v) {
+        for (int i = 0; i < 4; ++i) {
+            s += static_cast<char>((v >> (8 * i)) & 0xff);
+        }
+    };
+    auto u16 = [](std::string& s, uint16_t v) {
+        s += static_cast<char>(v & 0xff);
+        s += static_cast<char>(v >> 8);
+    };
+    std::string data;
+    for (float v : stereo) {
+        u16(data, static_cast<uint16_t>(static_cast<int16_t>(std::lround(v * 32767.0f))));
+    }
+    std::string name = title + '\0';
+    if (name.size() % 2)
+        name += '\0';
+    std::string info = "INFOINAM";
+    u32(info, static_cast<uint32_t>(name.size()));
+    info += name;
+
+    std::string out = "WAVEfmt ";
+    u32(out, 16);
+    u16(out, 1);
+    u16(out, 2);
+    u32(out, sampleRate);
+    u32(out, sampleRate * 4);
+    u16(out, 4);
+    u16(out, 16);
+    out += "data";
+    u32(out, static_cast<uint32_t>(data.size()));
+    out += data;
+    out += "LIST";
+    u32(out, static_cast<uint32_t>(info.size()));
+    out += info;
+
+    std::string riff = "RIFF";
+    u32(riff, static_cast<uint32_t>(out.size()));
+    std::ofstream(path, std::ios::binary) << riff << out;
+}
+
+TEST(AnalysisCacheTest, HitsAcrossRetagsAndIgnoresForeignEntries) {
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() /
+                         ("mixxx-analyzer-cache-test-" + std::to_string(std::random_device{}()));
+    fs::create_directories(dir);
+    auto entryFiles = [&dir] {
+        std::vector<fs::path> files;
+        for (const fs::directory_entry& e : fs::recursive_directory_iterator(dir / "cache")) {
+            if (e.is_regular_file())
+                files.push_back(e.path());
+        }
+        return files;
+    };
+    const std::string wav = (dir / "track.wav").string();
+    const std::string cacheDir = (dir / "cache").string();
+    const std::vector<float> signal = makeTestSignal(44100, 2.0);
+    writeTestWav(wav, signal, 44100, "Before");
+
+    std::string error;
+    AnalysisCache cache(cacheDir, "bpm/1");
+    ASSERT_TRUE(cache.open(error)) << error;
+    AudioDecoder::Tags tags;
+    std::string digest;
+    ASSERT_TRUE(AudioDecoder::probe(wav, tags, digest, error)) << error;
+    ASSERT_FALSE(digest.empty());
+
+    AnalysisResult result;
+    result.bpm = 128.0f;
+    result.key = "C";
+    result.camelot = "8B";
+    result.beatgrid = {0.25, 0.71875, 1.1875};
+    result.tags = tags;
+
+    // A miss still reports the digest it computed, for the caller to store
+    // a result under.
+    AnalysisResult out;
+    std::string missDigest;
+    EXPECT_FALSE(cache.lookup(wav, AnalysisCache::stamp(wav), out, &missDigest));
+    EXPECT_EQ(missDigest, digest);
+
+    // Without a digest (decoding stopped before EOF) nothing is stored.
+    cache.store(wav, AnalysisCache::stamp(wav), "", result);
+    EXPECT_TRUE(entryFiles().empty());
+    EXPECT_FALSE(cache.lookup(wav, AnalysisCache::stamp(wav), out));
+
+    cache.store(wav, AnalysisCache::stamp(wav), digest, result);
+    ASSERT_TRUE(cache.lookup(wav, AnalysisCache::stamp(wav), out));
+    EXPECT_EQ(out.bpm, result.bpm);
+    EXPECT_EQ(out.key, result.key);
+    EXPECT_EQ(out.beatgrid, result.beatgrid);
+
+    // A retag changes the file but not its audio: the stored result comes
+    // back with the new tags.
+    writeTestWav(wav, signal, 44100, "After the retag");
+    AnalysisResult retagged;
+    ASSERT_TRUE(cache.lookup(wav, AnalysisCache::stamp(wav), retagged));
+    EXPECT_EQ(retagged.beatgrid, result.beatgrid);
+    EXPECT_EQ(retagged.tags.title, "After the retag");
+
+    // Another analyzer configuration doesn't see the result.
+    AnalysisCache other(cacheDir, "bpm/2");
+    ASSERT_TRUE(other.open(error)) << error;
+    EXPECT_FALSE(other.lookup(wav, AnalysisCache::stamp(wav), out));
+
+    // Truncated entries and entries of another format version are ignored.
+    fs::path resultFile;
+    for (const fs::path& file : entryFiles()) {
+        if (file.filename() == digest)
+            resultFile = file;
+    }
+    ASSERT_FALSE(resultFile.empty());
+    std::stringstream contents;
+    contents << std::ifstream(resultFile, std::ios::binary).rdbuf();
+    const std::string entry = contents.str();
+    const std::string header = entry.substr(0, entry.find('\n'));
+    for (const std::string& damaged :
+         {entry.substr(0, entry.rfind("end\n")), header + "9" + entry.substr(header.size())}) {
+        std::ofstream(resultFile, std::ios::binary | std::ios::trunc) << damaged;
+        EXPECT_FALSE(cache.lookup(wav, AnalysisCache::stamp(wav), out));
+    }
+    std::ofstream(resultFile, std::ios::binary | std::ios::trunc) << entry;
+    EXPECT_TRUE(cache.lookup(wav, AnalysisCache::stamp(wav), out));
+
+    fs::remove_all(dir);
+}
+
+// --only silence finds the outro by seeking and decoding backward, and --only
+// intro stops at the first sound; both must report the times of a full scan,
+// including for a silent tail longer than one backward block and for a file
+// that is silent throughout.
+TEST(FileAnalysisTest, SilenceBySeekingMatchesFullScan) {
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() /
+                         ("mixxx-analyzer-silence-test-" + std::to_string(std::random_device{}()));
+    fs::create_directories(dir);
+    constexpr int kSampleRate = 44100;
+    auto silence = [](double secs) {
+        return std::vector<float>(static_cast<std::size_t>(kSampleRate * secs) * 2, 0.0f);
+    };
+
+    std::vector<float> tail = silence(1.3);
+    const std::vector<float> music = makeTestSignal(kSampleRate, 4.0);
+    tail.insert(tail.end(), music.begin(), music.end());
+    const std::vector<float> quiet = silence(12.7);
+    tail.insert(tail.end(), quiet.begin(), quiet.end());
+    const std::string tailWav = (dir / "tail.wav").string();
+    writeTestWav(tailWav, tail, kSampleRate, "Tail");
+    const std::string silentWav = (dir / "silent.wav").string();
+    writeTestWav(silentWav, silence(7.5), kSampleRate, "Silent");
+
+    const std::pair<std::string, double> cases[] = {{tailWav, 5.3}, {silentWav, 7.5}};
+    for (const auto& [wav, outroSecs] : cases) {
+        SCOPED_TRACE(wav);
+        std::string error;
+        AnalyzeOptions options;
+        options.analyzers = AnalyzerSelection{false, false, true, true, false};
+        AnalysisResult full;
+        ASSERT_TRUE(analyzeFile(wav, options, full, error)) << error;
+        EXPECT_NEAR(full.outroSecs, outroSecs, 0.01);
+
+        options.analyzers = AnalyzerSelection{false, false, false, true, false};
+        AnalysisResult seeking;
+        ASSERT_TRUE(analyzeFile(wav, options, seeking, error)) << error;
+        EXPECT_EQ(seeking.introSecs, full.introSecs);
+        EXPECT_EQ(seeking.outroSecs, full.outroSecs);
+
+        options.analyzers = AnalyzerSelection{false, false, false, false, true};
+        AnalysisResult intro;
+        ASSERT_TRUE(analyzeFile(wav, options, intro, error)) << error;
+        EXPECT_EQ(intro.introSecs, full.introSecs);
+    }
+
+    fs::remove_all(dir);
+}
+
+TEST(JsonFormatTest, ParsesFlatObjectsOnly) {
+    std::map<std::string, JsonValue> obj;
+    std::string error;
+    ASSERT_TRUE(parseJsonObject(
+        R"( {"id": "a\"b", "path": "\/m\\x\n\u00e9\ud83c\udfb5", "n": -1.5e3, "t": true,)"
+        R"( "f": false, "z": null} )",
+        obj, error))
+        << error;
+    EXPECT_EQ(obj["id"].type, JsonValue::Type::String);
+    EXPECT_EQ(obj["id"].text, "a\"b");
+    EXPECT_EQ(obj["id"].raw, R"("a\"b")");
+    EXPECT_EQ(obj["path"].text, "/m\\x\n\xc3\xa9\xf0\x9f\x8e\xb5");
+    EXPECT_EQ(obj["n"].type, JsonValue::Type::Number);
+    EXPECT_EQ(obj["n"].raw, "-1.5e3");
+    EXPECT_EQ(obj["t"].type, JsonValue::Type::Bool);
+    EXPECT_EQ(obj["t"].text, "true");
+    EXPECT_EQ(obj["f"].text, "false");
+    EXPECT_EQ(obj["z"].type, JsonValue::Type::Null);
+
+    obj.clear();
+    EXPECT_TRUE(parseJsonObject("{}", obj, error)) << error;
+    EXPECT_TRUE(obj.empty());
+    for (const char* bad :
+         {"", "[]", R"({"a": [1]})", R"({"a": {"b": 1}})", R"({"a": 1} x)", R"({"a": 1}})",
+          R"({"a": 1,})", R"({"a" 1})", R"({a: 1})", R"({"a": 1x})", R"({"a": tru})",
+          R"({"a": "\ud83cA"})", R"({"a": "\ud83c\u0041"})", R"({"a": "\udfb5"})",
+          R"({"a": "\q"})", R"({"a": "open)"}) {
+        EXPECT_FALSE(parseJsonObject(bad, obj, error)) << bad;
+    }
+}
+
+// Every request line gets exactly one response carrying its id: a result,
+// or an error record for a bad line, a bad option or a file that fails.
+TEST(AnalysisServerTest, ServeStreamAnswersEveryRequest) {
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() /
+                         ("mixxx-analyzer-server-test-" + std::to_string(std::random_device{}()));
+    fs::create_directories(dir);
+    const std::string wav = (dir / "track.wav").string();
+    writeTestWav(wav, makeTestSignal(44100, 4.0), 44100, "Track");
+    const std::string path = jsonEscape(wav);
+
+    const std::vector<std::string> requests = {
+        R"({"id": 1, "path": ")" + path + R"("})",
+        R"({"id": "two", "path": ")" + path + R"(", "pipeline": true, "preview": 2.5})",
+        R"({"id": 3, "path": ")" + path + R"(", "fast": true})",
+        R"({"id": 4, "path": ")" + path + R"(", "only": "bpm"})",
+        R"({"id": 5, "path": ")" + path + R"(", "qm_rate": 22050})",
+        R"({"id": 6, "path": ")" + path + R"(", "float32": true})",
+        R"({"id": 7, "path": ")" + path + R"(", "fast": true, "preview": 2})",
+        R"({"id": 8, "path": ")" + path + R"(", "preview": "2"})",
+        R"({"id": 9, "path": ")" + path + R"(", "pipeline": 1})",
+        R"({"id": 10, "path": ")" + jsonEscape((dir / "missing.wav").string()) + R"("})",
+        R"({"id": 11})",
+        R"({"id": 12, "path": ")" + path + R"("} trailing)",
+        R"({"id": 13, "path": [")" + path + R"("]})",
+        "   ",
+    };
+    std::FILE* in = std::tmpfile();
+    std::FILE* out = std::tmpfile();
+    ASSERT_TRUE(in && out);
+    for (const std::string& request : requests) {
+        std::fputs((request + "\n").c_str(), in);
+    }
+    std::rewind(in);
+    {
+        AnalysisServer server(AnalyzeOptions{}, 4);
+        server.serveStream(in, out);
+    }
+    std::rewind(out);
+    std::map<std::string, std::string> responses;
+    std::vector<std::string> unidentified;
+    char buf[65536];
+    while (std::fgets(buf, sizeof(buf), out)) {
+        std::string line = buf;
+        ASSERT_EQ(line.back(), '\n');
+        line.pop_back();
+        const std::string prefix = "{\"id\": ";
+        ASSERT_EQ(line.compare(0, prefix.size(), prefix), 0) << line;
+        const std::string id = line.substr(prefix.size(), line.find(',') - prefix.size());
+        if (id == "null")
+            unidentified.push_back(line);
+        else
+            EXPECT_TRUE(responses.emplace(id, line).second) << "duplicate " << line;
+    }
+    std::fclose(in);
+    std::fclose(out);
+
+    // Two malformed lines, no answer to the blank one.
+    EXPECT_EQ(unidentified.size(), 2u);
+    for (const std::string& line : unidentified) {
+        EXPECT_NE(line.find("\"error\": \"Invalid request: "), std::string::npos) << line;
+    }
+    EXPECT_EQ(responses.size(), 11u);
+    for (const char* id : {"1", "\"two\"", "3"}) {
+        EXPECT_EQ(responses[id].find("\"error\""), std::string::npos) << responses[id];
+        EXPECT_NE(responses[id].find("\"bpm\": "), std::string::npos) << responses[id];
+    }
+    EXPECT_NE(responses["1"].find("\"lufs\": -"), std::string::npos) << responses["1"];
+    EXPECT_NE(responses["\"two\""].find("\"beatgrid\": ["), std::string::npos);
+    // Too short for excerpts, so analyzed whole, but still bpm and key only.
+    EXPECT_NE(responses["3"].find("\"lufs\": null"), std::string::npos) << responses["3"];
+    for (const char* id : {"4", "5", "6", "7", "8", "9", "11"}) {
+        EXPECT_NE(responses[id].find("\"error\": \"Invalid request: "), std::string::npos)
+            << responses[id];
+    }
+    EXPECT_NE(responses["4"].find("\\\"only\\\" cannot be set per request"), std::string::npos);
+    EXPECT_NE(responses["10"].find("\"error\": \"Error"), std::string::npos) << responses["10"];
+
+    fs::remove_all(dir);
+}
+
+// analyzeBatch must hand back outcomes in input order, a failure in its own
+// slot, with the results of a sequential run. Workers may start file i only
+// once fewer than 4 * jobs outcomes before it are unconsumed, so each file is
+// written just before it may be started: one started earlier would fail.
+TEST(AnalyzeBatchTest, OutcomesArriveInInputOrderWithinLookahead) {
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() /
+                         ("mixxx-analyzer-batch-test-" + std::to_string(std::random_device{}()));
+    fs::create_directories(dir);
+    constexpr int kSampleRate = 44100;
+    constexpr std::size_t kNumFiles = 24;
+    constexpr std::size_t kMissing = 5;
+    std::vector<std::string> files;
+    for (std::size_t i = 0; i < kNumFiles; ++i) {
+        files.push_back((dir / ("track" + std::to_string(i) + ".wav")).string());
+    }
+    // Lengths vary so that workers finish out of order.
+    auto writeFile = [&](std::size_t i) {
+        if (i < kNumFiles && i != kMissing)
+            writeTestWav(files[i], makeTestSignal(kSampleRate, 1.0 + 0.7 * ((i * 3) % 5)),
+                         kSampleRate, "Track " + std::to_string(i));
+    };
+
+    AnalyzeOptions options;
+    std::vector<FileOutcome> expected;
+    for (int jobs : {1, 4}) {
+        SCOPED_TRACE(jobs);
+        const std::size_t maxAhead = 4 * static_cast<std::size_t>(jobs);
+        for (std::size_t i = 0; i < kNumFiles; ++i) {
+            fs::remove(files[i]);
+        }
+        for (std::size_t i = 0; i <= maxAhead; ++i) {
+            writeFile(i);
+        }
+        std::vector<FileOutcome> outcomes;
+        analyzeBatch(files, jobs, options, [&](FileOutcome& outcome) {
+            const std::size_t i = outcomes.size();
+            // Give the workers time to run as far ahead as they may.
+            if (i == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            writeFile(i + maxAhead + 1);
+            outcomes.push_back(std::move(outcome));
+        });
+
+        if (expected.empty()) {
+            for (const std::string& file : files) {
+                FileOutcome outcome;
+                outcome.ok = analyzeFile(file, options, outcome.result, outcome.error);
+                expected.push_back(std::move(outcome));
+            }
+        }
+        ASSERT_EQ(outcomes.size(), kNumFiles);
+        for (std::size_t i = 0; i < kNumFiles; ++i) {
+            SCOPED_TRACE(i);
+            EXPECT_EQ(outcomes[i].ok, i != kMissing) << outcomes[i].error;
+            EXPECT_EQ(outcomes[i].ok, expected[i].ok);
+            if (!outcomes[i].ok) {
+                EXPECT_NE(outcomes[i].error.find(files[i]), std::string::npos);
+                continue;
+            }
+            EXPECT_EQ(formatJsonRecord(outcomes[i].result, false),
+                      formatJsonRecord(expected[i].result, false));
+            EXPECT_EQ(outcomes[i].result.path, files[i]);
+        }
+    }
+
+    fs::remove_all(dir);
+}
+
+// The C API must give the same results however the caller splits the stream,
+// and for mono input as for the equivalent stereo input.
+TEST(CApiTest, MatchesSessionForAnyPushSizes) {
+    constexpr int kSampleRate = 44100;
+    constexpr std::size_t kBlockFrames = 8192;
+    const std::vector<float> stereo = makeTestSignal(kSampleRate, 30.0);
+    const std::size_t totalFrames = stereo.size() / 2;
+    std::vector<float> mono(totalFrames);
+    for (std::size_t i = 0; i < totalFrames; ++i) {
+        mono[i] = stereo[i * 2];
+    }
+
+    AnalysisResult expected{};
+    {
+        AnalysisSession session(kSampleRate, false);
+        for (std::size_t pos = 0; pos < totalFrames; pos += kBlockFrames) {
+            session.feed(&stereo[pos * 2],
+                         static_cast<int>(std::min(kBlockFrames, totalFrames - pos)));
+        }
+        session.finish(expected);
+    }
+
+    const std::size_t pushSizes[] = {1000, 20000, 7, 8192, 8185, 50000};
+    for (int channels : {2, 1}) {
+        SCOPED_TRACE(channels);
+        const float* samples = channels == 2 ? stereo.data() : mono.data();
+        mxa_session* session = mxa_session_create(kSampleRate, channels);
+        ASSERT_NE(session, nullptr);
+        std::size_t pos = 0;
+        for (std::size_t i = 0; pos < totalFrames; ++i) {
+            const std::size_t n = std::min(pushSizes[i % 6], totalFrames - pos);
+            ASSERT_EQ(mxa_session_push(session, samples + pos * channels, n), MXA_OK);
+            pos += n;
+        }
+        ASSERT_EQ(mxa_session_finalize(session), MXA_OK);
+        EXPECT_EQ(mxa_session_push(session, samples, 1), MXA_ERROR_BAD_STATE);
+
+        double bpm = 0, lufs = 0, replayGain = 0, intro = 0, outro = 0;
+        const double* beats = nullptr;
+        std::size_t numBeats = 0;
+        const char* key = nullptr;
+        const char* camelot = nullptr;
+        ASSERT_EQ(mxa_session_bpm(session, &bpm), MXA_OK);
+        ASSERT_EQ(mxa_session_beatgrid(session, &beats, &numBeats), MXA_OK);
+        ASSERT_EQ(mxa_session_key(session, &key, &camelot), MXA_OK);
+        ASSERT_EQ(mxa_session_loudness(session, &lufs, &replayGain), MXA_OK);
+        ASSERT_EQ(mxa_session_intro_outro(session, &intro, &outro), MXA_OK);
+
+        EXPECT_EQ(bpm, expected.bpm);
+        EXPECT_EQ(std::vector<double>(beats, beats + numBeats), expected.beatgrid);
+        EXPECT_EQ(key, expected.key);
+        EXPECT_EQ(camelot, expected.camelot);
+        EXPECT_EQ(lufs, expected.lufs);
+        EXPECT_EQ(intro, expected.introSecs);
+        EXPECT_EQ(outro, expected.outroSecs);
+        mxa_session_destroy(session);
+    }
+}
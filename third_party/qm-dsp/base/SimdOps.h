@@ -0,0 +1,336 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    QM DSP Library
+
+    Centre for Digital Music, Queen Mary, University of London.
+*/
+
+#ifndef QM_DSP_SIMDOPS_H
+#define QM_DSP_SIMDOPS_H
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define QM_DSP_SIMD_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define QM_DSP_SIMD_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define QM_DSP_SIMD_NEON 1
+#endif
+
+/**
+ * SimdOps<T> wraps the widest vector of T (float or double) the build
+ * targets: AVX in AVX builds, else SSE2 on x86-64 and NEON on AArch64,
+ * else ScalarOps, one lane of plain scalar code. Each provides a type
+ * V of W lanes with unaligned load/store, set1 and lane-wise add, sub,
+ * mul, div and sqrt; step(edge, x), 1 where x >= edge and 0 elsewhere;
+ * and sum(), the sum of the lanes.
+ *
+ * For the FFT: interleave(y, s, r0, r1, r2, r3) stores the four
+ * vectors to y[0, 4W) as alternating blocks of s lanes (the first s
+ * lanes of r0, r1, r2 and r3, then the next s lanes of each); it is
+ * only called with s < W, where s is 1 or (for 8 lanes) 4.
+ * deinterleave() splits 2W values into the even- and odd-indexed ones,
+ * interleave2() is its reverse, and reverse() reverses the lanes of a
+ * vector.
+ *
+ * The kernels are chosen at compile time, so every translation unit
+ * including this header must be built for the same instruction set.
+ */
+template <typename T>
+struct ScalarOps {
+    typedef T V;
+    static constexpr int W = 1;
+    static V load(const T *p) { return *p; }
+    static void store(T *p, V v) { *p = v; }
+    static V set1(T x) { return x; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V div(V a, V b) { return a / b; }
+    static V sqrt(V a) { return std::sqrt(a); }
+    static V step(V edge, V x) { return x >= edge ? T(1) : T(0); }
+    static T sum(V v) { return v; }
+    static void interleave(T *, int, V, V, V, V) {}
+    static void deinterleave(const T *p, V &even, V &odd) {
+        even = p[0];
+        odd = p[1];
+    }
+    static void interleave2(T *p, V even, V odd) {
+        p[0] = even;
+        p[1] = odd;
+    }
+    static V reverse(V v) { return v; }
+};
+
+template <typename T>
+struct SimdOps;
+
+#if defined(QM_DSP_SIMD_AVX)
+
+inline const char *simdInstructionSet() { return "avx"; }
+
+template <>
+struct SimdOps<float> {
+    typedef __m256 V;
+    static constexpr int W = 8;
+    static V load(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, V v) { _mm256_storeu_ps(p, v); }
+    static V set1(float x) { return _mm256_set1_ps(x); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+    static V step(V edge, V x) {
+        return _mm256_and_ps(_mm256_cmp_ps(x, edge, _CMP_GE_OQ), _mm256_set1_ps(1.f));
+    }
+    static float sum(V v) {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+    }
+    static void interleave(float *y, int s, V r0, V r1, V r2, V r3) {
+        if (s == 4) {
+            store(y, _mm256_permute2f128_ps(r0, r1, 0x20));
+            store(y + 8, _mm256_permute2f128_ps(r2, r3, 0x20));
+            store(y + 16, _mm256_permute2f128_ps(r0, r1, 0x31));
+            store(y + 24, _mm256_permute2f128_ps(r2, r3, 0x31));
+            return;
+        }
+        // 4x4 transposes within each 128-bit half, then the halves in order
+        const V t0 = _mm256_unpacklo_ps(r0, r1);
+        const V t1 = _mm256_unpackhi_ps(r0, r1);
+        const V t2 = _mm256_unpacklo_ps(r2, r3);
+        const V t3 = _mm256_unpackhi_ps(r2, r3);
+        const V u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        const V u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        const V u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        const V u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        store(y, _mm256_permute2f128_ps(u0, u1, 0x20));
+        store(y + 8, _mm256_permute2f128_ps(u2, u3, 0x20));
+        store(y + 16, _mm256_permute2f128_ps(u0, u1, 0x31));
+        store(y + 24, _mm256_permute2f128_ps(u2, u3, 0x31));
+    }
+    static void deinterleave(const float *p, V &even, V &odd) {
+        const V a = load(p), b = load(p + 8);
+        const V lo = _mm256_permute2f128_ps(a, b, 0x20);
+        const V hi = _mm256_permute2f128_ps(a, b, 0x31);
+        even = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        odd = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+    }
+    static void interleave2(float *p, V even, V odd) {
+        const V lo = _mm256_unpacklo_ps(even, odd);
+        const V hi = _mm256_unpackhi_ps(even, odd);
+        store(p, _mm256_permute2f128_ps(lo, hi, 0x20));
+        store(p + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    static V reverse(V v) {
+        return _mm256_permute_ps(_mm256_permute2f128_ps(v, v, 0x01), _MM_SHUFFLE(0, 1, 2, 3));
+    }
+};
+
+template <>
+struct SimdOps<double> {
+    typedef __m256d V;
+    static constexpr int W = 4;
+    static V load(const double *p) { return _mm256_loadu_pd(p); }
+    static void store(double *p, V v) { _mm256_storeu_pd(p, v); }
+    static V set1(double x) { return _mm256_set1_pd(x); }
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm256_div_pd(a, b); }
+    static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+    static V step(V edge, V x) {
+        return _mm256_and_pd(_mm256_cmp_pd(x, edge, _CMP_GE_OQ), _mm256_set1_pd(1.));
+    }
+    static double sum(V v) {
+        const __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    }
+    static void interleave(double *y, int, V r0, V r1, V r2, V r3) {
+        const V t0 = _mm256_unpacklo_pd(r0, r1);
+        const V t1 = _mm256_unpackhi_pd(r0, r1);
+        const V t2 = _mm256_unpacklo_pd(r2, r3);
+        const V t3 = _mm256_unpackhi_pd(r2, r3);
+        store(y, _mm256_permute2f128_pd(t0, t2, 0x20));
+        store(y + 4, _mm256_permute2f128_pd(t1, t3, 0x20));
+        store(y + 8, _mm256_permute2f128_pd(t0, t2, 0x31));
+        store(y + 12, _mm256_permute2f128_pd(t1, t3, 0x31));
+    }
+    static void deinterleave(const double *p, V &even, V &odd) {
+        const V a = load(p), b = load(p + 4);
+        const V lo = _mm256_permute2f128_pd(a, b, 0x20);
+        const V hi = _mm256_permute2f128_pd(a, b, 0x31);
+        even = _mm256_unpacklo_pd(lo, hi);
+        odd = _mm256_unpackhi_pd(lo, hi);
+    }
+    static void interleave2(double *p, V even, V odd) {
+        const V lo = _mm256_unpacklo_pd(even, odd);
+        const V hi = _mm256_unpackhi_pd(even, odd);
+        store(p, _mm256_permute2f128_pd(lo, hi, 0x20));
+        store(p + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+    }
+    static V reverse(V v) { return _mm256_permute_pd(_mm256_permute2f128_pd(v, v, 0x01), 0x5); }
+};
+
+#elif defined(QM_DSP_SIMD_SSE2)
+
+inline const char *simdInstructionSet() { return "sse2"; }
+
+template <>
+struct SimdOps<float> {
+    typedef __m128 V;
+    static constexpr int W = 4;
+    static V load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, V v) { _mm_storeu_ps(p, v); }
+    static V set1(float x) { return _mm_set1_ps(x); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm_div_ps(a, b); }
+    static V sqrt(V a) { return _mm_sqrt_ps(a); }
+    static V step(V edge, V x) { return _mm_and_ps(_mm_cmpge_ps(x, edge), _mm_set1_ps(1.f)); }
+    static float sum(V v) {
+        const V s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+    }
+    static void interleave(float *y, int, V r0, V r1, V r2, V r3) {
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        store(y, r0);
+        store(y + 4, r1);
+        store(y + 8, r2);
+        store(y + 12, r3);
+    }
+    static void deinterleave(const float *p, V &even, V &odd) {
+        const V a = load(p), b = load(p + 4);
+        even = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        odd = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    }
+    static void interleave2(float *p, V even, V odd) {
+        store(p, _mm_unpacklo_ps(even, odd));
+        store(p + 4, _mm_unpackhi_ps(even, odd));
+    }
+    static V reverse(V v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3)); }
+};
+
+template <>
+struct SimdOps<double> {
+    typedef __m128d V;
+    static constexpr int W = 2;
+    static V load(const double *p) { return _mm_loadu_pd(p); }
+    static void store(double *p, V v) { _mm_storeu_pd(p, v); }
+    static V set1(double x) { return _mm_set1_pd(x); }
+    static V add(V a, V b) { return _mm_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm_div_pd(a, b); }
+    static V sqrt(V a) { return _mm_sqrt_pd(a); }
+    static V step(V edge, V x) { return _mm_and_pd(_mm_cmpge_pd(x, edge), _mm_set1_pd(1.)); }
+    static double sum(V v) { return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v))); }
+    static void interleave(double *y, int, V r0, V r1, V r2, V r3) {
+        store(y, _mm_unpacklo_pd(r0, r1));
+        store(y + 2, _mm_unpacklo_pd(r2, r3));
+        store(y + 4, _mm_unpackhi_pd(r0, r1));
+        store(y + 6, _mm_unpackhi_pd(r2, r3));
+    }
+    static void deinterleave(const double *p, V &even, V &odd) {
+        const V a = load(p), b = load(p + 2);
+        even = _mm_unpacklo_pd(a, b);
+        odd = _mm_unpackhi_pd(a, b);
+    }
+    static void interleave2(double *p, V even, V odd) {
+        store(p, _mm_unpacklo_pd(even, odd));
+        store(p + 2, _mm_unpackhi_pd(even, odd));
+    }
+    static V reverse(V v) { return _mm_shuffle_pd(v, v, 1); }
+};
+
+#elif defined(QM_DSP_SIMD_NEON)
+
+inline const char *simdInstructionSet() { return "neon"; }
+
+template <>
+struct SimdOps<float> {
+    typedef float32x4_t V;
+    static constexpr int W = 4;
+    static V load(const float *p) { return vld1q_f32(p); }
+    static void store(float *p, V v) { vst1q_f32(p, v); }
+    static V set1(float x) { return vdupq_n_f32(x); }
+    static V add(V a, V b) { return vaddq_f32(a, b); }
+    static V sub(V a, V b) { return vsubq_f32(a, b); }
+    static V mul(V a, V b) { return vmulq_f32(a, b); }
+    static V div(V a, V b) { return vdivq_f32(a, b); }
+    static V sqrt(V a) { return vsqrtq_f32(a); }
+    static V step(V edge, V x) {
+        return vreinterpretq_f32_u32(
+            vandq_u32(vcgeq_f32(x, edge), vreinterpretq_u32_f32(vdupq_n_f32(1.f))));
+    }
+    static float sum(V v) { return vaddvq_f32(v); }
+    static void interleave(float *y, int, V r0, V r1, V r2, V r3) {
+        float32x4x4_t r = {{r0, r1, r2, r3}};
+        vst4q_f32(y, r);
+    }
+    static void deinterleave(const float *p, V &even, V &odd) {
+        const float32x4x2_t v = vld2q_f32(p);
+        even = v.val[0];
+        odd = v.val[1];
+    }
+    static void interleave2(float *p, V even, V odd) {
+        float32x4x2_t v = {{even, odd}};
+        vst2q_f32(p, v);
+    }
+    static V reverse(V v) {
+        const V pairs = vrev64q_f32(v);
+        return vextq_f32(pairs, pairs, 2);
+    }
+};
+
+template <>
+struct SimdOps<double> {
+    typedef float64x2_t V;
+    static constexpr int W = 2;
+    static V load(const double *p) { return vld1q_f64(p); }
+    static void store(double *p, V v) { vst1q_f64(p, v); }
+    static V set1(double x) { return vdupq_n_f64(x); }
+    static V add(V a, V b) { return vaddq_f64(a, b); }
+    static V sub(V a, V b) { return vsubq_f64(a, b); }
+    static V mul(V a, V b) { return vmulq_f64(a, b); }
+    static V div(V a, V b) { return vdivq_f64(a, b); }
+    static V sqrt(V a) { return vsqrtq_f64(a); }
+    static V step(V edge, V x) {
+        return vreinterpretq_f64_u64(
+            vandq_u64(vcgeq_f64(x, edge), vreinterpretq_u64_f64(vdupq_n_f64(1.))));
+    }
+    static double sum(V v) { return vaddvq_f64(v); }
+    static void interleave(double *y, int, V r0, V r1, V r2, V r3) {
+        float64x2x4_t r = {{r0, r1, r2, r3}};
+        vst4q_f64(y, r);
+    }
+    static void deinterleave(const double *p, V &even, V &odd) {
+        const float64x2x2_t v = vld2q_f64(p);
+        even = v.val[0];
+        odd = v.val[1];
+    }
+    static void interleave2(double *p, V even, V odd) {
+        float64x2x2_t v = {{even, odd}};
+        vst2q_f64(p, v);
+    }
+    static V reverse(V v) { return vextq_f64(v, v, 1); }
+};
+
+#else
+
+inline const char *simdInstructionSet() { return "scalar"; }
+
+template <typename T>
+struct SimdOps : ScalarOps<T> {};
+
+#endif
+
+#endif
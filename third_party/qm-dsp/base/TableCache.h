@@ -0,0 +1,56 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+#ifndef QM_DSP_TABLECACHE_H
+#define QM_DSP_TABLECACHE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+/**
+ * Process-wide cache of immutable precomputed tables (windows, FFT
+ * plans, constant-Q kernels), so that objects constructed over and
+ * over with the same parameters only pay for the table once.
+ *
+ * Each Key/Value pair has its own map. Tables are never evicted; keys
+ * are configurations such as (sample rate, size), of which a process
+ * sees only a handful. Safe to use from any number of threads.
+ */
+template <typename Key, typename Value>
+class TableCache {
+  public:
+    /**
+     * Return the table for key, calling build() (which must return
+     * something convertible to std::shared_ptr<const Value>) if it
+     * has not been built yet. build() runs without the lock held; if
+     * two threads race on a new key, the first table stored wins.
+     */
+    template <typename Build>
+    static std::shared_ptr<const Value> get(const Key& key, Build build) {
+        State& state = getState();
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            auto it = state.tables.find(key);
+            if (it != state.tables.end()) {
+                return it->second;
+            }
+        }
+        std::shared_ptr<const Value> table = build();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        return state.tables.emplace(key, std::move(table)).first->second;
+    }
+
+  private:
+    struct State {
+        std::mutex mutex;
+        std::map<Key, std::shared_ptr<const Value>> tables;
+    };
+
+    static State& getState() {
+        static State state;
+        return state;
+    }
+};
+
+#endif
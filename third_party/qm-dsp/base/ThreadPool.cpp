@@ -0,0 +1,97 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool &ThreadPool::shared() {
+    static ThreadPool pool(std::max(1, int(std::thread::hardware_concurrency())) - 1);
+    return pool;
+}
+
+ThreadPool::ThreadPool(int workers) : m_stopping(false) {
+    for (int i = 0; i < workers; ++i) {
+        m_workers.emplace_back([this]() { run(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &t : m_workers) {
+        t.join();
+    }
+}
+
+void ThreadPool::run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)> &fn) {
+    if (count <= 0) {
+        return;
+    }
+
+    // Shared with the helper tasks, which may only get to run after
+    // every index has been claimed and this call has returned; they
+    // then find nothing left to do and never touch fn.
+    struct Loop {
+        const std::function<void(int)> *fn;
+        int count;
+        std::atomic<int> next{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+        int done = 0;
+    };
+    auto loop = std::make_shared<Loop>();
+    loop->fn = &fn;
+    loop->count = count;
+
+    auto work = [loop]() {
+        int n = 0;
+        for (int i = loop->next++; i < loop->count; i = loop->next++) {
+            (*loop->fn)(i);
+            ++n;
+        }
+        if (n > 0) {
+            std::lock_guard<std::mutex> lock(loop->mutex);
+            loop->done += n;
+            if (loop->done == loop->count) {
+                loop->finished.notify_all();
+            }
+        }
+    };
+
+    const int helpers = std::min(int(m_workers.size()), count - 1);
+    if (helpers > 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (int i = 0; i < helpers; ++i) {
+                m_tasks.push_back(work);
+            }
+        }
+        m_wake.notify_all();
+    }
+
+    work();
+
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->finished.wait(lock, [&loop]() { return loop->done == loop->count; });
+}
@@ -0,0 +1,54 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+#ifndef QM_DSP_THREADPOOL_H
+#define QM_DSP_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Process-wide pool of worker threads for data-parallel loops inside
+ * the library. There is one pool of hardware_concurrency() - 1
+ * workers; the thread calling parallelFor() always takes part, so
+ * concurrent callers share the machine's cores instead of each
+ * starting a full set of threads.
+ */
+class ThreadPool {
+  public:
+    static ThreadPool &shared();
+
+    /**
+     * Number of threads that may run a loop at once, counting the
+     * caller.
+     */
+    int getThreadCount() const { return int(m_workers.size()) + 1; }
+
+    /**
+     * Call fn(i) once for every i in [0, count), spread over the
+     * caller and any idle workers, and return when all calls have
+     * finished. Calls may run concurrently and in any order, so fn
+     * must only write to state owned by index i.
+     */
+    void parallelFor(int count, const std::function<void(int)> &fn);
+
+  private:
+    explicit ThreadPool(int workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void run();
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_stopping;
+    std::vector<std::thread> m_workers;
+};
+
+#endif
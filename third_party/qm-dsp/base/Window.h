@@ -18,8 +18,12 @@
 #include <cmath>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <utility>
 #include <vector>
 
+#include "base/TableCache.h"
+
 enum WindowType {
     RectangularWindow,
     BartlettWindow,
@@ -35,6 +39,8 @@ enum WindowType {
 /**
  * Various shaped windows for sample frame conditioning, including
  * cosine windows (Hann etc) and triangular and rectangular windows.
+ * Window tables are immutable and shared between all windows of the
+ * same type and size (see TableCache).
  */
 template <typename T>
 class Window {
@@ -56,14 +62,32 @@ class Window {
         encache();
         return *this;
     }
-    virtual ~Window() { delete[] m_cache; }
+    virtual ~Window() {}
 
     void cut(T *src) const { cut(src, src); }
-    void cut(const T *src, T *dst) const {
+    /**
+     * Window src into dst. src may hold another scalar type than T;
+     * its samples are converted as they are windowed.
+     */
+    template <typename S>
+    void cut(const S *src, T *dst) const {
         for (int i = 0; i < m_size; ++i) {
             dst[i] = src[i] * m_cache[i];
         }
     }
+    /**
+     * Window src into dst and swap the two halves of the result, as
+     * before an FFT that should see the frame centred on its first
+     * sample, in one pass. The size must be even.
+     */
+    template <typename S>
+    void cutShifted(const S *src, T *dst) const {
+        const int h = m_size / 2;
+        for (int i = 0; i < h; ++i) {
+            dst[i] = src[i + h] * m_cache[i + h];
+            dst[i + h] = src[i] * m_cache[i];
+        }
+    }
 
     WindowType getType() const { return m_type; }
     int getSize() const { return m_size; }
@@ -79,20 +103,31 @@ class Window {
   protected:
     WindowType m_type;
     int m_size;
-    T *m_cache;
+    std::shared_ptr<const std::vector<T> > m_table;  // shared via TableCache
+    const T *m_cache;
 
     void encache();
+    static std::shared_ptr<const std::vector<T> > build(WindowType type, int n);
 };
 
 template <typename T>
 void Window<T>::encache() {
-    int n = m_size;
-    T *mult = new T[n];
+    const WindowType type = m_type;
+    const int n = m_size;
+    m_table = TableCache<std::pair<int, int>, std::vector<T> >::get(
+        std::make_pair(int(type), n), [type, n]() { return build(type, n); });
+    m_cache = m_table->data();
+}
+
+template <typename T>
+std::shared_ptr<const std::vector<T> > Window<T>::build(WindowType type, int n) {
+    std::shared_ptr<std::vector<T> > table(new std::vector<T>(n));
+    T *mult = table->data();
     int i;
     for (i = 0; i < n; ++i)
         mult[i] = 1.0;
 
-    switch (m_type) {
+    switch (type) {
         case RectangularWindow:
             for (i = 0; i < n; ++i) {
                 mult[i] = mult[i] * 0.5;
@@ -149,7 +184,7 @@ void Window<T>::encache() {
             break;
     }
 
-    m_cache = mult;
+    return table;
 }
 
 #endif
@@ -21,11 +21,13 @@
 
 //----------------------------------------------------------------------------
 
-Chromagram::Chromagram(ChromaConfig Config) : m_skGenerated(false) {
+template <typename T>
+ChromagramT<T>::ChromagramT(ChromaConfig Config) : m_skGenerated(false) {
     initialise(Config);
 }
 
-int Chromagram::initialise(ChromaConfig Config) {
+template <typename T>
+int ChromagramT<T>::initialise(ChromaConfig Config) {
     m_FMin = Config.min;             // min freq
     m_FMax = Config.max;             // max freq
     m_BPO = Config.BPO;              // bins per octave
@@ -50,7 +52,7 @@ int Chromagram::initialise(ChromaConfig Config) {
     ConstantQConfig.CQThresh = Config.CQThresh;
 
     // Initialise ConstantQ operator
-    m_ConstantQ = new ConstantQ(ConstantQConfig);
+    m_ConstantQ = new ConstantQT<T>(ConstantQConfig);
 
     // No. of constant Q bins
     m_uK = m_ConstantQ->getK();
@@ -60,12 +62,12 @@ int Chromagram::initialise(ChromaConfig Config) {
     m_hopSize = m_ConstantQ->getHop();
 
     // Initialise FFT object
-    m_FFT = new FFTReal(m_frameSize);
+    m_FFT = new FFTRealT<T>(m_frameSize);
 
-    m_FFTRe = new double[m_frameSize];
-    m_FFTIm = new double[m_frameSize];
-    m_CQRe = new double[m_uK];
-    m_CQIm = new double[m_uK];
+    m_FFTRe = new T[m_frameSize];
+    m_FFTIm = new T[m_frameSize];
+    m_CQRe = new T[m_uK];
+    m_CQIm = new T[m_uK];
 
     m_window = 0;
     m_windowbuf = 0;
@@ -73,11 +75,13 @@ int Chromagram::initialise(ChromaConfig Config) {
     return 1;
 }
 
-Chromagram::~Chromagram() {
+template <typename T>
+ChromagramT<T>::~ChromagramT() {
     deInitialise();
 }
 
-int Chromagram::deInitialise() {
+template <typename T>
+int ChromagramT<T>::deInitialise() {
     delete[] m_windowbuf;
     delete m_window;
 
@@ -96,13 +100,15 @@ int Chromagram::deInitialise() {
 
 //----------------------------------------------------------------------------------
 // returns the absolute value of complex number xx + i*yy
-double Chromagram::kabs(double xx, double yy) {
-    double ab = sqrt(xx * xx + yy * yy);
+template <typename T>
+T ChromagramT<T>::kabs(T xx, T yy) {
+    T ab = std::sqrt(xx * xx + yy * yy);
     return (ab);
 }
 //-----------------------------------------------------------------------------------
 
-void Chromagram::unityNormalise(double *src) {
+template <typename T>
+void ChromagramT<T>::unityNormalise(double *src) {
     double min, max;
     double val = 0;
 
@@ -114,7 +120,8 @@ void Chromagram::unityNormalise(double *src) {
     }
 }
 
-double *Chromagram::process(const double *data) {
+template <typename T>
+double *ChromagramT<T>::process(const double *data) {
     if (!m_skGenerated) {
         // Generate CQ Kernel
         m_ConstantQ->sparsekernel();
@@ -122,8 +129,8 @@ double *Chromagram::process(const double *data) {
     }
 
     if (!m_window) {
-        m_window = new Window<double>(HammingWindow, m_frameSize);
-        m_windowbuf = new double[m_frameSize];
+        m_window = new Window<T>(HammingWindow, m_frameSize);
+        m_windowbuf = new T[m_frameSize];
     }
 
     for (int i = 0; i < m_frameSize; ++i) {
@@ -134,7 +141,7 @@ double *Chromagram::process(const double *data) {
     // The frequency-domain version expects pre-fftshifted input - so
     // we must do the same here
     for (int i = 0; i < m_frameSize / 2; ++i) {
-        double tmp = m_windowbuf[i];
+        T tmp = m_windowbuf[i];
         m_windowbuf[i] = m_windowbuf[i + m_frameSize / 2];
         m_windowbuf[i + m_frameSize / 2] = tmp;
     }
@@ -144,7 +151,8 @@ double *Chromagram::process(const double *data) {
     return process(m_FFTRe, m_FFTIm);
 }
 
-double *Chromagram::process(const double *real, const double *imag) {
+template <typename T>
+double *ChromagramT<T>::process(const T *real, const T *imag) {
     if (!m_skGenerated) {
         // Generate CQ Kernel
         m_ConstantQ->sparsekernel();
@@ -171,3 +179,6 @@ double *Chromagram::process(const double *real, const double *imag) {
 
     return m_chromadata;
 }
+
+template class ChromagramT<double>;
+template class ChromagramT<float>;
@@ -28,10 +28,16 @@ struct ChromaConfig {
     MathUtilities::NormaliseType normalise;
 };
 
-class Chromagram {
+/**
+ * Chromagram computing its windowing, FFT and constant-Q transform in
+ * the scalar type T, double or float; Chromagram is the double-precision
+ * version. Input frames and the chroma vector are double either way.
+ */
+template <typename T>
+class ChromagramT {
   public:
-    Chromagram(ChromaConfig Config);
-    ~Chromagram();
+    ChromagramT(ChromaConfig Config);
+    ~ChromagramT();
 
     /**
      * Process a time-domain input signal of length equal to
@@ -58,12 +64,12 @@ class Chromagram {
      * the Chromagram object and is reused from one process call to
      * the next.
      */
-    double* process(const double* real, const double* imag);
+    double* process(const T* real, const T* imag);
 
     void unityNormalise(double* src);
 
     // Complex arithmetic
-    double kabs(double real, double imag);
+    T kabs(T real, T imag);
 
     // Results
     int getK() { return m_uK; }
@@ -74,8 +80,8 @@ class Chromagram {
     int initialise(ChromaConfig Config);
     int deInitialise();
 
-    Window<double>* m_window;
-    double* m_windowbuf;
+    Window<T>* m_window;
+    T* m_windowbuf;
 
     double* m_chromadata;
     double m_FMin;
@@ -88,15 +94,17 @@ class Chromagram {
     int m_frameSize;
     int m_hopSize;
 
-    FFTReal* m_FFT;
-    ConstantQ* m_ConstantQ;
+    FFTRealT<T>* m_FFT;
+    ConstantQT<T>* m_ConstantQ;
 
-    double* m_FFTRe;
-    double* m_FFTIm;
-    double* m_CQRe;
-    double* m_CQIm;
+    T* m_FFTRe;
+    T* m_FFTIm;
+    T* m_CQRe;
+    T* m_CQIm;
 
     bool m_skGenerated;
 };
 
+typedef ChromagramT<double> Chromagram;
+
 #endif
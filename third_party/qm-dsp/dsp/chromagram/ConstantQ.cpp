@@ -15,17 +15,21 @@
 #include "ConstantQ.h"
 
 #include <iostream>
+#include <tuple>
 
+#include "base/TableCache.h"
 #include "base/Window.h"
 #include "dsp/transforms/FFT.h"
 
 //----------------------------------------------------------------------------
 
-ConstantQ::ConstantQ(CQConfig config) : m_sparseKernel(0) {
+template <typename T>
+ConstantQT<T>::ConstantQT(CQConfig config) {
     initialise(config);
 }
 
-ConstantQ::~ConstantQ() {
+template <typename T>
+ConstantQT<T>::~ConstantQT() {
     deInitialise();
 }
 
@@ -33,8 +37,17 @@ static double squaredModule(const double &xx, const double &yy) {
     return xx * xx + yy * yy;
 }
 
-void ConstantQ::sparsekernel() {
-    SparseKernel *sk = new SparseKernel();
+template <typename T>
+void ConstantQT<T>::sparsekernel() {
+    typedef std::tuple<double, double, double, int, double> Key;
+    m_sparseKernel = TableCache<Key, SparseKernel>::get(
+        Key(m_FS, m_FMin, m_FMax, m_BPO, m_CQThresh), [this]() { return buildSparseKernel(); });
+}
+
+template <typename T>
+std::shared_ptr<const typename ConstantQT<T>::SparseKernel> ConstantQT<T>::buildSparseKernel()
+    const {
+    std::shared_ptr<SparseKernel> sk(new SparseKernel());
 
     double *windowRe = new double[m_FFTLength];
     double *windowIm = new double[m_FFTLength];
@@ -119,10 +132,11 @@ void ConstantQ::sparsekernel() {
     delete[] transfWindowRe;
     delete[] transfWindowIm;
 
-    m_sparseKernel = sk;
+    return sk;
 }
 
-void ConstantQ::initialise(CQConfig Config) {
+template <typename T>
+void ConstantQT<T>::initialise(CQConfig Config) {
     m_FS = Config.FS;              // Sample rate
     m_FMin = Config.min;           // Minimum frequency
     m_FMax = Config.max;           // Maximum frequency
@@ -142,23 +156,24 @@ void ConstantQ::initialise(CQConfig Config) {
     m_hop = m_FFTLength / 8;
 
     // allocate memory for cqdata
-    m_CQdata = new double[2 * m_uK];
+    m_CQdata = new T[2 * m_uK];
 }
 
-void ConstantQ::deInitialise() {
+template <typename T>
+void ConstantQT<T>::deInitialise() {
     delete[] m_CQdata;
-    delete m_sparseKernel;
 }
 
 //-----------------------------------------------------------------------------
-double *ConstantQ::process(const double *fftdata) {
+template <typename T>
+T *ConstantQT<T>::process(const T *fftdata) {
     if (!m_sparseKernel) {
         std::cerr << "ERROR: ConstantQ::process: Sparse kernel has not been initialised"
                   << std::endl;
         return m_CQdata;
     }
 
-    SparseKernel *sk = m_sparseKernel;
+    const SparseKernel *sk = m_sparseKernel.get();
 
     for (int row = 0; row < 2 * m_uK; row++) {
         m_CQdata[row] = 0;
@@ -166,8 +181,8 @@ double *ConstantQ::process(const double *fftdata) {
     }
     const int *fftbin = &(sk->is[0]);
     const int *cqbin = &(sk->js[0]);
-    const double *real = &(sk->real[0]);
-    const double *imag = &(sk->imag[0]);
+    const T *real = &(sk->real[0]);
+    const T *imag = &(sk->imag[0]);
     const int sparseCells = int(sk->real.size());
 
     for (int i = 0; i < sparseCells; i++) {
@@ -175,10 +190,10 @@ double *ConstantQ::process(const double *fftdata) {
         const int col = fftbin[i];
         if (col == 0)
             continue;
-        const double &r1 = real[i];
-        const double &i1 = imag[i];
-        const double &r2 = fftdata[(2 * m_FFTLength) - 2 * col - 2];
-        const double &i2 = fftdata[(2 * m_FFTLength) - 2 * col - 2 + 1];
+        const T &r1 = real[i];
+        const T &i1 = imag[i];
+        const T &r2 = fftdata[(2 * m_FFTLength) - 2 * col - 2];
+        const T &i2 = fftdata[(2 * m_FFTLength) - 2 * col - 2 + 1];
         // add the multiplication
         m_CQdata[2 * row] += (r1 * r2 - i1 * i2);
         m_CQdata[2 * row + 1] += (r1 * i2 + i1 * r2);
@@ -187,14 +202,15 @@ double *ConstantQ::process(const double *fftdata) {
     return m_CQdata;
 }
 
-void ConstantQ::process(const double *FFTRe, const double *FFTIm, double *CQRe, double *CQIm) {
+template <typename T>
+void ConstantQT<T>::process(const T *FFTRe, const T *FFTIm, T *CQRe, T *CQIm) {
     if (!m_sparseKernel) {
         std::cerr << "ERROR: ConstantQ::process: Sparse kernel has not been initialised"
                   << std::endl;
         return;
     }
 
-    SparseKernel *sk = m_sparseKernel;
+    const SparseKernel *sk = m_sparseKernel.get();
 
     for (int row = 0; row < m_uK; row++) {
         CQRe[row] = 0;
@@ -203,8 +219,8 @@ void ConstantQ::process(const double *FFTRe, const double *FFTIm, double *CQRe,
 
     const int *fftbin = &(sk->is[0]);
     const int *cqbin = &(sk->js[0]);
-    const double *real = &(sk->real[0]);
-    const double *imag = &(sk->imag[0]);
+    const T *real = &(sk->real[0]);
+    const T *imag = &(sk->imag[0]);
     const int sparseCells = int(sk->real.size());
 
     for (int i = 0; i < sparseCells; i++) {
@@ -212,12 +228,15 @@ void ConstantQ::process(const double *FFTRe, const double *FFTIm, double *CQRe,
         const int col = fftbin[i];
         if (col == 0)
             continue;
-        const double &r1 = real[i];
-        const double &i1 = imag[i];
-        const double &r2 = FFTRe[m_FFTLength - col];
-        const double &i2 = FFTIm[m_FFTLength - col];
+        const T &r1 = real[i];
+        const T &i1 = imag[i];
+        const T &r2 = FFTRe[m_FFTLength - col];
+        const T &i2 = FFTIm[m_FFTLength - col];
         // add the multiplication
         CQRe[row] += (r1 * r2 - i1 * i2);
         CQIm[row] += (r1 * i2 + i1 * r2);
     }
 }
+
+template class ConstantQT<double>;
+template class ConstantQT<float>;
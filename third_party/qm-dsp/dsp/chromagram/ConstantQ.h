@@ -16,6 +16,7 @@
 #ifndef QM_DSP_CONSTANTQ_H
 #define QM_DSP_CONSTANTQ_H
 
+#include <memory>
 #include <vector>
 
 #include "maths/MathAliases.h"
@@ -29,14 +30,20 @@ struct CQConfig {
     double CQThresh;  // threshold
 };
 
-class ConstantQ {
+/**
+ * Constant-Q transform computing in the scalar type T, double or float;
+ * ConstantQ is the double-precision version. The sparse kernel is always
+ * designed in double and stored in T.
+ */
+template <typename T>
+class ConstantQT {
   public:
-    ConstantQ(CQConfig config);
-    ~ConstantQ();
+    ConstantQT(CQConfig config);
+    ~ConstantQT();
 
-    void process(const double* FFTRe, const double* FFTIm, double* CQRe, double* CQIm);
+    void process(const T* FFTRe, const T* FFTIm, T* CQRe, T* CQIm);
 
-    double* process(const double* FFTData);
+    T* process(const T* FFTData);
 
     void sparsekernel();
 
@@ -49,7 +56,7 @@ class ConstantQ {
     void initialise(CQConfig config);
     void deInitialise();
 
-    double* m_CQdata;
+    T* m_CQdata;
     double m_FS;
     double m_FMin;
     double m_FMax;
@@ -63,11 +70,16 @@ class ConstantQ {
     struct SparseKernel {
         std::vector<int> is;
         std::vector<int> js;
-        std::vector<double> imag;
-        std::vector<double> real;
+        std::vector<T> imag;
+        std::vector<T> real;
     };
 
-    SparseKernel* m_sparseKernel;
+    // Depends only on the config; shared process-wide via TableCache.
+    std::shared_ptr<const SparseKernel> m_sparseKernel;
+
+    std::shared_ptr<const SparseKernel> buildSparseKernel() const;
 };
 
+typedef ConstantQT<double> ConstantQ;
+
 #endif  // CONSTANTQ_H
@@ -17,11 +17,13 @@
 
 #include "GetKeyMode.h"
 
-#include <cstdlib>
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <iostream>
 
 #include "base/Pitch.h"
+#include "base/SimdOps.h"
 #include "dsp/chromagram/Chromagram.h"
 #include "dsp/rateconversion/Decimator.h"
 #include "maths/MathUtilities.h"
@@ -40,6 +42,22 @@ static double MinProfile[kBinsPerOctave] = {
     0.0222, 0.0349, 0.0164, 0.0174, 0.0297, 0.0166, 0.0222, 0.0401, 0.0202, 0.0175, 0.0270, 0.0146};
 //
 
+// Keys are 1-24, and 0 (no key) fills the median buffer initially
+static const int kKeyValues = 25;
+
+// Rows of the profile matrix: 36 rotations of the major, then the minor
+// profile
+static const int kProfileRows = 2 * kBinsPerOctave;
+
+// The running HPCP sum differs from a fresh sum of the chroma buffer by
+// rounding only: it is re-summed every m_chromaBufferSize hops, so each bin
+// has taken at most 2 * m_chromaBufferSize additions of chroma values in
+// [0, 1], leaving an error far below 1e-12 in the mean HPCP. That moves a
+// correlation by less than 1e-10 / |mean HPCP - its mean|, well above the
+// rounding of the profile matrix product too; keys closer than that are
+// decided from a fresh sum and krumCorr(), as they always were.
+static const double kKeyMarginTolerance = 1e-10;
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -48,14 +66,17 @@ GetKeyMode::GetKeyMode(Config config)
     : m_hpcpAverage(config.hpcpAverage),
       m_medianAverage(config.medianAverage),
       m_decimationFactor(config.decimationFactor),
+      m_chroma(0),
+      m_chromaFloat(0),
       m_chrPointer(0),
       m_decimatedBuffer(0),
       m_chromaBuffer(0),
+      m_hpcpSum(0),
       m_meanHPCP(0),
       m_majCorr(0),
       m_minCorr(0),
       m_medianFilterBuffer(0),
-      m_sortedBuffer(0),
+      m_keyCounts(0),
       m_keyStrengths(0) {
     ChromaConfig chromaConfig;
 
@@ -77,10 +98,13 @@ GetKeyMode::GetKeyMode(Config config)
     chromaConfig.CQThresh = 0.0054;
 
     // Chromagram inst.
-    m_chroma = new Chromagram(chromaConfig);
-
-    // Get calculated parameters from chroma object
-    m_chromaFrameSize = m_chroma->getFrameSize();
+    if (config.singlePrecision) {
+        m_chromaFloat = new ChromagramT<float>(chromaConfig);
+        m_chromaFrameSize = m_chromaFloat->getFrameSize();
+    } else {
+        m_chroma = new Chromagram(chromaConfig);
+        m_chromaFrameSize = m_chroma->getFrameSize();
+    }
 
     // override hopsize for this application
     m_chromaHopSize = m_chromaFrameSize / config.frameOverlapFactor;
@@ -95,6 +119,7 @@ GetKeyMode::GetKeyMode(Config config)
     // Reset counters
     m_bufferIndex = 0;
     m_chromaBufferFilling = 0;
+    m_medianIndex = 0;
     m_medianBufferFilling = 0;
 
     // Spawn objectc/arrays
@@ -103,6 +128,9 @@ GetKeyMode::GetKeyMode(Config config)
 
     memset(m_chromaBuffer, 0, sizeof(double) * kBinsPerOctave * m_chromaBufferSize);
 
+    m_hpcpSum = new double[kBinsPerOctave];
+    memset(m_hpcpSum, 0, sizeof(double) * kBinsPerOctave);
+
     m_meanHPCP = new double[kBinsPerOctave];
 
     m_majCorr = new double[kBinsPerOctave];
@@ -119,30 +147,59 @@ GetKeyMode::GetKeyMode(Config config)
         m_minProfileNorm[i] = MinProfile[i] - mMin;
     }
 
+    // The rotations krumCorr() correlates with, as rows of unit norm.
+    // Stored bin-major, so one pass over the HPCP bins accumulates all the
+    // correlations, a vector of rows at a time.
+    double majLength = 0.0;
+    double minLength = 0.0;
+    for (int i = 0; i < kBinsPerOctave; i++) {
+        majLength += m_majProfileNorm[i] * m_majProfileNorm[i];
+        minLength += m_minProfileNorm[i] * m_minProfileNorm[i];
+    }
+    majLength = sqrt(majLength);
+    minLength = sqrt(minLength);
+
+    m_profileMatrix = new double[kBinsPerOctave * kProfileRows];
+    for (int k = 0; k < kBinsPerOctave; k++) {
+        // shifted by one, as in correlate()
+        const int shift = k - 1;
+        for (int i = 0; i < kBinsPerOctave; i++) {
+            const int p = (i - shift + kBinsPerOctave) % kBinsPerOctave;
+            m_profileMatrix[i * kProfileRows + k] = m_majProfileNorm[p] / majLength;
+            m_profileMatrix[i * kProfileRows + kBinsPerOctave + k] =
+                m_minProfileNorm[p] / minLength;
+        }
+    }
+
     m_medianFilterBuffer = new int[m_medianWinSize];
     memset(m_medianFilterBuffer, 0, sizeof(int) * m_medianWinSize);
 
-    m_sortedBuffer = new int[m_medianWinSize];
-    memset(m_sortedBuffer, 0, sizeof(int) * m_medianWinSize);
+    m_keyCounts = new int[kKeyValues];
+    memset(m_keyCounts, 0, sizeof(int) * kKeyValues);
 
-    m_decimator = new Decimator(m_chromaFrameSize * m_decimationFactor, m_decimationFactor);
+    // Created on first process(); callers of processDecimated() decimate
+    // the stream themselves and never need its block-sized buffer.
+    m_decimator = 0;
 
     m_keyStrengths = new double[24];
 }
 
 GetKeyMode::~GetKeyMode() {
     delete m_chroma;
+    delete m_chromaFloat;
     delete m_decimator;
 
     delete[] m_decimatedBuffer;
     delete[] m_chromaBuffer;
+    delete[] m_hpcpSum;
     delete[] m_meanHPCP;
     delete[] m_majCorr;
     delete[] m_minCorr;
     delete[] m_majProfileNorm;
     delete[] m_minProfileNorm;
+    delete[] m_profileMatrix;
     delete[] m_medianFilterBuffer;
-    delete[] m_sortedBuffer;
+    delete[] m_keyCounts;
     delete[] m_keyStrengths;
 }
 
@@ -176,38 +233,30 @@ double GetKeyMode::krumCorr(const double *pDataNorm, const double *pProfileNorm,
 }
 
 int GetKeyMode::process(double *pcmData) {
-    int key;
-    int j, k;
-
+    if (!m_decimator) {
+        m_decimator = new Decimator(m_chromaFrameSize * m_decimationFactor, m_decimationFactor);
+    }
     m_decimator->process(pcmData, m_decimatedBuffer);
 
-    m_chrPointer = m_chroma->process(m_decimatedBuffer);
-
-    // populate hpcp values
-    int cbidx;
-    for (j = 0; j < kBinsPerOctave; j++) {
-        cbidx = (m_bufferIndex * kBinsPerOctave) + j;
-        m_chromaBuffer[cbidx] = m_chrPointer[j];
-    }
+    return processDecimated(m_decimatedBuffer);
+}
 
-    // keep track of input buffers
-    if (m_bufferIndex++ >= m_chromaBufferSize - 1) {
-        m_bufferIndex = 0;
+void GetKeyMode::sumChromaBuffer(double *sum) {
+    for (int k = 0; k < kBinsPerOctave; k++) {
+        double mnVal = 0.0;
+        for (int j = 0; j < m_chromaBufferFilling; j++) {
+            mnVal += m_chromaBuffer[k + (j * kBinsPerOctave)];
+        }
+        sum[k] = mnVal;
     }
+}
 
-    // track filling of chroma matrix
-    if (m_chromaBufferFilling++ >= m_chromaBufferSize) {
-        m_chromaBufferFilling = m_chromaBufferSize;
-    }
+void GetKeyMode::correlate(const double *hpcpSum, bool exact) {
+    int k;
 
     // calculate mean
     for (k = 0; k < kBinsPerOctave; k++) {
-        double mnVal = 0.0;
-        for (j = 0; j < m_chromaBufferFilling; j++) {
-            mnVal += m_chromaBuffer[k + (j * kBinsPerOctave)];
-        }
-
-        m_meanHPCP[k] = mnVal / (double)m_chromaBufferFilling;
+        m_meanHPCP[k] = hpcpSum[k] / (double)m_chromaBufferFilling;
     }
 
     // Normalize for zero average
@@ -216,6 +265,11 @@ int GetKeyMode::process(double *pcmData) {
         m_meanHPCP[k] -= mHPCP;
     }
 
+    if (!exact) {
+        correlateProfiles();
+        return;
+    }
+
     for (k = 0; k < kBinsPerOctave; k++) {
         // The cromagram and the major and minor profiles have the
         // center of C at bin 1. We want to have the correlation for C result
@@ -223,6 +277,102 @@ int GetKeyMode::process(double *pcmData) {
         m_majCorr[k] = krumCorr(m_meanHPCP, m_majProfileNorm, (int)k - 1, kBinsPerOctave);
         m_minCorr[k] = krumCorr(m_meanHPCP, m_minProfileNorm, (int)k - 1, kBinsPerOctave);
     }
+}
+
+void GetKeyMode::correlateProfiles() {
+    typedef SimdOps<double> Ops;
+
+    double sum1 = 0.0;
+    for (int i = 0; i < kBinsPerOctave; i++) {
+        sum1 += m_meanHPCP[i] * m_meanHPCP[i];
+    }
+    const double length = sqrt(sum1);
+
+    // Bin by bin, so the rows' sums don't wait on each other
+    double corr[kProfileRows] = {};
+    for (int i = 0; i < kBinsPerOctave; i++) {
+        const Ops::V x = Ops::set1(m_meanHPCP[i]);
+        const double *row = m_profileMatrix + i * kProfileRows;
+        for (int r = 0; r < kProfileRows; r += Ops::W) {
+            Ops::store(corr + r, Ops::add(Ops::load(corr + r), Ops::mul(Ops::load(row + r), x)));
+        }
+    }
+
+    for (int k = 0; k < kBinsPerOctave; k++) {
+        m_majCorr[k] = length > 0 ? corr[k] / length : 0;
+        m_minCorr[k] = length > 0 ? corr[kBinsPerOctave + k] / length : 0;
+    }
+}
+
+bool GetKeyMode::isKeyUnambiguous() {
+    // Best correlation of each key, over its three bins
+    double best[24];
+    for (int k = 0; k < 24; k++) {
+        best[k] = -HUGE_VAL;
+    }
+    for (int k = 0; k < kBinsPerOctave; k++) {
+        best[k / 3] = std::max(best[k / 3], m_majCorr[k]);
+        best[(k + kBinsPerOctave) / 3] = std::max(best[(k + kBinsPerOctave) / 3], m_minCorr[k]);
+    }
+    double first = -HUGE_VAL;
+    double second = -HUGE_VAL;
+    for (int k = 0; k < 24; k++) {
+        if (best[k] > first) {
+            second = first;
+            first = best[k];
+        } else if (best[k] > second) {
+            second = best[k];
+        }
+    }
+
+    double norm = 0.0;
+    for (int k = 0; k < kBinsPerOctave; k++) {
+        norm += m_meanHPCP[k] * m_meanHPCP[k];
+    }
+    return (first - second) * sqrt(norm) > kKeyMarginTolerance;
+}
+
+int GetKeyMode::processDecimated(const double *decimatedData) {
+    int key;
+    int j, k;
+
+    m_chrPointer = m_chroma ? m_chroma->process(decimatedData)
+                            : m_chromaFloat->process(decimatedData);
+
+    // populate hpcp values, replacing the oldest in the running sum
+    // once the buffer is full
+    const bool full = m_chromaBufferFilling >= m_chromaBufferSize;
+    double *slot = m_chromaBuffer + m_bufferIndex * kBinsPerOctave;
+    for (j = 0; j < kBinsPerOctave; j++) {
+        if (full) {
+            m_hpcpSum[j] -= slot[j];
+        }
+        slot[j] = m_chrPointer[j];
+        m_hpcpSum[j] += slot[j];
+    }
+
+    // keep track of input buffers
+    if (m_bufferIndex++ >= m_chromaBufferSize - 1) {
+        m_bufferIndex = 0;
+    }
+
+    // track filling of chroma matrix
+    if (m_chromaBufferFilling++ >= m_chromaBufferSize) {
+        m_chromaBufferFilling = m_chromaBufferSize;
+    }
+
+    // Re-sum once per pass over the buffer, so rounding can't build up.
+    // Until the buffer first fills, the running sum adds the same values
+    // in the same order and is exact anyway.
+    if (m_bufferIndex == 0) {
+        sumChromaBuffer(m_hpcpSum);
+    }
+
+    correlate(m_hpcpSum, false);
+    if (!isKeyUnambiguous()) {
+        sumChromaBuffer(m_meanHPCP);
+        correlate(m_meanHPCP, true);
+    }
 
     // m_MajCorr[1] is C center  1 / 3 + 1 = 1
     // m_MajCorr[4] is D center  4 / 3 + 1 = 2
@@ -234,30 +384,24 @@ int GetKeyMode::process(double *pcmData) {
     int maxBin = (maxMaj > maxMin) ? maxMajBin : (maxMinBin + kBinsPerOctave);
     key = maxBin / 3 + 1;
 
-    // Median filtering
+    // Median filtering, over counts of the key values in the median
+    // buffer rather than a sorted copy of it
 
-    // track Median buffer initial filling
-    if (m_medianBufferFilling++ >= m_medianWinSize) {
-        m_medianBufferFilling = m_medianWinSize;
+    // replace the oldest key once the median buffer is full
+    if (m_medianBufferFilling >= m_medianWinSize) {
+        m_keyCounts[m_medianFilterBuffer[m_medianIndex]]--;
     }
-
-    // shift median buffer
-    for (k = 1; k < m_medianWinSize; k++) {
-        m_medianFilterBuffer[k - 1] = m_medianFilterBuffer[k];
+    m_medianFilterBuffer[m_medianIndex] = key;
+    m_keyCounts[key]++;
+    if (++m_medianIndex >= m_medianWinSize) {
+        m_medianIndex = 0;
     }
 
-    // write new key value into median buffer
-    m_medianFilterBuffer[m_medianWinSize - 1] = key;
-
-    // copy median into sorting buffer, reversed
-    int ijx = 0;
-    for (k = 0; k < m_medianWinSize; k++) {
-        m_sortedBuffer[k] = m_medianFilterBuffer[m_medianWinSize - 1 - ijx];
-        ijx++;
+    // track Median buffer initial filling
+    if (m_medianBufferFilling++ >= m_medianWinSize) {
+        m_medianBufferFilling = m_medianWinSize;
     }
 
-    qsort(m_sortedBuffer, m_medianBufferFilling, sizeof(int), MathUtilities::compareInt);
-
     int sortlength = m_medianBufferFilling;
     int midpoint = (int)ceil((double)sortlength / 2);
 
@@ -265,7 +409,14 @@ int GetKeyMode::process(double *pcmData) {
         midpoint = 1;
     }
 
-    key = m_sortedBuffer[midpoint - 1];
+    // the midpoint-th smallest key
+    int seen = 0;
+    for (key = 0; key < kKeyValues - 1; key++) {
+        seen += m_keyCounts[key];
+        if (seen >= midpoint) {
+            break;
+        }
+    }
 
     return key;
 }
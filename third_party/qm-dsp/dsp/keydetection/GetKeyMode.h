@@ -14,7 +14,8 @@
 #define QM_DSP_GETKEYMODE_H
 
 class Decimator;
-class Chromagram;
+template <typename T>
+class ChromagramT;
 
 class GetKeyMode {
   public:
@@ -27,6 +28,7 @@ class GetKeyMode {
                                  // we skip a fair bit of input data);
                                  // 8 = normal chroma overlap
         int decimationFactor;
+        bool singlePrecision;  // run the chromagram in float
 
         Config(double _sampleRate, float _tuningFrequency)
             : sampleRate(_sampleRate),
@@ -34,7 +36,8 @@ class GetKeyMode {
               hpcpAverage(10),
               medianAverage(10),
               frameOverlapFactor(1),
-              decimationFactor(8) {}
+              decimationFactor(8),
+              singlePrecision(false) {}
     };
 
     GetKeyMode(Config config);
@@ -51,6 +54,14 @@ class GetKeyMode {
      */
     int process(double* pcmData);
 
+    /**
+     * Same as process() for input that has already been decimated by
+     * getDecimationFactor(), e.g. with Decimator::processStream().
+     * Takes getChromaFrameSize() samples advancing by
+     * getChromaHopSize() between frames.
+     */
+    int processDecimated(const double* decimatedData);
+
     /**
      * Return a pointer to an internal 24-element array containing the
      * correlation of the chroma vector generated in the last
@@ -62,19 +73,28 @@ class GetKeyMode {
     int getBlockSize() { return m_chromaFrameSize * m_decimationFactor; }
     int getHopSize() { return m_chromaHopSize * m_decimationFactor; }
 
+    int getDecimationFactor() const { return m_decimationFactor; }
+    int getChromaFrameSize() const { return m_chromaFrameSize; }
+    int getChromaHopSize() const { return m_chromaHopSize; }
+
   protected:
     double krumCorr(const double* pDataNorm, const double* pProfileNorm, int shiftProfile,
                     int length);
+    void sumChromaBuffer(double* sum);
+    void correlate(const double* hpcpSum, bool exact);
+    void correlateProfiles();
+    bool isKeyUnambiguous();
 
     double m_hpcpAverage;
     double m_medianAverage;
     int m_decimationFactor;
 
-    // Decimator (fixed)
+    // Decimator (fixed, created by the first process() call)
     Decimator* m_decimator;
 
-    // Chromagram object
-    Chromagram* m_chroma;
+    // Chromagram object, one of the two precisions
+    ChromagramT<double>* m_chroma;
+    ChromagramT<float>* m_chromaFloat;
 
     // Chromagram output pointer
     double* m_chrPointer;
@@ -90,18 +110,21 @@ class GetKeyMode {
 
     int m_bufferIndex;
     int m_chromaBufferFilling;
+    int m_medianIndex;
     int m_medianBufferFilling;
 
     double* m_decimatedBuffer;
     double* m_chromaBuffer;
+    double* m_hpcpSum;  // running sum of m_chromaBuffer
     double* m_meanHPCP;
 
     double* m_majProfileNorm;
     double* m_minProfileNorm;
+    double* m_profileMatrix;  // unit-norm profile rotations, bin-major
     double* m_majCorr;
     double* m_minCorr;
-    int* m_medianFilterBuffer;
-    int* m_sortedBuffer;
+    int* m_medianFilterBuffer;  // ring of the last m_medianWinSize keys
+    int* m_keyCounts;           // occurrences of each key 0-24 in it
 
     double* m_keyStrengths;
 };
@@ -15,26 +15,43 @@
 
 #include "DetectionFunction.h"
 
+#include <cmath>
+#include <complex>
 #include <cstring>
+#include <limits>
+
+#include "base/SimdOps.h"
 
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
 
-DetectionFunction::DetectionFunction(DFConfig config) : m_window(0) {
+template <typename T>
+DetectionFunctionT<T>::DetectionFunctionT(DFConfig config) : m_window(0) {
     m_magHistory = NULL;
     m_phaseHistory = NULL;
     m_phaseHistoryOld = NULL;
     m_magPeaks = NULL;
 
+    m_phaseVoc = NULL;
+    m_fft = NULL;
+    m_real = NULL;
+    m_imag = NULL;
+    m_phasorRe = NULL;
+    m_phasorIm = NULL;
+    m_phasorReOld = NULL;
+    m_phasorImOld = NULL;
+
     initialise(config);
 }
 
-DetectionFunction::~DetectionFunction() {
+template <typename T>
+DetectionFunctionT<T>::~DetectionFunctionT() {
     deInitialise();
 }
 
-void DetectionFunction::initialise(DFConfig Config) {
+template <typename T>
+void DetectionFunctionT<T>::initialise(DFConfig Config) {
     m_dataLength = Config.frameLength;
     m_halfLength = m_dataLength / 2 + 1;
 
@@ -50,29 +67,45 @@ void DetectionFunction::initialise(DFConfig Config) {
     if (m_whitenFloor < 0)
         m_whitenFloor = 0.01;
 
-    m_magHistory = new double[m_halfLength];
-    memset(m_magHistory, 0, m_halfLength * sizeof(double));
+    m_magHistory = new T[m_halfLength];
+    memset(m_magHistory, 0, m_halfLength * sizeof(T));
 
-    m_phaseHistory = new double[m_halfLength];
-    memset(m_phaseHistory, 0, m_halfLength * sizeof(double));
+    m_phaseHistory = new T[m_halfLength];
+    memset(m_phaseHistory, 0, m_halfLength * sizeof(T));
 
-    m_phaseHistoryOld = new double[m_halfLength];
-    memset(m_phaseHistoryOld, 0, m_halfLength * sizeof(double));
+    m_phaseHistoryOld = new T[m_halfLength];
+    memset(m_phaseHistoryOld, 0, m_halfLength * sizeof(T));
 
-    m_magPeaks = new double[m_halfLength];
-    memset(m_magPeaks, 0, m_halfLength * sizeof(double));
+    m_magPeaks = new T[m_halfLength];
+    memset(m_magPeaks, 0, m_halfLength * sizeof(T));
 
-    m_phaseVoc = new PhaseVocoder(m_dataLength, m_stepSize);
+    if (m_DFType == DF_COMPLEXSD && !m_whiten && kSimdFFTByDefault) {
+        m_fft = new FFTRealT<T>(m_dataLength);
+        m_real = new T[m_dataLength];
+        m_imag = new T[m_dataLength];
+
+        // Phase zero, as in the phase histories
+        m_phasorRe = new T[m_halfLength];
+        m_phasorIm = new T[m_halfLength];
+        m_phasorReOld = new T[m_halfLength];
+        m_phasorImOld = new T[m_halfLength];
+        for (int i = 0; i < m_halfLength; ++i) {
+            m_phasorRe[i] = m_phasorReOld[i] = 1;
+            m_phasorIm[i] = m_phasorImOld[i] = 0;
+        }
+    } else {
+        m_phaseVoc = new PhaseVocoderT<T>(m_dataLength, m_stepSize);
+    }
 
-    m_magnitude = new double[m_halfLength];
-    m_thetaAngle = new double[m_halfLength];
-    m_unwrapped = new double[m_halfLength];
+    m_magnitude = new T[m_halfLength];
+    m_thetaAngle = new T[m_halfLength];
 
-    m_window = new Window<double>(HanningWindow, m_dataLength);
-    m_windowed = new double[m_dataLength];
+    m_window = new Window<T>(HanningWindow, m_dataLength);
+    m_windowed = new T[m_dataLength];
 }
 
-void DetectionFunction::deInitialise() {
+template <typename T>
+void DetectionFunctionT<T>::deInitialise() {
     delete[] m_magHistory;
     delete[] m_phaseHistory;
     delete[] m_phaseHistoryOld;
@@ -80,18 +113,32 @@ void DetectionFunction::deInitialise() {
 
     delete m_phaseVoc;
 
+    delete m_fft;
+    delete[] m_real;
+    delete[] m_imag;
+    delete[] m_phasorRe;
+    delete[] m_phasorIm;
+    delete[] m_phasorReOld;
+    delete[] m_phasorImOld;
+
     delete[] m_magnitude;
     delete[] m_thetaAngle;
     delete[] m_windowed;
-    delete[] m_unwrapped;
 
     delete m_window;
 }
 
-double DetectionFunction::processTimeDomain(const double *samples) {
+template <typename T>
+double DetectionFunctionT<T>::processTimeDomain(const double *samples) {
+    if (m_fft) {
+        m_window->cutShifted(samples, m_windowed);
+        m_fft->forward(m_windowed, m_real, m_imag);
+        return complexSDRectangular(m_real, m_imag);
+    }
+
     m_window->cut(samples, m_windowed);
 
-    m_phaseVoc->processTimeDomain(m_windowed, m_magnitude, m_thetaAngle, m_unwrapped);
+    m_phaseVoc->processTimeDomain(m_windowed, m_magnitude, m_thetaAngle, NULL);
 
     if (m_whiten)
         whiten();
@@ -99,8 +146,12 @@ double DetectionFunction::processTimeDomain(const double *samples) {
     return runDF();
 }
 
-double DetectionFunction::processFrequencyDomain(const double *reals, const double *imags) {
-    m_phaseVoc->processFrequencyDomain(reals, imags, m_magnitude, m_thetaAngle, m_unwrapped);
+template <typename T>
+double DetectionFunctionT<T>::processFrequencyDomain(const T *reals, const T *imags) {
+    if (m_fft)
+        return complexSDRectangular(reals, imags);
+
+    m_phaseVoc->processFrequencyDomain(reals, imags, m_magnitude, m_thetaAngle, NULL);
 
     if (m_whiten)
         whiten();
@@ -108,9 +159,10 @@ double DetectionFunction::processFrequencyDomain(const double *reals, const doub
     return runDF();
 }
 
-void DetectionFunction::whiten() {
+template <typename T>
+void DetectionFunctionT<T>::whiten() {
     for (int i = 0; i < m_halfLength; ++i) {
-        double m = m_magnitude[i];
+        T m = m_magnitude[i];
         if (m < m_magPeaks[i]) {
             m = m + (m_magPeaks[i] - m) * m_whitenRelaxCoeff;
         }
@@ -121,8 +173,9 @@ void DetectionFunction::whiten() {
     }
 }
 
-double DetectionFunction::runDF() {
-    double retVal = 0;
+template <typename T>
+T DetectionFunctionT<T>::runDF() {
+    T retVal = 0;
 
     switch (m_DFType) {
         case DF_HFC:
@@ -153,23 +206,25 @@ double DetectionFunction::runDF() {
     return retVal;
 }
 
-double DetectionFunction::HFC(int length, double *src) {
-    double val = 0;
+template <typename T>
+T DetectionFunctionT<T>::HFC(int length, T *src) {
+    T val = 0;
     for (int i = 0; i < length; i++) {
         val += src[i] * (i + 1);
     }
     return val;
 }
 
-double DetectionFunction::specDiff(int length, double *src) {
-    double val = 0.0;
-    double temp = 0.0;
-    double diff = 0.0;
+template <typename T>
+T DetectionFunctionT<T>::specDiff(int length, T *src) {
+    T val = 0.0;
+    T temp = 0.0;
+    T diff = 0.0;
 
     for (int i = 0; i < length; i++) {
-        temp = fabs((src[i] * src[i]) - (m_magHistory[i] * m_magHistory[i]));
+        temp = std::fabs((src[i] * src[i]) - (m_magHistory[i] * m_magHistory[i]));
 
-        diff = sqrt(temp);
+        diff = std::sqrt(temp);
 
         // (See note in phaseDev below.)
 
@@ -181,12 +236,13 @@ double DetectionFunction::specDiff(int length, double *src) {
     return val;
 }
 
-double DetectionFunction::phaseDev(int length, double *srcPhase) {
-    double tmpPhase = 0;
-    double tmpVal = 0;
-    double val = 0;
+template <typename T>
+T DetectionFunctionT<T>::phaseDev(int length, T *srcPhase) {
+    T tmpPhase = 0;
+    T tmpVal = 0;
+    T val = 0;
 
-    double dev = 0;
+    T dev = 0;
 
     for (int i = 0; i < length; i++) {
         tmpPhase = (srcPhase[i] - 2 * m_phaseHistory[i] + m_phaseHistoryOld[i]);
@@ -200,7 +256,7 @@ double DetectionFunction::phaseDev(int length, double *srcPhase) {
         // music, so I'm removing it and counting the result always.
         // Same goes for the spectral difference measure above.
 
-        tmpVal = fabs(dev);
+        tmpVal = std::fabs(dev);
         val += tmpVal;
 
         m_phaseHistoryOld[i] = m_phaseHistory[i];
@@ -210,26 +266,28 @@ double DetectionFunction::phaseDev(int length, double *srcPhase) {
     return val;
 }
 
-double DetectionFunction::complexSD(int length, double *srcMagnitude, double *srcPhase) {
-    double val = 0;
-    double tmpPhase = 0;
-    double tmpReal = 0;
-    double tmpImag = 0;
+template <typename T>
+T DetectionFunctionT<T>::complexSD(int length, T *srcMagnitude, T *srcPhase) {
+    T val = 0;
+    T tmpPhase = 0;
+    T tmpReal = 0;
+    T tmpImag = 0;
 
-    double dev = 0;
-    ComplexData meas = ComplexData(0, 0);
-    ComplexData j = ComplexData(0, 1);
+    T dev = 0;
+    std::complex<T> meas = std::complex<T>(0, 0);
 
     for (int i = 0; i < length; i++) {
         tmpPhase = (srcPhase[i] - 2 * m_phaseHistory[i] + m_phaseHistoryOld[i]);
         dev = MathUtilities::princarg(tmpPhase);
 
-        meas = m_magHistory[i] - (srcMagnitude[i] * exp(j * dev));
+        // srcMagnitude[i] * exp(j * dev), without the complex exp (far
+        // slower than sin and cos in float)
+        meas = m_magHistory[i] - std::polar(srcMagnitude[i], dev);
 
         tmpReal = real(meas);
         tmpImag = imag(meas);
 
-        val += sqrt((tmpReal * tmpReal) + (tmpImag * tmpImag));
+        val += std::sqrt((tmpReal * tmpReal) + (tmpImag * tmpImag));
 
         m_phaseHistoryOld[i] = m_phaseHistory[i];
         m_phaseHistory[i] = srcPhase[i];
@@ -239,12 +297,71 @@ double DetectionFunction::complexSD(int length, double *srcMagnitude, double *sr
     return val;
 }
 
-double DetectionFunction::broadband(int length, double *src) {
-    double val = 0;
+template <typename T>
+T DetectionFunctionT<T>::complexSDRectangular(const T *reals, const T *imags) {
+    int i = 0;
+    T val = complexSDBins<SimdOps<T> >(i, reals, imags);
+    return val + complexSDBins<ScalarOps<T> >(i, reals, imags);
+}
+
+// complexSD on bins from i on, Ops::W at a time while they last. With
+// X the bin, u its unit phasor and u1, u2 those of the two frames
+// before, the polar form's m * exp(j * dev) is X * conj(u1)^2 * u2.
+template <typename T>
+template <typename Ops>
+T DetectionFunctionT<T>::complexSDBins(int &i, const T *reals, const T *imags) {
+    typedef typename Ops::V V;
+    const V tiny = Ops::set1(std::numeric_limits<T>::min());
+    const V one = Ops::set1(1);
+    const V two = Ops::set1(2);
+    V acc = Ops::set1(0);
+
+    for (; i + Ops::W <= m_halfLength; i += Ops::W) {
+        const V xr = Ops::load(reals + i);
+        const V xi = Ops::load(imags + i);
+        const V mag = Ops::sqrt(Ops::add(Ops::mul(xr, xr), Ops::mul(xi, xi)));
+
+        // u = X / |X|, or (1, 0) where |X| is zero (or subnormal),
+        // as atan2(0, 0) is 0
+        const V nz = Ops::step(tiny, mag);
+        const V z = Ops::sub(one, nz);
+        const V inv = Ops::div(nz, Ops::add(mag, z));
+        const V ur = Ops::add(Ops::mul(xr, inv), z);
+        const V ui = Ops::mul(xi, inv);
+
+        // p = conj(u1)^2 * u2
+        const V u1r = Ops::load(m_phasorRe + i);
+        const V u1i = Ops::load(m_phasorIm + i);
+        const V u2r = Ops::load(m_phasorReOld + i);
+        const V u2i = Ops::load(m_phasorImOld + i);
+        const V ar = Ops::sub(Ops::mul(u1r, u1r), Ops::mul(u1i, u1i));
+        const V ai = Ops::mul(two, Ops::mul(u1r, u1i));  // negated
+        const V pr = Ops::add(Ops::mul(ar, u2r), Ops::mul(ai, u2i));
+        const V pi = Ops::sub(Ops::mul(ar, u2i), Ops::mul(ai, u2r));
+
+        // |magHistory - X * p|
+        const V dr = Ops::sub(Ops::load(m_magHistory + i),
+                              Ops::sub(Ops::mul(xr, pr), Ops::mul(xi, pi)));
+        const V di = Ops::add(Ops::mul(xr, pi), Ops::mul(xi, pr));
+        acc = Ops::add(acc, Ops::sqrt(Ops::add(Ops::mul(dr, dr), Ops::mul(di, di))));
+
+        Ops::store(m_phasorReOld + i, u1r);
+        Ops::store(m_phasorImOld + i, u1i);
+        Ops::store(m_phasorRe + i, ur);
+        Ops::store(m_phasorIm + i, ui);
+        Ops::store(m_magHistory + i, mag);
+    }
+
+    return Ops::sum(acc);
+}
+
+template <typename T>
+T DetectionFunctionT<T>::broadband(int length, T *src) {
+    T val = 0;
     for (int i = 0; i < length; ++i) {
-        double sqrmag = src[i] * src[i];
+        T sqrmag = src[i] * src[i];
         if (m_magHistory[i] > 0.0) {
-            double diff = 10.0 * log10(sqrmag / m_magHistory[i]);
+            T diff = 10.0 * std::log10(sqrmag / m_magHistory[i]);
             if (diff > m_dbRise)
                 val = val + 1;
         }
@@ -253,6 +370,13 @@ double DetectionFunction::broadband(int length, double *src) {
     return val;
 }
 
-double *DetectionFunction::getSpectrumMagnitude() {
+template <typename T>
+T *DetectionFunctionT<T>::getSpectrumMagnitude() {
+    // The rectangular engine keeps the magnitudes only as its history
+    if (m_fft)
+        return m_magHistory;
     return m_magnitude;
 }
+
+template class DetectionFunctionT<double>;
+template class DetectionFunctionT<float>;
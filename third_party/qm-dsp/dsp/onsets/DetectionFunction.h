@@ -18,6 +18,7 @@
 
 #include "base/Window.h"
 #include "dsp/phasevocoder/PhaseVocoder.h"
+#include "dsp/transforms/FFT.h"
 #include "maths/MathAliases.h"
 #include "maths/MathUtilities.h"
 
@@ -37,11 +38,25 @@ struct DFConfig {
     double whiteningFloor;       // if < 0, a sensible default will be used
 };
 
-class DetectionFunction {
+/**
+ * Onset detection function computing in the scalar type T, double or
+ * float; DetectionFunction is the double-precision version. Time-domain
+ * frames are double either way and are converted as they are windowed.
+ *
+ * When built with QM_DSP_USE_SIMD_FFT (see kSimdFFTByDefault),
+ * DF_COMPLEXSD without adaptive whitening runs on a dedicated engine
+ * that works on the FFT output in rectangular form: it tracks each
+ * bin's unit phasor instead of its phase, so the phase deviation
+ * needs no atan2, princarg, sin or cos, and the bins are processed
+ * in vectors. Its results agree with the polar form to within
+ * rounding, which like the FFT's can move the odd beat.
+ */
+template <typename T>
+class DetectionFunctionT {
   public:
-    double* getSpectrumMagnitude();
-    DetectionFunction(DFConfig config);
-    virtual ~DetectionFunction();
+    T* getSpectrumMagnitude();
+    DetectionFunctionT(DFConfig config);
+    virtual ~DetectionFunctionT();
 
     /**
      * Process a single time-domain frame of audio, provided as
@@ -53,17 +68,20 @@ class DetectionFunction {
      * Process a single frequency-domain frame, provided as
      * frameLength/2+1 real and imaginary component values.
      */
-    double processFrequencyDomain(const double* reals, const double* imags);
+    double processFrequencyDomain(const T* reals, const T* imags);
 
   private:
     void whiten();
-    double runDF();
+    T runDF();
 
-    double HFC(int length, double* src);
-    double specDiff(int length, double* src);
-    double phaseDev(int length, double* srcPhase);
-    double complexSD(int length, double* srcMagnitude, double* srcPhase);
-    double broadband(int length, double* srcMagnitude);
+    T HFC(int length, T* src);
+    T specDiff(int length, T* src);
+    T phaseDev(int length, T* srcPhase);
+    T complexSD(int length, T* srcMagnitude, T* srcPhase);
+    T complexSDRectangular(const T* reals, const T* imags);
+    template <typename Ops>
+    T complexSDBins(int& i, const T* reals, const T* imags);
+    T broadband(int length, T* srcMagnitude);
 
   private:
     void initialise(DFConfig Config);
@@ -78,18 +96,28 @@ class DetectionFunction {
     double m_whitenRelaxCoeff;
     double m_whitenFloor;
 
-    double* m_magHistory;
-    double* m_phaseHistory;
-    double* m_phaseHistoryOld;
-    double* m_magPeaks;
-
-    double* m_windowed;    // Array for windowed analysis frame
-    double* m_magnitude;   // Magnitude of analysis frame ( frequency domain )
-    double* m_thetaAngle;  // Phase of analysis frame ( frequency domain )
-    double* m_unwrapped;   // Unwrapped phase of analysis frame
-
-    Window<double>* m_window;
-    PhaseVocoder* m_phaseVoc;  // Phase Vocoder
+    T* m_magHistory;
+    T* m_phaseHistory;
+    T* m_phaseHistoryOld;
+    T* m_magPeaks;
+
+    T* m_windowed;    // Array for windowed analysis frame
+    T* m_magnitude;   // Magnitude of analysis frame ( frequency domain )
+    T* m_thetaAngle;  // Phase of analysis frame ( frequency domain )
+
+    Window<T>* m_window;
+    PhaseVocoderT<T>* m_phaseVoc;  // Phase Vocoder, unless rectangular
+
+    // Rectangular complexSD engine (NULL otherwise)
+    FFTRealT<T>* m_fft;
+    T* m_real;  // Spectrum of analysis frame
+    T* m_imag;
+    T* m_phasorRe;  // Unit phasors of the previous frame
+    T* m_phasorIm;
+    T* m_phasorReOld;  // Unit phasors of the frame before
+    T* m_phasorImOld;
 };
 
+typedef DetectionFunctionT<double> DetectionFunction;
+
 #endif
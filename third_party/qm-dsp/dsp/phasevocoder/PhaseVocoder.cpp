@@ -18,20 +18,21 @@
 #include <math.h>
 
 #include <cassert>
+#include <cmath>
 #include <iostream>
 
-#include "dsp/transforms/FFT.h"
 #include "maths/MathUtilities.h"
 using std::cerr;
 using std::endl;
 
-PhaseVocoder::PhaseVocoder(int n, int hop) : m_n(n), m_hop(hop) {
-    m_fft = new FFTReal(m_n);
-    m_time = new double[m_n];
-    m_real = new double[m_n];
-    m_imag = new double[m_n];
-    m_phase = new double[m_n / 2 + 1];
-    m_unwrapped = new double[m_n / 2 + 1];
+template <typename T>
+PhaseVocoderT<T>::PhaseVocoderT(int n, int hop) : m_n(n), m_hop(hop) {
+    m_fft = new FFTRealT<T>(m_n);
+    m_time = new T[m_n];
+    m_real = new T[m_n];
+    m_imag = new T[m_n];
+    m_phase = new T[m_n / 2 + 1];
+    m_unwrapped = new T[m_n / 2 + 1];
 
     for (int i = 0; i < m_n / 2 + 1; ++i) {
         m_phase[i] = 0.0;
@@ -41,7 +42,8 @@ PhaseVocoder::PhaseVocoder(int n, int hop) : m_n(n), m_hop(hop) {
     reset();
 }
 
-PhaseVocoder::~PhaseVocoder() {
+template <typename T>
+PhaseVocoderT<T>::~PhaseVocoderT() {
     delete[] m_unwrapped;
     delete[] m_phase;
     delete[] m_real;
@@ -50,17 +52,18 @@ PhaseVocoder::~PhaseVocoder() {
     delete m_fft;
 }
 
-void PhaseVocoder::FFTShift(double *src) {
+template <typename T>
+void PhaseVocoderT<T>::FFTShift(T *src) {
     const int hs = m_n / 2;
     for (int i = 0; i < hs; ++i) {
-        double tmp = src[i];
+        T tmp = src[i];
         src[i] = src[i + hs];
         src[i + hs] = tmp;
     }
 }
 
-void PhaseVocoder::processTimeDomain(const double *src, double *mag, double *theta,
-                                     double *unwrapped) {
+template <typename T>
+void PhaseVocoderT<T>::processTimeDomain(const T *src, T *mag, T *theta, T *unwrapped) {
     for (int i = 0; i < m_n; ++i) {
         m_time[i] = src[i];
     }
@@ -68,21 +71,25 @@ void PhaseVocoder::processTimeDomain(const double *src, double *mag, double *the
     m_fft->forward(m_time, m_real, m_imag);
     getMagnitudes(mag);
     getPhases(theta);
-    unwrapPhases(theta, unwrapped);
+    if (unwrapped)
+        unwrapPhases(theta, unwrapped);
 }
 
-void PhaseVocoder::processFrequencyDomain(const double *reals, const double *imags, double *mag,
-                                          double *theta, double *unwrapped) {
+template <typename T>
+void PhaseVocoderT<T>::processFrequencyDomain(const T *reals, const T *imags, T *mag, T *theta,
+                                              T *unwrapped) {
     for (int i = 0; i < m_n / 2 + 1; ++i) {
         m_real[i] = reals[i];
         m_imag[i] = imags[i];
     }
     getMagnitudes(mag);
     getPhases(theta);
-    unwrapPhases(theta, unwrapped);
+    if (unwrapped)
+        unwrapPhases(theta, unwrapped);
 }
 
-void PhaseVocoder::reset() {
+template <typename T>
+void PhaseVocoderT<T>::reset() {
     for (int i = 0; i < m_n / 2 + 1; ++i) {
         // m_phase stores the "previous" phase, so set to one step
         // behind so that a signal with initial phase at zero matches
@@ -94,19 +101,22 @@ void PhaseVocoder::reset() {
     }
 }
 
-void PhaseVocoder::getMagnitudes(double *mag) {
+template <typename T>
+void PhaseVocoderT<T>::getMagnitudes(T *mag) {
     for (int i = 0; i < m_n / 2 + 1; i++) {
-        mag[i] = sqrt(m_real[i] * m_real[i] + m_imag[i] * m_imag[i]);
+        mag[i] = std::sqrt(m_real[i] * m_real[i] + m_imag[i] * m_imag[i]);
     }
 }
 
-void PhaseVocoder::getPhases(double *theta) {
+template <typename T>
+void PhaseVocoderT<T>::getPhases(T *theta) {
     for (int i = 0; i < m_n / 2 + 1; i++) {
-        theta[i] = atan2(m_imag[i], m_real[i]);
+        theta[i] = std::atan2(m_imag[i], m_real[i]);
     }
 }
 
-void PhaseVocoder::unwrapPhases(double *theta, double *unwrapped) {
+template <typename T>
+void PhaseVocoderT<T>::unwrapPhases(T *theta, T *unwrapped) {
     for (int i = 0; i < m_n / 2 + 1; ++i) {
         double omega = (2 * M_PI * m_hop * i) / m_n;
         double expected = m_phase[i] + omega;
@@ -118,3 +128,6 @@ void PhaseVocoder::unwrapPhases(double *theta, double *unwrapped) {
         m_unwrapped[i] = unwrapped[i];
     }
 }
+
+template class PhaseVocoderT<double>;
+template class PhaseVocoderT<float>;
@@ -16,12 +16,17 @@
 #ifndef QM_DSP_PHASEVOCODER_H
 #define QM_DSP_PHASEVOCODER_H
 
-class FFTReal;
+#include "dsp/transforms/FFT.h"
 
-class PhaseVocoder {
+/**
+ * Phase vocoder computing in the scalar type T, double or float;
+ * PhaseVocoder is the double-precision version.
+ */
+template <typename T>
+class PhaseVocoderT {
   public:
-    PhaseVocoder(int size, int hop);
-    virtual ~PhaseVocoder();
+    PhaseVocoderT(int size, int hop);
+    virtual ~PhaseVocoderT();
 
     /**
      * Given one frame of time-domain samples, FFT and return the
@@ -31,11 +36,12 @@ class PhaseVocoder {
      * as passed to the PhaseVocoder constructor), and should have
      * been windowed as necessary by the caller (but not fft-shifted).
      *
-     * mag, phase, and unwrapped must each be non-NULL and point to
-     * enough space for size/2 + 1 values. The redundant conjugate
-     * half of the output is not returned.
+     * mag and phase must each be non-NULL and point to enough space
+     * for size/2 + 1 values. The redundant conjugate half of the
+     * output is not returned. unwrapped may be NULL if the caller
+     * never needs unwrapped phases, which are then not computed.
      */
-    void processTimeDomain(const double *src, double *mag, double *phase, double *unwrapped);
+    void processTimeDomain(const T *src, T *mag, T *phase, T *unwrapped);
 
     /**
      * Given one frame of frequency-domain samples, return the
@@ -45,11 +51,10 @@ class PhaseVocoder {
      * is the frame size value as passed to the PhaseVocoder
      * constructor).
      *
-     * mag, phase, and unwrapped must each be non-NULL and point to
-     * enough space for size/2+1 values.
+     * mag and phase must each be non-NULL and point to enough space
+     * for size/2+1 values; unwrapped may be NULL, as above.
      */
-    void processFrequencyDomain(const double *reals, const double *imags, double *mag,
-                                double *phase, double *unwrapped);
+    void processFrequencyDomain(const T *reals, const T *imags, T *mag, T *phase, T *unwrapped);
 
     /**
      * Reset the stored phases to zero. Note that this may be
@@ -60,19 +65,21 @@ class PhaseVocoder {
     void reset();
 
   protected:
-    void FFTShift(double *src);
-    void getMagnitudes(double *mag);
-    void getPhases(double *theta);
-    void unwrapPhases(double *theta, double *unwrapped);
+    void FFTShift(T *src);
+    void getMagnitudes(T *mag);
+    void getPhases(T *theta);
+    void unwrapPhases(T *theta, T *unwrapped);
 
     int m_n;
     int m_hop;
-    FFTReal *m_fft;
-    double *m_time;
-    double *m_imag;
-    double *m_real;
-    double *m_phase;
-    double *m_unwrapped;
+    FFTRealT<T> *m_fft;
+    T *m_time;
+    T *m_imag;
+    T *m_real;
+    T *m_phase;
+    T *m_unwrapped;
 };
 
+typedef PhaseVocoderT<double> PhaseVocoder;
+
 #endif
@@ -142,6 +142,9 @@ void Decimator::resetFilter() {
     Input = Output = 0;
 
     o1 = o2 = o3 = o4 = o5 = o6 = o7 = 0;
+
+    m_streamPhase = 0;
+    m_streamHeld = 0;
 }
 
 void Decimator::doAntiAlias(const double *src, double *dst, int length) {
@@ -213,3 +216,31 @@ void Decimator::process(const float *src, float *dst) {
         dst[idx++] = decBuffer[m_decFactor * i];
     }
 }
+
+int Decimator::processStream(const double *src, int length, double *dst) {
+    int written = 0;
+
+    for (int i = 0; i < length; i++) {
+        Input = src[i];
+
+        Output = Input * b[0] + o1;
+
+        o1 = Input * b[1] - Output * a[1] + o2;
+        o2 = Input * b[2] - Output * a[2] + o3;
+        o3 = Input * b[3] - Output * a[3] + o4;
+        o4 = Input * b[4] - Output * a[4] + o5;
+        o5 = Input * b[5] - Output * a[5] + o6;
+        o6 = Input * b[6] - Output * a[6] + o7;
+        o7 = Input * b[7] - Output * a[7];
+
+        if (m_streamPhase == 0) {
+            m_streamHeld = Output;
+        }
+        if (++m_streamPhase == m_decFactor) {
+            dst[written++] = m_streamHeld;
+            m_streamPhase = 0;
+        }
+    }
+
+    return written;
+}
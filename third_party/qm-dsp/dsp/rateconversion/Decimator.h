@@ -52,6 +52,17 @@ class Decimator {
      */
     void process(const float* src, float* dst);
 
+    /**
+     * Filter length samples of a continuous stream, carrying the
+     * filter state over from the previous call, and write one sample
+     * to dst for every decFactor input samples. A sample is written
+     * once the last input of its group has arrived, so the output
+     * matches process() over consecutive blocks regardless of how the
+     * stream is split. Returns the number of samples written, at most
+     * (length + decFactor - 1) / decFactor.
+     */
+    int processStream(const double* src, int length, double* dst);
+
     int getFactor() const { return m_decFactor; }
     static int getHighestSupportedFactor() { return 8; }
 
@@ -72,6 +83,10 @@ class Decimator {
 
     double o1, o2, o3, o4, o5, o6, o7;
 
+    // processStream(): position within the current group and its output
+    int m_streamPhase;
+    double m_streamHeld;
+
     double a[9];
     double b[9];
 
@@ -15,10 +15,19 @@
 
 #include "TempoTrackV2.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
+
+#include "base/ThreadPool.h"
+#include "dsp/transforms/FFT.h"
 #include "maths/MathUtilities.h"
 
 using std::vector;
@@ -139,99 +148,110 @@ void TempoTrackV2::calculateBeatPeriod(const vector<double> &df, vector<int> &be
 
     int df_len = int(df.size());
 
-    // Matrix to store output of comb filter bank
-    d_mat_t rcfmat;
-    rcfmat.reserve(df_len / hopsize + 1);
-    d_vec_t dfframe(winlen);
-    d_vec_t rcf(wv_len);
-
-    // Loop over the onset detection function half a window padding on both ends
-    for (int i = -winlen / 2; i < df_len - winlen / 2; i += hopsize) {
-        int k = 0;
-        int l = winlen;
-
-        if (i < 0) {
-            k = -i;
-            std::fill(dfframe.begin(), dfframe.begin() + k, 0.0);
-        }
+    // One frame per hop, starting half a window before the onset
+    // detection function and zero-padded at both ends
+    const int numFrames = df_len > 0 ? (df_len + hopsize - 1) / hopsize : 0;
+
+    // The autocorrelation of each frame is independent of the others,
+    // so it is computed for all frames in parallel, each into its own
+    // row of acfmat. The comb filtering that follows carries rcf over
+    // from one frame to the next and stays serial; it is the cheap
+    // part. Every value is computed exactly as in the serial loop.
+    const int framesPerTask = 32;
+    d_vec_t acfmat(std::size_t(numFrames) * winlen);
+    ThreadPool::shared().parallelFor(
+        (numFrames + framesPerTask - 1) / framesPerTask, [&](int task) {
+            ResonatorCombFilterBank bank(winlen, wv);
+            d_vec_t dfframe(winlen);
+            const int end = std::min(numFrames, (task + 1) * framesPerTask);
+            for (int f = task * framesPerTask; f < end; f++) {
+                int i = f * hopsize - winlen / 2;
+                int k = 0;
+                int l = winlen;
+
+                if (i < 0) {
+                    k = -i;
+                    std::fill(dfframe.begin(), dfframe.begin() + k, 0.0);
+                }
 
-        if (i + l > df_len) {
-            l = df_len - i;
-            std::fill(dfframe.begin() + l, dfframe.end(), 0.0);
-        }
+                if (i + l > df_len) {
+                    l = df_len - i;
+                    std::fill(dfframe.begin() + l, dfframe.end(), 0.0);
+                }
 
-        std::copy(df.begin() + i + k, df.begin() + i + l, dfframe.begin() + k);
+                std::copy(df.begin() + i + k, df.begin() + i + l, dfframe.begin() + k);
 
-        // Apply the resonator comb filter (RCF) bank to the window
-        // The result is a vector of filter responses for different periods.
-        get_rcf(dfframe, wv, rcf);
+                bank.autocorrelate(dfframe, &acfmat[std::size_t(f) * winlen]);
+            }
+        });
 
-        // Append the result to rcfmat as a new column
-        rcfmat.push_back(d_vec_t());
-        for (int j = 0; j < wv_len; j++) {
-            rcfmat.back().push_back(rcf[j]);
-        }
+    // Apply the resonator comb filter (RCF) bank to each frame; the
+    // result is a vector of filter responses for different periods,
+    // stored as a column of rcfmat
+    d_mat_t rcfmat(numFrames, d_vec_t(wv_len));
+    d_vec_t rcf(wv_len);
+    ResonatorCombFilterBank rcfBank(winlen, wv);
+    for (int f = 0; f < numFrames; f++) {
+        rcfBank.filter(&acfmat[std::size_t(f) * winlen], rcf);
+        rcfmat[f] = rcf;
     }
 
     // now call viterbi decoding function
     viterbi_decode(rcfmat, wv, beat_period);
 }
 
-void TempoTrackV2::get_rcf(const d_vec_t &dfframe_in, const d_vec_t &wv, d_vec_t &rcf) {
-    // calculate autocorrelation function
-    // then rcf
-    // just hard code for now... don't really need separate functions to do this
-
-    // make acf
-
-    d_vec_t dfframe(dfframe_in);
-
-    MathUtilities::adaptiveThreshold(dfframe);
-
-    int dfframe_len = int(dfframe.size());
-    int rcf_len = int(rcf.size());
-
-    d_vec_t acf(dfframe_len);
-
-    for (int lag = 0; lag < dfframe_len; lag++) {
-        double sum = 0.;
-        double tmp = 0.;
+namespace {
+
+// Max-product step of the Viterbi decoding over columns [begin, end):
+// the largest delta[i] * trans[i] and the first i reaching it, starting
+// from maxval = 0 and ind = 0 like get_max_val() / get_max_ind().
+void maxProduct(const double *delta, const double *trans, int begin, int end, double &maxval,
+                int &ind) {
+    double m = 0.;
+    int i = begin;
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128d vmax = _mm_setzero_pd();
+    for (; i + 2 <= end; i += 2) {
+        vmax = _mm_max_pd(vmax, _mm_mul_pd(_mm_loadu_pd(delta + i), _mm_loadu_pd(trans + i)));
+    }
+    m = std::max(_mm_cvtsd_f64(vmax), _mm_cvtsd_f64(_mm_unpackhi_pd(vmax, vmax)));
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    float64x2_t vmax = vdupq_n_f64(0.);
+    for (; i + 2 <= end; i += 2) {
+        vmax = vmaxq_f64(vmax, vmulq_f64(vld1q_f64(delta + i), vld1q_f64(trans + i)));
+    }
+    m = vmaxvq_f64(vmax);
+#endif
+    for (; i < end; i++) {
+        m = std::max(m, delta[i] * trans[i]);
+    }
 
-        for (int n = 0; n < (dfframe_len - lag); n++) {
-            tmp = dfframe[n] * dfframe[n + lag];
-            sum += tmp;
+    maxval = m;
+    ind = 0;
+    if (m > 0.) {
+        for (i = begin; i < end && delta[i] * trans[i] != m; i++) {
         }
-        acf[lag] = double(sum / (dfframe_len - lag));
+        ind = i;
     }
-
-    // now apply comb filtering
-    int numelem = 4;
-
-    for (int i = 2; i < rcf_len; i++) {       // max beat period
-        for (int a = 1; a <= numelem; a++) {  // number of comb elements
-            for (int b = 1 - a; b <= a - 1;
-                 b++) {  // general state using normalisation of comb elements
-                rcf[i - 1] += (acf[(a * i + b) - 1] * wv[i - 1]) /
-                              (2. * a - 1.);  // calculate value for comb filter row
+    if (ind == end) {
+        // Where products are evaluated in excess precision (x87), their
+        // recomputation need not reproduce m exactly; take the max and
+        // its index together instead.
+        m = 0.;
+        ind = 0;
+        for (i = begin; i < end; i++) {
+            const double p = delta[i] * trans[i];
+            if (p > m) {
+                m = p;
+                ind = i;
             }
         }
-    }
-
-    // apply adaptive threshold to rcf
-    MathUtilities::adaptiveThreshold(rcf);
-
-    double rcfsum = 0.;
-    for (int i = 0; i < rcf_len; i++) {
-        rcf[i] += EPS;
-        rcfsum += rcf[i];
-    }
-
-    // normalise rcf to sum to unity
-    for (int i = 0; i < rcf_len; i++) {
-        rcf[i] /= (rcfsum + EPS);
+        maxval = m;
     }
 }
 
+}  // namespace
+
 void TempoTrackV2::viterbi_decode(const d_mat_t &rcfmat, const d_vec_t &wv, i_vec_t &beat_period) {
     // following Kevin Murphy's Viterbi decoding to get best path of
     // beat periods through rfcmat
@@ -239,76 +259,112 @@ void TempoTrackV2::viterbi_decode(const d_mat_t &rcfmat, const d_vec_t &wv, i_ve
     if (rcfmat.size() < 2)
         return;  // can't do anything at all meaningful
 
-    const std::size_t T = rcfmat.size();
-    const std::size_t Q = rcfmat[0].size();
+    const int T = int(rcfmat.size());
+    const int Q = int(rcfmat[0].size());
+
+    // don't want really short beat periods, or really long ones: only
+    // states in [lo, hi) can be reached
+    const int lo = 20;
+    const int hi = std::max(lo, Q - 20);
 
-    auto tmat = d_mat_t(Q, d_vec_t(Q));
+    // Transition matrix, row-major: tmat[j * Q + i] is the weight of a
+    // move from period i to period j.
+    d_vec_t tmat(Q * Q);
     // variance of Gaussians in transition matrix
     // formed of Gaussians on diagonal - implies slow tempo change
     double sigma = 8.;
-    // don't want really short beat periods, or really long ones
-    for (std::size_t i = 20; i < Q - 20; i++) {
-        for (int j = 20; j < Q - 20; j++) {
+    for (int i = lo; i < hi; i++) {
+        for (int j = lo; j < hi; j++) {
             double mu = double(i);
-            tmat[i][j] = exp((-1. * pow((j - mu), 2.)) / (2. * pow(sigma, 2.)));
+            tmat[i * Q + j] = exp((-1. * pow((j - mu), 2.)) / (2. * pow(sigma, 2.)));
+        }
+    }
+
+    // The Gaussian is tiny beyond a few sigma, so each state first only
+    // looks at predecessors within kBand of itself. If the best of those
+    // beats every possible product outside the band (the largest
+    // previous delta times the largest weight outside the band), it is
+    // the overall maximum and comes first; otherwise the whole row is
+    // scanned. Either way the result is the one a full scan gives.
+    const int kBand = int(4 * sigma);
+    i_vec_t bandBegin(Q), bandEnd(Q);
+    d_vec_t outsideMax(Q);
+    for (int j = lo; j < hi; j++) {
+        bandBegin[j] = std::max(lo, j - kBand);
+        bandEnd[j] = std::min(hi, j + kBand + 1);
+        for (int i = lo; i < hi; i++) {
+            if (i < bandBegin[j] || i >= bandEnd[j]) {
+                outsideMax[j] = std::max(outsideMax[j], tmat[j * Q + i]);
+            }
         }
     }
 
     // parameters for Viterbi decoding... this part is taken from
     // Murphy's matlab
 
-    auto delta = d_mat_t(T, d_vec_t(Q));
-    auto psi = i_mat_t(T, i_vec_t(Q));
+    // Only the previous delta column is needed; psi is kept for the
+    // backtrace, row-major with one row of Q per time step.
+    d_vec_t prevDelta(Q);
+    d_vec_t delta(Q);
+    i_vec_t psi(std::size_t(T) * Q);
 
     // initialize first column of delta
-    for (std::size_t j = 0; j < Q; j++) {
-        delta[0][j] = wv[j] * rcfmat[0][j];
+    for (int j = 0; j < Q; j++) {
+        delta[j] = wv[j] * rcfmat[0][j];
     }
 
     double deltasum = 0.;
-    for (std::size_t i = 0; i < Q; i++) {
-        deltasum += delta[0][i];
+    for (int i = 0; i < Q; i++) {
+        deltasum += delta[i];
     }
-    for (std::size_t i = 0; i < Q; i++) {
-        delta[0][i] /= (deltasum + EPS);
+    for (int i = 0; i < Q; i++) {
+        delta[i] /= (deltasum + EPS);
     }
 
-    for (std::size_t t = 1; t < T; t++) {
-        d_vec_t tmp_vec(Q);
-
-        for (std::size_t j = 0; j < Q; j++) {
-            for (std::size_t i = 0; i < Q; i++) {
-                tmp_vec[i] = delta[t - 1][i] * tmat[j][i];
+    for (int t = 1; t < T; t++) {
+        delta.swap(prevDelta);
+        const double prevMax = get_max_val(prevDelta);
+        int *psiRow = &psi[std::size_t(t) * Q];
+
+        for (int j = 0; j < Q; j++) {
+            double maxval = 0.;
+            int ind = 0;
+            if (j >= lo && j < hi) {
+                const double *trans = &tmat[j * Q];
+                maxProduct(prevDelta.data(), trans, bandBegin[j], bandEnd[j], maxval, ind);
+                if (!(maxval > prevMax * outsideMax[j])) {
+                    maxProduct(prevDelta.data(), trans, lo, hi, maxval, ind);
+                }
             }
 
-            delta[t][j] = get_max_val(tmp_vec);
+            delta[j] = maxval;
 
-            psi[t][j] = get_max_ind(tmp_vec);
+            psiRow[j] = ind;
 
-            delta[t][j] *= rcfmat[t][j];
+            delta[j] *= rcfmat[t][j];
         }
 
         // normalise current delta column
         double deltasum = 0.;
-        for (std::size_t i = 0; i < Q; i++) {
-            deltasum += delta[t][i];
+        for (int i = 0; i < Q; i++) {
+            deltasum += delta[i];
         }
-        for (std::size_t i = 0; i < Q; i++) {
-            delta[t][i] /= (deltasum + EPS);
+        for (int i = 0; i < Q; i++) {
+            delta[i] /= (deltasum + EPS);
         }
     }
 
     i_vec_t &bestpath = beat_period;
     // find starting point - best beat period for "last" frame
-    bestpath[T - 1] = get_max_ind(delta[T - 1]);
+    bestpath[T - 1] = get_max_ind(delta);
 
     // backtrace through index of maximum values in psi
     for (int t = T - 2; t > 0; t--) {
-        bestpath[t] = psi[t + 1][bestpath[t + 1]];
+        bestpath[t] = psi[std::size_t(t + 1) * Q + bestpath[t + 1]];
     }
 
     // weird but necessary hack -- couldn't get above loop to terminate at t >= 0
-    bestpath[0] = psi[1][bestpath[1]];
+    bestpath[0] = psi[std::size_t(1) * Q + bestpath[1]];
 }
 
 double TempoTrackV2::get_max_val(const d_vec_t &df) {
@@ -465,3 +521,134 @@ void TempoTrackV2::calculateBeats(const vector<double> &df, const vector<int> &b
         beats.push_back(double(ibeats[ibeats.size() - i - 1]));
     }
 }
+
+ResonatorCombFilterBank::ResonatorCombFilterBank(int frameLength, const vector<double> &wv)
+    : m_frameLength(frameLength),
+      m_fftLength(MathUtilities::nextPowerOfTwo(2 * frameLength)),
+      m_wv(wv),
+      m_fft(new FFTReal(m_fftLength)),
+      m_frame(m_fftLength),
+      m_fftRe(m_fftLength),
+      m_fftIm(m_fftLength),
+      m_acf(m_fftLength) {
+    // Same rows, terms and term order as processDirect(), with the
+    // period weight and comb element normalisation folded together.
+    const int rcf_len = int(wv.size());
+    const int numelem = 4;
+    m_rowStart.assign(rcf_len + 1, 0);
+    for (int i = 2; i < rcf_len; i++) {
+        m_rowStart[i - 1] = int(m_column.size());
+        for (int a = 1; a <= numelem; a++) {
+            for (int b = 1 - a; b <= a - 1; b++) {
+                m_column.push_back((a * i + b) - 1);
+                m_weight.push_back(wv[i - 1] / (2. * a - 1.));
+            }
+        }
+    }
+    m_rowStart[rcf_len - 1] = int(m_column.size());
+    m_rowStart[rcf_len] = int(m_column.size());
+}
+
+ResonatorCombFilterBank::~ResonatorCombFilterBank() {
+    delete m_fft;
+}
+
+void ResonatorCombFilterBank::process(const vector<double> &dfframe, vector<double> &rcf) {
+    autocorrelate(dfframe, m_acf.data());
+    filter(m_acf.data(), rcf);
+}
+
+void ResonatorCombFilterBank::autocorrelate(const vector<double> &dfframe, double *acf) {
+    m_frame.assign(dfframe.begin(), dfframe.end());
+    MathUtilities::adaptiveThreshold(m_frame);
+
+    // Autocorrelation as the inverse transform of the power spectrum;
+    // padding to twice the frame length keeps it linear, not circular.
+    m_frame.resize(m_fftLength, 0.0);
+    m_fft->forward(m_frame.data(), m_fftRe.data(), m_fftIm.data());
+    for (int k = 0; k <= m_fftLength / 2; k++) {
+        m_fftRe[k] = m_fftRe[k] * m_fftRe[k] + m_fftIm[k] * m_fftIm[k];
+        m_fftIm[k] = 0.;
+    }
+    m_fft->inverse(m_fftRe.data(), m_fftIm.data(), m_acf.data());
+    for (int lag = 0; lag < m_frameLength; lag++) {
+        acf[lag] = m_acf[lag] / (m_frameLength - lag);
+    }
+}
+
+void ResonatorCombFilterBank::filter(const double *acf, vector<double> &rcf) const {
+    const int rcf_len = int(rcf.size());
+    const int *column = m_column.data();
+    const double *weight = m_weight.data();
+    for (int r = 0; r < rcf_len; r++) {
+        double sum = rcf[r];
+        for (int k = m_rowStart[r]; k < m_rowStart[r + 1]; k++) {
+            sum += acf[column[k]] * weight[k];
+        }
+        rcf[r] = sum;
+    }
+
+    finish(rcf);
+}
+
+void ResonatorCombFilterBank::processDirect(const vector<double> &dfframe_in,
+                                            vector<double> &rcf) const {
+    // calculate autocorrelation function
+    // then rcf
+    // just hard code for now... don't really need separate functions to do this
+
+    // make acf
+
+    vector<double> dfframe(dfframe_in);
+
+    MathUtilities::adaptiveThreshold(dfframe);
+
+    int dfframe_len = int(dfframe.size());
+    int rcf_len = int(rcf.size());
+
+    vector<double> acf(dfframe_len);
+
+    for (int lag = 0; lag < dfframe_len; lag++) {
+        double sum = 0.;
+        double tmp = 0.;
+
+        for (int n = 0; n < (dfframe_len - lag); n++) {
+            tmp = dfframe[n] * dfframe[n + lag];
+            sum += tmp;
+        }
+        acf[lag] = double(sum / (dfframe_len - lag));
+    }
+
+    // now apply comb filtering
+    int numelem = 4;
+
+    for (int i = 2; i < rcf_len; i++) {       // max beat period
+        for (int a = 1; a <= numelem; a++) {  // number of comb elements
+            for (int b = 1 - a; b <= a - 1;
+                 b++) {  // general state using normalisation of comb elements
+                rcf[i - 1] += (acf[(a * i + b) - 1] * m_wv[i - 1]) /
+                              (2. * a - 1.);  // calculate value for comb filter row
+            }
+        }
+    }
+
+    finish(rcf);
+}
+
+void ResonatorCombFilterBank::finish(vector<double> &rcf) const {
+    int rcf_len = int(rcf.size());
+
+    // apply adaptive threshold to rcf
+    MathUtilities::adaptiveThreshold(rcf);
+
+    double rcfsum = 0.;
+    for (int i = 0; i < rcf_len; i++) {
+        rcf[i] += EPS;
+        rcfsum += rcf[i];
+    }
+
+    // normalise rcf to sum to unity
+    for (int i = 0; i < rcf_len; i++) {
+        rcf[i] /= (rcfsum + EPS);
+    }
+}
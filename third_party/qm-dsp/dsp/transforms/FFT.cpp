@@ -10,24 +10,96 @@
 
 #include <cmath>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 
+#include "SimdFFT.h"
+#include "base/TableCache.h"
 #include "ext/kissfft/kiss_fft.h"
+#include "ext/kissfft/kiss_fftf.h"
 #include "ext/kissfft/tools/kiss_fftr.h"
 #include "maths/MathUtilities.h"
 
+namespace {
+
+// Forward and inverse kissfft plans for one size, shared process-wide.
+// kiss_fft() only reads its plan, so complex plans are used directly;
+// kiss_fftr() keeps scratch data in its config, so each FFTReal wraps
+// the shared real plans with kiss_fftr_alloc_shared().
+struct ComplexPlans {
+    explicit ComplexPlans(int n)
+        : forward(kiss_fft_alloc(n, 0, NULL, NULL)), inverse(kiss_fft_alloc(n, 1, NULL, NULL)) {}
+    ~ComplexPlans() {
+        kiss_fft_free(forward);
+        kiss_fft_free(inverse);
+    }
+    ComplexPlans(const ComplexPlans &) = delete;
+    ComplexPlans &operator=(const ComplexPlans &) = delete;
+
+    kiss_fft_cfg forward;
+    kiss_fft_cfg inverse;
+};
+
+// The kissfft real transform in one scalar type: the regular build for
+// double, the renamed single-precision build (kiss_fftf.h) for float.
+template <typename T>
+struct KissReal;
+
+template <>
+struct KissReal<double> {
+    typedef kiss_fft_cpx Cpx;
+    typedef kiss_fftr_cfg Cfg;
+    static Cfg alloc(int n, int inverse) { return kiss_fftr_alloc(n, inverse, NULL, NULL); }
+    static Cfg allocShared(Cfg shared) { return kiss_fftr_alloc_shared(shared); }
+    static void destroy(Cfg cfg) { kiss_fftr_free(cfg); }
+    static void forward(Cfg cfg, const double *in, Cpx *out) { kiss_fftr(cfg, in, out); }
+    static void inverse(Cfg cfg, const Cpx *in, double *out) { kiss_fftri(cfg, in, out); }
+};
+
+template <>
+struct KissReal<float> {
+    typedef kiss_fftf_cpx Cpx;
+    typedef kiss_fftrf_cfg Cfg;
+    static Cfg alloc(int n, int inverse) { return kiss_fftrf_alloc(n, inverse, NULL, NULL); }
+    static Cfg allocShared(Cfg shared) { return kiss_fftrf_alloc_shared(shared); }
+    static void destroy(Cfg cfg) { kiss_fftrf_free(cfg); }
+    static void forward(Cfg cfg, const float *in, Cpx *out) { kiss_fftrf(cfg, in, out); }
+    static void inverse(Cfg cfg, const Cpx *in, float *out) { kiss_fftrif(cfg, in, out); }
+};
+
+template <typename T>
+struct RealPlans {
+    typedef KissReal<T> Kiss;
+
+    explicit RealPlans(int n) : forward(Kiss::alloc(n, 0)), inverse(Kiss::alloc(n, 1)) {}
+    ~RealPlans() {
+        Kiss::destroy(forward);
+        Kiss::destroy(inverse);
+    }
+    RealPlans(const RealPlans &) = delete;
+    RealPlans &operator=(const RealPlans &) = delete;
+
+    typename Kiss::Cfg forward;
+    typename Kiss::Cfg inverse;
+};
+
+template <typename Plans>
+std::shared_ptr<const Plans> sharedPlans(int n) {
+    return TableCache<int, Plans>::get(n, [n]() { return std::make_shared<const Plans>(n); });
+}
+
+}  // namespace
+
 class FFT::D {
   public:
-    D(int n) : m_n(n) {
-        m_planf = kiss_fft_alloc(m_n, 0, NULL, NULL);
-        m_plani = kiss_fft_alloc(m_n, 1, NULL, NULL);
+    D(int n) : m_n(n), m_plans(sharedPlans<ComplexPlans>(n)) {
+        m_planf = m_plans->forward;
+        m_plani = m_plans->inverse;
         m_kin = new kiss_fft_cpx[m_n];
         m_kout = new kiss_fft_cpx[m_n];
     }
 
     ~D() {
-        kiss_fft_free(m_planf);
-        kiss_fft_free(m_plani);
         delete[] m_kin;
         delete[] m_kout;
     }
@@ -60,6 +132,7 @@ class FFT::D {
 
   private:
     int m_n;
+    std::shared_ptr<const ComplexPlans> m_plans;
     kiss_fft_cfg m_planf;
     kiss_fft_cfg m_plani;
     kiss_fft_cpx *m_kin;
@@ -77,30 +150,98 @@ void FFT::process(bool inverse, const double *p_lpRealIn, const double *p_lpImag
     m_d->process(inverse, p_lpRealIn, p_lpImagIn, p_lpRealOut, p_lpImagOut);
 }
 
-class FFTReal::D {
+namespace {
+
+// A real FFT implementation FFTReal can run on: forward() writes the
+// n/2+1 non-redundant bins, inverse() reads them and is unscaled.
+template <typename T>
+class RealBackend {
   public:
-    D(int n) : m_n(n) {
-        if (n % 2) {
-            throw std::invalid_argument("nsamples must be even in FFTReal constructor");
-        }
-        m_planf = kiss_fftr_alloc(m_n, 0, NULL, NULL);
-        m_plani = kiss_fftr_alloc(m_n, 1, NULL, NULL);
-        m_c = new kiss_fft_cpx[m_n];
+    virtual ~RealBackend() {}
+    virtual void forward(const T *ri, T *ro, T *io) = 0;
+    virtual void inverse(const T *ri, const T *ii, T *ro) = 0;
+};
+
+template <typename T>
+class KissBackend : public RealBackend<T> {
+  public:
+    KissBackend(int n) : m_n(n), m_plans(sharedPlans<RealPlans<T> >(n)) {
+        m_planf = Kiss::allocShared(m_plans->forward);
+        m_plani = Kiss::allocShared(m_plans->inverse);
+        m_c = new typename Kiss::Cpx[m_n];
     }
 
-    ~D() {
-        kiss_fftr_free(m_planf);
-        kiss_fftr_free(m_plani);
+    ~KissBackend() {
+        Kiss::destroy(m_planf);
+        Kiss::destroy(m_plani);
         delete[] m_c;
     }
 
-    void forward(const double *ri, double *ro, double *io) {
-        kiss_fftr(m_planf, ri, m_c);
+    void forward(const T *ri, T *ro, T *io) override {
+        Kiss::forward(m_planf, ri, m_c);
 
         for (int i = 0; i <= m_n / 2; ++i) {
             ro[i] = m_c[i].r;
             io[i] = m_c[i].i;
         }
+    }
+
+    void inverse(const T *ri, const T *ii, T *ro) override {
+        // kiss_fftr.h says
+        // "input freqdata has nfft/2+1 complex points"
+
+        for (int i = 0; i < m_n / 2 + 1; ++i) {
+            m_c[i].r = ri[i];
+            m_c[i].i = ii[i];
+        }
+
+        Kiss::inverse(m_plani, m_c, ro);
+    }
+
+  private:
+    typedef KissReal<T> Kiss;
+
+    int m_n;
+    std::shared_ptr<const RealPlans<T> > m_plans;
+    typename Kiss::Cfg m_planf;
+    typename Kiss::Cfg m_plani;
+    typename Kiss::Cpx *m_c;
+};
+
+template <typename T>
+class SimdBackend : public RealBackend<T> {
+  public:
+    SimdBackend(int n) : m_fft(n) {}
+
+    void forward(const T *ri, T *ro, T *io) override { m_fft.forward(ri, ro, io); }
+    void inverse(const T *ri, const T *ii, T *ro) override { m_fft.inverse(ri, ii, ro); }
+
+  private:
+    SimdRealFFT<T> m_fft;
+};
+
+}  // namespace
+
+template <typename T>
+class FFTRealT<T>::D {
+  public:
+    D(int n, FFTBackend backend) : m_n(n) {
+        if (n % 2) {
+            throw std::invalid_argument("nsamples must be even in FFTReal constructor");
+        }
+        if (backend == FFTBackend::Default) {
+            backend = kSimdFFTByDefault && SimdRealFFT<T>::supports(n) ? FFTBackend::Simd
+                                                                       : FFTBackend::Kiss;
+        }
+        if (backend == FFTBackend::Simd) {
+            m_backend.reset(new SimdBackend<T>(n));
+        } else {
+            m_backend.reset(new KissBackend<T>(n));
+        }
+    }
+
+    void forward(const T *ri, T *ro, T *io) {
+        m_backend->forward(ri, ro, io);
 
         for (int i = 0; i + 1 < m_n / 2; ++i) {
             ro[m_n - i - 1] = ro[i + 1];
@@ -108,30 +249,22 @@ class FFTReal::D {
         }
     }
 
-    void forwardMagnitude(const double *ri, double *mo) {
-        double *io = new double[m_n];
+    void forwardMagnitude(const T *ri, T *mo) {
+        T *io = new T[m_n];
 
         forward(ri, mo, io);
 
         for (int i = 0; i < m_n; ++i) {
-            mo[i] = sqrt(mo[i] * mo[i] + io[i] * io[i]);
+            mo[i] = std::sqrt(mo[i] * mo[i] + io[i] * io[i]);
         }
 
         delete[] io;
     }
 
-    void inverse(const double *ri, const double *ii, double *ro) {
-        // kiss_fftr.h says
-        // "input freqdata has nfft/2+1 complex points"
-
-        for (int i = 0; i < m_n / 2 + 1; ++i) {
-            m_c[i].r = ri[i];
-            m_c[i].i = ii[i];
-        }
-
-        kiss_fftri(m_plani, m_c, ro);
+    void inverse(const T *ri, const T *ii, T *ro) {
+        m_backend->inverse(ri, ii, ro);
 
-        double scale = 1.0 / m_n;
+        T scale = T(1.0) / m_n;
 
         for (int i = 0; i < m_n; ++i) {
             ro[i] *= scale;
@@ -140,25 +273,31 @@ class FFTReal::D {
 
   private:
     int m_n;
-    kiss_fftr_cfg m_planf;
-    kiss_fftr_cfg m_plani;
-    kiss_fft_cpx *m_c;
+    std::unique_ptr<RealBackend<T> > m_backend;
 };
 
-FFTReal::FFTReal(int n) : m_d(new D(n)) {}
+template <typename T>
+FFTRealT<T>::FFTRealT(int n, FFTBackend backend) : m_d(new D(n, backend)) {}
 
-FFTReal::~FFTReal() {
+template <typename T>
+FFTRealT<T>::~FFTRealT() {
     delete m_d;
 }
 
-void FFTReal::forward(const double *ri, double *ro, double *io) {
+template <typename T>
+void FFTRealT<T>::forward(const T *ri, T *ro, T *io) {
     m_d->forward(ri, ro, io);
 }
 
-void FFTReal::forwardMagnitude(const double *ri, double *mo) {
+template <typename T>
+void FFTRealT<T>::forwardMagnitude(const T *ri, T *mo) {
     m_d->forwardMagnitude(ri, mo);
 }
 
-void FFTReal::inverse(const double *ri, const double *ii, double *ro) {
+template <typename T>
+void FFTRealT<T>::inverse(const T *ri, const T *ii, T *ro) {
     m_d->inverse(ri, ii, ro);
 }
+
+template class FFTRealT<double>;
+template class FFTRealT<float>;
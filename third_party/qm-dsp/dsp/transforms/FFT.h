@@ -47,17 +47,44 @@ class FFT {
     D *m_d;
 };
 
-class FFTReal {
+/**
+ * The implementations FFTReal can run on. Kiss is kissfft, the
+ * reference; Simd is SimdRealFFT, for power-of-two sizes of at least
+ * 64. Default is Kiss, unless the library is built with
+ * QM_DSP_USE_SIMD_FFT (see kSimdFFTByDefault).
+ */
+enum class FFTBackend { Default, Kiss, Simd };
+
+/**
+ * Whether FFTBackend::Default picks Simd wherever it supports the
+ * size, and DetectionFunction computes the complex spectral
+ * difference in rectangular form. Both differ from Mixxx's code only
+ * in rounding, but that is enough to move the odd beat by one
+ * onset-detection step, so they are opt-in to keep results identical
+ * to Mixxx's.
+ */
+#ifdef QM_DSP_USE_SIMD_FFT
+constexpr bool kSimdFFTByDefault = true;
+#else
+constexpr bool kSimdFFTByDefault = false;
+#endif
+
+/**
+ * Real FFT in the scalar type T, double or float.
+ */
+template <typename T>
+class FFTRealT {
   public:
     /**
      * Construct an FFT object to carry out real-to-complex transforms
      * of size nsamples. nsamples does not have to be a power of two,
      * but it does have to be even. (Use the complex-complex FFT above
      * if you need an odd FFT size. This constructor will throw
-     * std::invalid_argument if nsamples is odd.)
+     * std::invalid_argument if nsamples is odd, or if the Simd
+     * backend is asked for a size it does not support.)
      */
-    FFTReal(int nsamples);
-    ~FFTReal();
+    FFTRealT(int nsamples, FFTBackend backend = FFTBackend::Default);
+    ~FFTRealT();
 
     /**
      * Carry out a forward real-to-complex transform of size nsamples,
@@ -68,7 +95,7 @@ class FFTReal {
      * compatibility with existing code, the conjugate half of the
      * output is returned even though it is redundant.
      */
-    void forward(const double *realIn, double *realOut, double *imagOut);
+    void forward(const T *realIn, T *realOut, T *imagOut);
 
     /**
      * Carry out a forward real-to-complex transform of size nsamples,
@@ -80,7 +107,7 @@ class FFTReal {
      * compatibility with existing code, the conjugate half of the
      * output is returned even though it is redundant.
      */
-    void forwardMagnitude(const double *realIn, double *magOut);
+    void forwardMagnitude(const T *realIn, T *magOut);
 
     /**
      * Carry out an inverse real transform (i.e. complex-to-real) of
@@ -96,11 +123,13 @@ class FFTReal {
      *
      * The inverse transform is scaled by 1/nsamples.
      */
-    void inverse(const double *realIn, const double *imagIn, double *realOut);
+    void inverse(const T *realIn, const T *imagIn, T *realOut);
 
   private:
     class D;
     D *m_d;
 };
 
+typedef FFTRealT<double> FFTReal;
+
 #endif
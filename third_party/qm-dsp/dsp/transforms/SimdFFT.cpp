@@ -0,0 +1,323 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    QM DSP Library
+
+    Centre for Digital Music, Queen Mary, University of London.
+*/
+
+#include "SimdFFT.h"
+
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "base/SimdOps.h"
+#include "base/TableCache.h"
+
+namespace {
+
+// ── Plans ───────────────────────────────────────────────────────────────────
+
+// Twiddles of one radix-4 pass over the half-size complex sequence. The
+// pass splits sub-sequences of length len into four, at stride s; its
+// twiddles w^p, w^2p and w^3p (w = exp(-2 pi i / len)) are stored per p,
+// or per lane index i = q + s * p when s is narrower than a vector.
+template <typename T>
+struct Pass {
+    int s;
+    std::vector<T> w1r, w1i, w2r, w2i, w3r, w3i;
+};
+
+// Immutable tables for one size, shared process-wide.
+template <typename T>
+struct Plan {
+    explicit Plan(int n) : n(n), half(n / 2) {
+        const int lanes = SimdOps<T>::W;
+        int len = half;
+        int s = 1;
+        for (; len >= 4; len /= 4, s *= 4) {
+            Pass<T> pass;
+            pass.s = s;
+            const int count = s < lanes ? half / 4 : len / 4;
+            std::vector<T> *w[6] = {&pass.w1r, &pass.w1i, &pass.w2r,
+                                    &pass.w2i, &pass.w3r, &pass.w3i};
+            for (std::vector<T> *table : w) {
+                table->resize(count);
+            }
+            for (int j = 0; j < count; ++j) {
+                const int p = s < lanes ? j / s : j;
+                for (int k = 1; k <= 3; ++k) {
+                    const double angle = 2.0 * M_PI * k * p / len;
+                    (*w[2 * k - 2])[j] = T(std::cos(angle));
+                    (*w[2 * k - 1])[j] = T(-std::sin(angle));
+                }
+            }
+            passes.push_back(std::move(pass));
+        }
+        radix2 = len == 2;
+
+        cosTable.resize(half / 2 + 1);
+        sinTable.resize(half / 2 + 1);
+        for (int k = 0; k <= half / 2; ++k) {
+            const double angle = 2.0 * M_PI * k / n;
+            cosTable[k] = T(std::cos(angle));
+            sinTable[k] = T(std::sin(angle));
+        }
+    }
+
+    int n;
+    int half;
+    std::vector<Pass<T> > passes;
+    // A last radix-2 pass when log2(half) is odd
+    bool radix2;
+    // cos and sin of 2 pi k / n for the real-spectrum (un)packing
+    std::vector<T> cosTable;
+    std::vector<T> sinTable;
+};
+
+// ── Kernels ─────────────────────────────────────────────────────────────────
+
+// One radix-4 decimation-in-frequency Stockham pass from x to y. Inputs
+// x[i + j * half/4] for j = 0..3 and lane index i = q + s * p become
+// outputs y[q + s * (4p + j)], in natural order after the last pass.
+template <typename T>
+void radix4(const Pass<T> &pass, int half, const T *xr, const T *xi, T *yr, T *yi) {
+    typedef SimdOps<T> O;
+    typedef typename O::V V;
+    const int quarter = half / 4;
+    const int s = pass.s;
+
+    auto butterfly = [&](int i, V w1r, V w1i, V w2r, V w2i, V w3r, V w3i, V *outr, V *outi) {
+        const V ar = O::load(xr + i), ai = O::load(xi + i);
+        const V br = O::load(xr + i + quarter), bi = O::load(xi + i + quarter);
+        const V cr = O::load(xr + i + 2 * quarter), ci = O::load(xi + i + 2 * quarter);
+        const V dr = O::load(xr + i + 3 * quarter), di = O::load(xi + i + 3 * quarter);
+        const V apcr = O::add(ar, cr), apci = O::add(ai, ci);
+        const V amcr = O::sub(ar, cr), amci = O::sub(ai, ci);
+        const V bpdr = O::add(br, dr), bpdi = O::add(bi, di);
+        const V bmdr = O::sub(br, dr), bmdi = O::sub(bi, di);
+        // t1 = (a - c) - i (b - d), t2 = (a + c) - (b + d), t3 = (a - c) + i (b - d)
+        const V t1r = O::add(amcr, bmdi), t1i = O::sub(amci, bmdr);
+        const V t2r = O::sub(apcr, bpdr), t2i = O::sub(apci, bpdi);
+        const V t3r = O::sub(amcr, bmdi), t3i = O::add(amci, bmdr);
+        outr[0] = O::add(apcr, bpdr);
+        outi[0] = O::add(apci, bpdi);
+        outr[1] = O::sub(O::mul(t1r, w1r), O::mul(t1i, w1i));
+        outi[1] = O::add(O::mul(t1r, w1i), O::mul(t1i, w1r));
+        outr[2] = O::sub(O::mul(t2r, w2r), O::mul(t2i, w2i));
+        outi[2] = O::add(O::mul(t2r, w2i), O::mul(t2i, w2r));
+        outr[3] = O::sub(O::mul(t3r, w3r), O::mul(t3i, w3i));
+        outi[3] = O::add(O::mul(t3r, w3i), O::mul(t3i, w3r));
+    };
+
+    V outr[4], outi[4];
+    if (s >= O::W) {
+        for (int p = 0; p < quarter / s; ++p) {
+            const V w1r = O::set1(pass.w1r[p]), w1i = O::set1(pass.w1i[p]);
+            const V w2r = O::set1(pass.w2r[p]), w2i = O::set1(pass.w2i[p]);
+            const V w3r = O::set1(pass.w3r[p]), w3i = O::set1(pass.w3i[p]);
+            T *pr = yr + 4 * s * p;
+            T *pi = yi + 4 * s * p;
+            for (int q = 0; q < s; q += O::W) {
+                butterfly(s * p + q, w1r, w1i, w2r, w2i, w3r, w3i, outr, outi);
+                for (int j = 0; j < 4; ++j) {
+                    O::store(pr + j * s + q, outr[j]);
+                    O::store(pi + j * s + q, outi[j]);
+                }
+            }
+        }
+    } else {
+        for (int i = 0; i < quarter; i += O::W) {
+            butterfly(i, O::load(&pass.w1r[i]), O::load(&pass.w1i[i]), O::load(&pass.w2r[i]),
+                      O::load(&pass.w2i[i]), O::load(&pass.w3r[i]), O::load(&pass.w3i[i]), outr,
+                      outi);
+            O::interleave(yr + 4 * i, s, outr[0], outr[1], outr[2], outr[3]);
+            O::interleave(yi + 4 * i, s, outi[0], outi[1], outi[2], outi[3]);
+        }
+    }
+}
+
+// The final radix-2 pass, at stride half/2, without twiddles.
+template <typename T>
+void radix2(int half, const T *xr, const T *xi, T *yr, T *yi) {
+    typedef SimdOps<T> O;
+    const int s = half / 2;
+    for (int q = 0; q < s; q += O::W) {
+        const typename O::V ar = O::load(xr + q), ai = O::load(xi + q);
+        const typename O::V br = O::load(xr + q + s), bi = O::load(xi + q + s);
+        O::store(yr + q, O::add(ar, br));
+        O::store(yi + q, O::add(ai, bi));
+        O::store(yr + q + s, O::sub(ar, br));
+        O::store(yi + q + s, O::sub(ai, bi));
+    }
+}
+
+// Unscaled forward complex FFT of x, using y as scratch. Returns the
+// buffers holding the result through outr and outi.
+template <typename T>
+void transform(const Plan<T> &plan, T *xr, T *xi, T *yr, T *yi, T *&outr, T *&outi) {
+    for (const Pass<T> &pass : plan.passes) {
+        radix4(pass, plan.half, xr, xi, yr, yi);
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+    }
+    if (plan.radix2) {
+        radix2(plan.half, xr, xi, yr, yi);
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+    }
+    outr = xr;
+    outi = xi;
+}
+
+// The real spectrum X[k] and X[half - k] from the half-size complex
+// spectrum Z, for k in [k, end) in steps of O::W; returns where it
+// stopped. With Z = E + i O, where E and O are the spectra of the even
+// and odd samples: X[k] = E[k] + w^k O[k] and X[half - k] =
+// conj(E[k] - w^k O[k]), for w = exp(-2 pi i / n).
+template <typename O, typename T>
+int unpackSpectrum(const Plan<T> &plan, const T *zr, const T *zi, T *ro, T *io, int k, int end) {
+    typedef typename O::V V;
+    const V half = O::set1(T(0.5));
+    for (; k + O::W <= end; k += O::W) {
+        const int m = plan.half - k - (O::W - 1);
+        const V zrk = O::load(zr + k), zik = O::load(zi + k);
+        const V zrm = O::reverse(O::load(zr + m)), zim = O::reverse(O::load(zi + m));
+        const V er = O::mul(half, O::add(zrk, zrm));
+        const V ei = O::mul(half, O::sub(zik, zim));
+        const V orr = O::mul(half, O::add(zik, zim));
+        const V oi = O::mul(half, O::sub(zrm, zrk));
+        const V c = O::load(&plan.cosTable[k]), s = O::load(&plan.sinTable[k]);
+        const V pr = O::add(O::mul(c, orr), O::mul(s, oi));
+        const V pi = O::sub(O::mul(c, oi), O::mul(s, orr));
+        O::store(ro + k, O::add(er, pr));
+        O::store(io + k, O::add(ei, pi));
+        O::store(ro + m, O::reverse(O::sub(er, pr)));
+        O::store(io + m, O::reverse(O::sub(pi, ei)));
+    }
+    return k;
+}
+
+// The reverse of unpackSpectrum(), doubled: Z[k] = E[k] + i O[k] with
+// E[k] = X[k] + conj(X[half - k]) and O[k] = (X[k] - conj(X[half - k]))
+// w^-k.
+template <typename O, typename T>
+int packSpectrum(const Plan<T> &plan, const T *ri, const T *ii, T *zr, T *zi, int k, int end) {
+    typedef typename O::V V;
+    for (; k + O::W <= end; k += O::W) {
+        const int m = plan.half - k - (O::W - 1);
+        const V rk = O::load(ri + k), ik = O::load(ii + k);
+        const V rm = O::reverse(O::load(ri + m)), im = O::reverse(O::load(ii + m));
+        const V er = O::add(rk, rm), ei = O::sub(ik, im);
+        const V dr = O::sub(rk, rm), di = O::add(ik, im);
+        const V c = O::load(&plan.cosTable[k]), s = O::load(&plan.sinTable[k]);
+        const V orr = O::sub(O::mul(dr, c), O::mul(di, s));
+        const V oi = O::add(O::mul(dr, s), O::mul(di, c));
+        O::store(zr + k, O::sub(er, oi));
+        O::store(zi + k, O::add(ei, orr));
+        O::store(zr + m, O::reverse(O::add(er, oi)));
+        O::store(zi + m, O::reverse(O::sub(orr, ei)));
+    }
+    return k;
+}
+
+}  // namespace
+
+template <typename T>
+class SimdRealFFT<T>::D {
+  public:
+    D(int n)
+        : m_plan(TableCache<int, Plan<T> >::get(
+              n, [n]() { return std::make_shared<const Plan<T> >(n); })),
+          m_half(n / 2),
+          m_ar(m_half),
+          m_ai(m_half),
+          m_br(m_half),
+          m_bi(m_half) {}
+
+    void forward(const T *in, T *ro, T *io) {
+        typedef SimdOps<T> O;
+        const int h = m_half;
+
+        // The even samples as real and the odd ones as imaginary parts
+        for (int k = 0; k < h; k += O::W) {
+            typename O::V even, odd;
+            O::deinterleave(in + 2 * k, even, odd);
+            O::store(&m_ar[k], even);
+            O::store(&m_ai[k], odd);
+        }
+        T *zr, *zi;
+        transform(*m_plan, m_ar.data(), m_ai.data(), m_br.data(), m_bi.data(), zr, zi);
+
+        ro[0] = zr[0] + zi[0];
+        io[0] = 0;
+        ro[h] = zr[0] - zi[0];
+        io[h] = 0;
+        int k = unpackSpectrum<O>(*m_plan, zr, zi, ro, io, 1, h / 2);
+        unpackSpectrum<ScalarOps<T> >(*m_plan, zr, zi, ro, io, k, h / 2);
+        ro[h / 2] = zr[h / 2];
+        io[h / 2] = -zi[h / 2];
+    }
+
+    void inverse(const T *ri, const T *ii, T *out) {
+        typedef SimdOps<T> O;
+        const int h = m_half;
+
+        m_ar[0] = ri[0] + ri[h];
+        m_ai[0] = ri[0] - ri[h];
+        int k = packSpectrum<O>(*m_plan, ri, ii, m_ar.data(), m_ai.data(), 1, h / 2);
+        packSpectrum<ScalarOps<T> >(*m_plan, ri, ii, m_ar.data(), m_ai.data(), k, h / 2);
+        m_ar[h / 2] = 2 * ri[h / 2];
+        m_ai[h / 2] = -2 * ii[h / 2];
+
+        // An inverse FFT is a forward one with real and imaginary swapped
+        T *zi, *zr;
+        transform(*m_plan, m_ai.data(), m_ar.data(), m_bi.data(), m_br.data(), zi, zr);
+        for (int i = 0; i < h; i += O::W) {
+            O::interleave2(out + 2 * i, O::load(zr + i), O::load(zi + i));
+        }
+    }
+
+  private:
+    std::shared_ptr<const Plan<T> > m_plan;
+    int m_half;
+    std::vector<T> m_ar, m_ai, m_br, m_bi;
+};
+
+template <typename T>
+bool SimdRealFFT<T>::supports(int n) {
+    return n >= 64 && (n & (n - 1)) == 0;
+}
+
+template <typename T>
+const char *SimdRealFFT<T>::instructionSet() {
+    return simdInstructionSet();
+}
+
+template <typename T>
+SimdRealFFT<T>::SimdRealFFT(int n) {
+    if (!supports(n)) {
+        throw std::invalid_argument("SimdRealFFT size must be a power of two of at least 64");
+    }
+    m_d = new D(n);
+}
+
+template <typename T>
+SimdRealFFT<T>::~SimdRealFFT() {
+    delete m_d;
+}
+
+template <typename T>
+void SimdRealFFT<T>::forward(const T *ri, T *ro, T *io) {
+    m_d->forward(ri, ro, io);
+}
+
+template <typename T>
+void SimdRealFFT<T>::inverse(const T *ri, const T *ii, T *ro) {
+    m_d->inverse(ri, ii, ro);
+}
+
+template class SimdRealFFT<double>;
+template class SimdRealFFT<float>;
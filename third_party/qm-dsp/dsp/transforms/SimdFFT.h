@@ -0,0 +1,71 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    QM DSP Library
+
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef QM_DSP_SIMDFFT_H
+#define QM_DSP_SIMDFFT_H
+
+/**
+ * Vectorized real FFT of power-of-two sizes, in the scalar type T
+ * (double or float). The input is packed into a half-size complex
+ * sequence, transformed with radix-4 Stockham passes on split real
+ * and imaginary arrays and then unpacked into the real spectrum.
+ *
+ * The kernels use the widest vectors the build targets: AVX (in AVX
+ * or AVX2 builds), else SSE2 on x86-64 and NEON on AArch64, else
+ * plain scalar code. Results agree with kissfft to within rounding.
+ */
+template <typename T>
+class SimdRealFFT {
+  public:
+    /**
+     * True if nsamples is a size this class handles: a power of two
+     * of at least 64.
+     */
+    static bool supports(int nsamples);
+
+    /**
+     * Name of the instruction set the kernels were built for: "avx",
+     * "sse2", "neon" or "scalar".
+     */
+    static const char *instructionSet();
+
+    /**
+     * Construct an FFT object for real transforms of size nsamples.
+     * Throws std::invalid_argument if !supports(nsamples).
+     */
+    SimdRealFFT(int nsamples);
+    ~SimdRealFFT();
+
+    /**
+     * Forward transform of nsamples real values. realOut and imagOut
+     * receive the nsamples/2+1 non-redundant bins.
+     */
+    void forward(const T *realIn, T *realOut, T *imagOut);
+
+    /**
+     * Inverse transform of the nsamples/2+1 bins in realIn and
+     * imagIn into nsamples real values. Unscaled, like kissfft: the
+     * output is nsamples times the signal.
+     */
+    void inverse(const T *realIn, const T *imagIn, T *realOut);
+
+  private:
+    SimdRealFFT(const SimdRealFFT &) = delete;
+    SimdRealFFT &operator=(const SimdRealFFT &) = delete;
+
+    class D;
+    D *m_d;
+};
+
+#endif
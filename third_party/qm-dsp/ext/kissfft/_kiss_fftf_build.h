@@ -0,0 +1,23 @@
+/* Included first by kiss_fftf.c and tools/kiss_fftrf.c: compiles the
+   kissfft sources that follow as the single-precision build declared in
+   kiss_fftf.h. */
+#ifndef KISS_FFTF_BUILD_H
+#define KISS_FFTF_BUILD_H
+
+#undef kiss_fft_scalar
+#define kiss_fft_scalar float
+
+#define kiss_fft_alloc kiss_fftf_alloc
+#define kiss_fft kiss_fftf
+#define kiss_fft_stride kiss_fftf_stride
+#define kiss_fft_cleanup kiss_fftf_cleanup
+#define kiss_fft_next_fast_size kiss_fftf_next_fast_size
+#define kiss_fft_state kiss_fftf_state
+
+#define kiss_fftr_alloc kiss_fftrf_alloc
+#define kiss_fftr_alloc_shared kiss_fftrf_alloc_shared
+#define kiss_fftr kiss_fftrf
+#define kiss_fftri kiss_fftrif
+#define kiss_fftr_state kiss_fftrf_state
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef KISS_FFTF_H
+#define KISS_FFTF_H
+
+/*
+ Single-precision kissfft, for callers that also use the double build
+ (kiss_fft_scalar=double) in the same program. kiss_fftf.c and
+ tools/kiss_fftrf.c compile the regular sources with kiss_fft_scalar=float
+ and every exported function renamed as below; the types mirror kiss_fft.h
+ and tools/kiss_fftr.h.
+*/
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    float r;
+    float i;
+} kiss_fftf_cpx;
+
+typedef struct kiss_fftf_state *kiss_fftf_cfg;
+typedef struct kiss_fftrf_state *kiss_fftrf_cfg;
+
+kiss_fftf_cfg kiss_fftf_alloc(int nfft, int inverse_fft, void *mem, size_t *lenmem);
+void kiss_fftf(kiss_fftf_cfg cfg, const kiss_fftf_cpx *fin, kiss_fftf_cpx *fout);
+
+kiss_fftrf_cfg kiss_fftrf_alloc(int nfft, int inverse_fft, void *mem, size_t *lenmem);
+kiss_fftrf_cfg kiss_fftrf_alloc_shared(kiss_fftrf_cfg shared);
+void kiss_fftrf(kiss_fftrf_cfg cfg, const float *timedata, kiss_fftf_cpx *freqdata);
+void kiss_fftrif(kiss_fftrf_cfg cfg, const kiss_fftf_cpx *freqdata, float *timedata);
+
+#define kiss_fftf_free free
+#define kiss_fftrf_free free
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -75,6 +75,21 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft, int inverse_fft, void *mem, size_t *lenm
     return st;
 }
 
+kiss_fftr_cfg kiss_fftr_alloc_shared(kiss_fftr_cfg shared) {
+    kiss_fftr_cfg st;
+    int ncfft = shared->substate->nfft;
+
+    st = (kiss_fftr_cfg)KISS_FFT_MALLOC(sizeof(struct kiss_fftr_state) +
+                                        sizeof(kiss_fft_cpx) * ncfft);
+    if (!st)
+        return NULL;
+
+    st->substate = shared->substate;
+    st->tmpbuf = (kiss_fft_cpx *)(st + 1);
+    st->super_twiddles = shared->super_twiddles;
+    return st;
+}
+
 void kiss_fftr(kiss_fftr_cfg st, const kiss_fft_scalar *timedata, kiss_fft_cpx *freqdata) {
     /* input buffer timedata is stored row-wise */
     int k, ncfft;
@@ -35,6 +35,13 @@ void kiss_fftri(kiss_fftr_cfg cfg, const kiss_fft_cpx *freqdata, kiss_fft_scalar
  output timedata has nfft scalar points
 */
 
+kiss_fftr_cfg kiss_fftr_alloc_shared(kiss_fftr_cfg shared);
+/*
+ Returns a config that uses the twiddles of 'shared' with a scratch buffer
+ of its own, so one plan can back transforms running on several threads.
+ 'shared' must outlive it. Free it with kiss_fftr_free.
+*/
+
 #define kiss_fftr_free free
 
 #ifdef __cplusplus
@@ -0,0 +1,3 @@
+/* Single-precision build of kiss_fftr.c; see ../kiss_fftf.h. */
+#include "../_kiss_fftf_build.h"
+#include "kiss_fftr.c"